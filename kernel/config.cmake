@@ -241,6 +241,16 @@ config_string(
     DEFAULT 8
     UNQUOTE
 )
+config_option(
+    KernelFastUntypedReset FAST_UNTYPED_RESET
+    "Zero memory when resetting untyped capabilities using architecture specific \
+    routines for large regions. On x86 this uses non-temporal stores, so that \
+    clearing an untyped does not evict the working set from the cache. On aarch64 \
+    this uses DC ZVA, which zeroes a whole block without reading it first."
+    DEFAULT OFF
+    DEPENDS "NOT KernelVerificationBuild;KernelArchX86 OR KernelSel4ArchAarch64"
+    DEFAULT_DISABLED OFF
+)
 config_string(
     KernelMaxNumBootinfoUntypedCaps MAX_NUM_BOOTINFO_UNTYPED_CAPS
     "Max number of bootinfo untyped caps"
@@ -249,6 +259,28 @@ config_string(
 )
 config_option(KernelFastpath FASTPATH "Enable IPC fastpath" DEFAULT ON)
 
+config_option(
+    KernelFastpathLongMessages FASTPATH_LONG_MESSAGES
+    "Allow the IPC fastpath to transfer messages that are longer than the \
+    message registers. The remaining words are copied directly between the IPC \
+    buffers of the sender and the receiver, which must both be valid. Messages \
+    carrying caps still use the slowpath."
+    DEFAULT OFF
+    DEPENDS "KernelFastpath;NOT KernelVerificationBuild"
+    DEFAULT_DISABLED OFF
+)
+
+config_option(
+    KernelSignalFastpath SIGNAL_FASTPATH
+    "Enable a fastpath for seL4_Signal on notification capabilities. It handles \
+    signalling an idle or active notification, and waking a waiting thread on \
+    the same core that will not preempt the signaller. Everything else uses the \
+    slowpath."
+    DEFAULT OFF
+    DEPENDS "KernelFastpath;NOT KernelVerificationBuild"
+    DEFAULT_DISABLED OFF
+)
+
 config_string(
     KernelNumDomains NUM_DOMAINS "The number of scheduler domains in the system"
     DEFAULT 1
@@ -279,6 +311,18 @@ config_string(
     UNQUOTE
 )
 
+config_option(
+    KernelSMPLoadBalancing SMP_LOAD_BALANCING
+    "Balance runnable threads across cores. A core that is about to run its idle \
+    thread instead pulls the highest priority waiting thread of the current \
+    domain from the ready queues of the core with the most such threads, taking \
+    only threads that have been marked with seL4_TCB_SetMigratable. A core with \
+    marked threads waiting sends a reschedule IPI to at most one idle core at a \
+    time so it can take one. Unmarked threads keep their affinity."
+    DEFAULT OFF
+    DEPENDS "${KernelMaxNumNodes} GREATER 1;NOT KernelIsMCS"
+)
+
 config_string(
     KernelStackBits KERNEL_STACK_BITS
     "This describes the log2 size of the kernel stack. Great care should be taken as\
@@ -351,18 +395,54 @@ config_choice(
     track_kernel_entries -> Log kernel entries information including timing, number of invocations and arguments for \
     system calls, interrupts, user faults and VM faults. \
     tracepoints -> Enable manually inserted tracepoints that the kernel will track time consumed between. \
-    track_utilisation -> Enable the kernel to track each thread's utilisation time."
+    track_utilisation -> Enable the kernel to track each thread's utilisation time. \
+    sampling_profiler -> On every kernel timer interrupt, record the interrupted thread, \
+    its user PC and a frame pointer backtrace into a ring per core in the log buffer."
     "none;KernelBenchmarksNone;NO_BENCHMARKS"
     "generic;KernelBenchmarksGeneric;BENCHMARK_GENERIC;NOT KernelVerificationBuild"
     "track_kernel_entries;KernelBenchmarksTrackKernelEntries;BENCHMARK_TRACK_KERNEL_ENTRIES;NOT KernelVerificationBuild"
     "tracepoints;KernelBenchmarksTracepoints;BENCHMARK_TRACEPOINTS;NOT KernelVerificationBuild"
     "track_utilisation;KernelBenchmarksTrackUtilisation;BENCHMARK_TRACK_UTILISATION;NOT KernelVerificationBuild"
+    "sampling_profiler;KernelBenchmarksSamplingProfiler;BENCHMARK_SAMPLING_PROFILER;NOT KernelVerificationBuild;KernelSel4ArchAarch64"
 )
 if(NOT (KernelBenchmarks STREQUAL "none"))
     config_set(KernelEnableBenchmarks ENABLE_BENCHMARKS ON)
 else()
     config_set(KernelEnableBenchmarks ENABLE_BENCHMARKS OFF)
 endif()
+config_string(
+    KernelBenchmarksTrackUtilisationPMUCounters BENCHMARK_TRACK_UTILISATION_PMU_COUNTERS
+    "Number of PMU event counters, starting from counter 0, whose counts are \
+    attributed to the running thread on every context switch. The per thread \
+    counts are returned by seL4_BenchmarkGetThreadUtilisation after the \
+    existing utilisation values. The events counted are whatever user level \
+    has configured the counters to count. 0 disables this."
+    DEFAULT 0
+    DEPENDS "KernelBenchmarksTrackUtilisation;KernelArchARM;NOT KernelArchArmV6"
+    DEFAULT_DISABLED 0
+    UNQUOTE
+)
+
+config_option(
+    KernelBenchmarksTrackKernelEntriesRing BENCHMARK_TRACK_KERNEL_ENTRIES_RING
+    "Record tracked kernel entries into a ring per core instead of one flat log. \
+    User level consumes entries from the rings while the kernel keeps recording, \
+    so tracing does not stop once the log buffer has been filled once. Entries \
+    recorded while a core's ring is full are dropped and counted."
+    DEFAULT OFF
+    DEPENDS "KernelBenchmarksTrackKernelEntries"
+    DEFAULT_DISABLED OFF
+)
+config_string(
+    KernelBenchmarkSampleStackDepth BENCHMARK_SAMPLE_STACK_DEPTH
+    "Maximum number of return addresses recorded per sample by the sampling \
+    profiler. User code must be built with frame pointers for the backtraces \
+    to be useful."
+    DEFAULT 8
+    DEPENDS "KernelBenchmarksSamplingProfiler"
+    DEFAULT_DISABLED 0
+    UNQUOTE
+)
 config_string(
     KernelMaxNumTracePoints MAX_NUM_TRACE_POINTS
     "Use TRACE_POINT_START(k) and TRACE_POINT_STOP(k) macros for recording data, \
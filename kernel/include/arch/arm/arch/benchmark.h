@@ -43,6 +43,14 @@ static inline void handleOverflowIRQ(void)
 }
 #endif /* CONFIG_ARM_ENABLE_PMU_OVERFLOW_INTERRUPT */
 
+#if CONFIG_BENCHMARK_TRACK_UTILISATION_PMU_COUNTERS > 0
+/* Read one of the PMU event counters. These are only 32 bits wide. */
+static inline uint32_t benchmark_read_event_counter(word_t counter)
+{
+    return armv_read_event_counter(counter);
+}
+#endif /* CONFIG_BENCHMARK_TRACK_UTILISATION_PMU_COUNTERS > 0 */
+
 static inline void benchmark_arch_utilisation_reset(void)
 {
 #ifdef CONFIG_ARM_ENABLE_PMU_OVERFLOW_INTERRUPT
@@ -26,4 +26,10 @@ void fastpath_reply_recv(word_t cptr, word_t r_msgInfo)
 #endif
 NORETURN;
 
+#ifdef CONFIG_SIGNAL_FASTPATH
+static inline
+void fastpath_signal(word_t cptr, word_t msgInfo)
+NORETURN;
+#endif
+
 
@@ -50,3 +50,9 @@ exception_t decodeARMMMUInvocation(word_t invLabel, word_t length, cptr_t cptr,
 void Arch_userStackTrace(tcb_t *tptr);
 #endif
 
+#ifdef CONFIG_BENCHMARK_SAMPLING_PROFILER
+/* Walk the frame pointer chain of a user thread, storing up to max_frames
+ * return addresses. Returns the number of frames stored. */
+word_t Arch_userStackWalk(tcb_t *tptr, word_t *frames, word_t max_frames);
+#endif
+
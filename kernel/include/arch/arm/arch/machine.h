@@ -54,6 +54,45 @@ static inline void clearMemory(word_t *ptr, word_t bits)
                         addrFromPPtr(ptr));
 }
 
+#ifdef CONFIG_FAST_UNTYPED_RESET
+/* Zero a region with DC ZVA, which zeroes a whole block per instruction
+ * without reading it into the cache first. Returns false, leaving the region
+ * untouched, if DC ZVA is prohibited or the region is not aligned to the
+ * block size. Only available on aarch64. */
+static inline bool_t zeroMemoryByBlock(void *ptr, word_t bytes)
+{
+    word_t dczid;
+    word_t block;
+
+    asm volatile("mrs %0, dczid_el0" : "=r"(dczid));
+    /* DZP, bit 4, is set if DC ZVA is prohibited */
+    if (dczid & BIT(4)) {
+        return false;
+    }
+    /* BS, bits 3:0, is the log2 of the block size in 4 byte words */
+    block = BIT((dczid & MASK(4)) + 2);
+    if (((word_t)ptr | bytes) & (block - 1)) {
+        return false;
+    }
+
+    for (word_t addr = (word_t)ptr; addr < (word_t)ptr + bytes; addr += block) {
+        asm volatile("dc zva, %0" : : "r"(addr) : "memory");
+    }
+    return true;
+}
+
+/* As clearMemory, but for large regions that will not be used straight away,
+ * such as untyped memory being reset. */
+static inline void clearMemoryBulk(word_t *ptr, word_t bits)
+{
+    if (!zeroMemoryByBlock(ptr, BIT(bits))) {
+        memzero(ptr, BIT(bits));
+    }
+    cleanCacheRange_PoU((word_t)ptr, (word_t)ptr + BIT(bits) - 1,
+                        addrFromPPtr(ptr));
+}
+#endif
+
 static inline void clearMemoryRAM(word_t *ptr, word_t bits)
 {
     memzero(ptr, BIT(bits));
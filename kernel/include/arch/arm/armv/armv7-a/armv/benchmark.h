@@ -29,5 +29,24 @@ static inline void armv_handleOverflowIRQ(void)
     word_t val = BIT(CCNT_INDEX);
     MCR(PMOVSR, val);
 }
+
+#if CONFIG_BENCHMARK_TRACK_UTILISATION_PMU_COUNTERS > 0
+#define PMSELR "p15, 0, %0, c9, c12, 5"
+#define PMXEVCNTR "p15, 0, %0, c9, c13, 2"
+
+/* User level selects a counter with PMSELR and then accesses it through
+ * PMXEVCNTR or PMXEVTYPER, and may be preempted in between, so the selection
+ * is restored before returning. */
+static inline word_t armv_read_event_counter(word_t counter)
+{
+    word_t val, sel;
+    MRC(PMSELR, sel);
+    MCR(PMSELR, counter);
+    isb();
+    MRC(PMXEVCNTR, val);
+    MCR(PMSELR, sel);
+    return val;
+}
+#endif /* CONFIG_BENCHMARK_TRACK_UTILISATION_PMU_COUNTERS > 0 */
 #endif /* CONFIG_ENABLE_BENCHMARKS */
 
@@ -30,5 +30,23 @@ static inline void armv_handleOverflowIRQ(void)
     MSR(PMOVSR, val);
 }
 
+#if CONFIG_BENCHMARK_TRACK_UTILISATION_PMU_COUNTERS > 0
+#define PMSELR "PMSELR_EL0"
+#define PMXEVCNTR "PMXEVCNTR_EL0"
+
+/* User level selects a counter with PMSELR and then accesses it through
+ * PMXEVCNTR or PMXEVTYPER, and may be preempted in between, so the selection
+ * is restored before returning. */
+static inline word_t armv_read_event_counter(word_t counter)
+{
+    word_t val, sel;
+    MRS(PMSELR, sel);
+    MSR(PMSELR, counter);
+    isb();
+    MRS(PMXEVCNTR, val);
+    MSR(PMSELR, sel);
+    return val;
+}
+#endif /* CONFIG_BENCHMARK_TRACK_UTILISATION_PMU_COUNTERS > 0 */
 #endif /* CONFIG_ENABLE_BENCHMARKS */
 
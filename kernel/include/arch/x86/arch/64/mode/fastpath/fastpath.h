@@ -41,8 +41,14 @@ static inline void FORCE_INLINE switchToThread_fp(tcb_t *thread, vspace_root_t *
     asid_t asid = (asid_t)(stored_hw_asid.words[0] & 0xfff);
     cr3_t next_cr3 = makeCR3(new_vroot, asid);
     if (likely(getCurrentUserCR3().words[0] != next_cr3.words[0])) {
-        SMP_COND_STATEMENT(tlb_bitmap_set(vroot, getCurrentCPUIndex());)
+#ifdef ENABLE_SMP_SUPPORT
+        tlb_bitmap_set(vroot, getCurrentCPUIndex());
+        /* the load itself only affects this core, so is done in
+         * fastpath_restore once the kernel lock has been released */
+        setCurrentUserCR3Deferred(next_cr3);
+#else
         setCurrentUserCR3(next_cr3);
+#endif
     }
 
 #ifdef ENABLE_SMP_SUPPORT
@@ -52,6 +58,12 @@ static inline void FORCE_INLINE switchToThread_fp(tcb_t *thread, vspace_root_t *
                  [offset] "i"(OFFSETOF(nodeInfo_t, currentThreadUserContext)));
 #endif /* ENABLE_SMP_SUPPORT */
 
+#ifdef ENABLE_SMP_SUPPORT
+    if (config_set(CONFIG_KERNEL_X86_IBPB_ON_CONTEXT_SWITCH) ||
+        config_set(CONFIG_KERNEL_X86_RSB_ON_CONTEXT_SWITCH)) {
+        MODE_NODE_STATE(x64KSPendingSwitchBarrier) = true;
+    }
+#else
     if (config_set(CONFIG_KERNEL_X86_IBPB_ON_CONTEXT_SWITCH)) {
         x86_ibpb();
     }
@@ -59,6 +71,7 @@ static inline void FORCE_INLINE switchToThread_fp(tcb_t *thread, vspace_root_t *
     if (config_set(CONFIG_KERNEL_X86_RSB_ON_CONTEXT_SWITCH)) {
         x86_flush_rsb();
     }
+#endif
 
 #ifdef CONFIG_BENCHMARK_TRACK_UTILISATION
     benchmark_utilisation_switch(NODE_STATE(ksCurThread), thread);
@@ -130,6 +143,7 @@ static inline void NORETURN FORCE_INLINE fastpath_restore(word_t badge, word_t m
         restore_user_context();
     }
     NODE_UNLOCK;
+    SMP_COND_STATEMENT(finishDeferredSwitch());
     c_exit_hook();
     lazyFPURestore(cur_thread);
 
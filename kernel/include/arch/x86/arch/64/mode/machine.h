@@ -106,6 +106,43 @@ static inline void setCurrentUserVSpaceRoot(paddr_t addr, word_t pcid)
 #endif
 }
 
+#ifdef ENABLE_SMP_SUPPORT
+/* Record a switch to a new user cr3, without loading it. The load is done by
+ * finishDeferredSwitch once the kernel lock has been released. */
+static inline void setCurrentUserCR3Deferred(cr3_t cr3)
+{
+#ifdef CONFIG_KERNEL_SKIM_WINDOW
+    /* the exit stubs already load the user cr3 outside of the lock */
+    setCurrentUserCR3(cr3);
+#else
+    MODE_NODE_STATE(x64KSCurrentCR3) = cr3;
+    MODE_NODE_STATE(x64KSPendingCR3Load) = true;
+#endif
+}
+
+/* Perform any context switch work that was deferred by the fastpath. This
+ * must happen after the kernel lock is released but before anything that
+ * could enter the kernel again, such as servicing a pending interrupt. */
+static inline void finishDeferredSwitch(void)
+{
+#ifndef CONFIG_KERNEL_SKIM_WINDOW
+    if (MODE_NODE_STATE(x64KSPendingCR3Load)) {
+        MODE_NODE_STATE(x64KSPendingCR3Load) = false;
+        setCurrentCR3(MODE_NODE_STATE(x64KSCurrentCR3), 1);
+    }
+#endif
+    if (MODE_NODE_STATE(x64KSPendingSwitchBarrier)) {
+        MODE_NODE_STATE(x64KSPendingSwitchBarrier) = false;
+        if (config_set(CONFIG_KERNEL_X86_IBPB_ON_CONTEXT_SWITCH)) {
+            x86_ibpb();
+        }
+        if (config_set(CONFIG_KERNEL_X86_RSB_ON_CONTEXT_SWITCH)) {
+            x86_flush_rsb();
+        }
+    }
+}
+#endif /* ENABLE_SMP_SUPPORT */
+
 /* GDT installation */
 void x64_install_gdt(gdt_idt_ptr_t *gdt_idt_ptr);
 
@@ -37,6 +37,14 @@ NODE_STATE_DECLARE(word_t, x64KSCurrentUserCR3);
 #else
 NODE_STATE_DECLARE(cr3_t, x64KSCurrentCR3);
 #endif
+#ifdef ENABLE_SMP_SUPPORT
+/* context switch work from the fastpath that only affects this core, and so is
+ * deferred until after the kernel lock has been released */
+#ifndef CONFIG_KERNEL_SKIM_WINDOW
+NODE_STATE_DECLARE(bool_t, x64KSPendingCR3Load);
+#endif
+NODE_STATE_DECLARE(bool_t, x64KSPendingSwitchBarrier);
+#endif
 NODE_STATE_END(modeNodeState);
 
 /* hardware interrupt handlers push up to 6 words onto the stack. The order of the
@@ -27,3 +27,8 @@ void fastpath_reply_recv(word_t cptr, word_t r_msgInfo, word_t reply)
 void fastpath_reply_recv(word_t cptr, word_t r_msgInfo)
 #endif
 NORETURN;
+
+#ifdef CONFIG_SIGNAL_FASTPATH
+void fastpath_signal(word_t cptr, word_t msgInfo)
+NORETURN;
+#endif
@@ -344,6 +344,22 @@ static inline void clearMemory(void *ptr, unsigned int bits)
     /* no cleaning of caches necessary on IA-32 */
 }
 
+#ifdef CONFIG_FAST_UNTYPED_RESET
+/* As clearMemory, but for large regions that will not be used straight away,
+ * such as untyped memory being reset. Non-temporal stores write around the
+ * cache, so the zeroes do not evict the working set. */
+static inline void clearMemoryBulk(void *ptr, unsigned int bits)
+{
+    word_t *end = (word_t *)ptr + BIT(bits) / sizeof(word_t);
+
+    for (word_t *p = ptr; p < end; p++) {
+        asm volatile("movnti %[zero], %[dest]" : [dest] "=m"(*p) : [zero] "r"((word_t)0));
+    }
+    /* non-temporal stores are weakly ordered with respect to other stores */
+    asm volatile("sfence" ::: "memory");
+}
+#endif
+
 /* Initialises MSRs required to setup sysenter and sysexit */
 void init_sysenter_msrs(void);
 
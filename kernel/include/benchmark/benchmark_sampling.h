@@ -0,0 +1,26 @@
+/*
+ * Copyright 2020, Data61, CSIRO (ABN 41 687 119 230)
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#pragma once
+
+#include <config.h>
+#include <sel4/benchmark_sampling_types.h>
+#include <sel4/arch/constants.h>
+#include <model/statedata.h>
+
+#ifdef CONFIG_BENCHMARK_SAMPLING_PROFILER
+/**
+ * @brief Empty the sample ring of every core and start sampling
+ *
+ */
+void benchmark_sampling_reset(void);
+
+/**
+ * @brief Record a sample of the current thread into this core's ring
+ *
+ */
+void benchmark_sampling_record(void);
+#endif /* CONFIG_BENCHMARK_SAMPLING_PROFILER */
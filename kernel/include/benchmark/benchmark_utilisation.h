@@ -13,11 +13,33 @@
 #include <model/statedata.h>
 
 #ifdef CONFIG_BENCHMARK_TRACK_UTILISATION
-extern timestamp_t ksEnter;
 
 void benchmark_track_utilisation_dump(void);
 
 void benchmark_track_reset_utilisation(tcb_t *tcb);
+
+#if CONFIG_BENCHMARK_TRACK_UTILISATION_PMU_COUNTERS > 0
+/* Start counting PMU events for a thread that is about to run */
+static inline void benchmark_utilisation_pmu_start(tcb_t *tcb)
+{
+    for (word_t i = 0; i < CONFIG_BENCHMARK_TRACK_UTILISATION_PMU_COUNTERS; i++) {
+        tcb->benchmark.pmu_start[i] = benchmark_read_event_counter(i);
+    }
+}
+
+/* Charge the events counted since heir was scheduled to heir, and start
+ * counting for next. The counters keep running and the counter selection is
+ * preserved, so user level readings of them are unaffected. */
+static inline void benchmark_utilisation_pmu_switch(tcb_t *heir, tcb_t *next)
+{
+    for (word_t i = 0; i < CONFIG_BENCHMARK_TRACK_UTILISATION_PMU_COUNTERS; i++) {
+        uint32_t now = benchmark_read_event_counter(i);
+        /* unsigned arithmetic accounts for a single wrap of the counter */
+        heir->benchmark.pmu_counters[i] += (uint32_t)(now - heir->benchmark.pmu_start[i]);
+        next->benchmark.pmu_start[i] = now;
+    }
+}
+#endif /* CONFIG_BENCHMARK_TRACK_UTILISATION_PMU_COUNTERS > 0 */
 /* Calculate and add the utilisation time from when the heir started to run i.e. scheduled
  * and until it's being kicked off
  */
@@ -27,22 +49,26 @@ static inline void benchmark_utilisation_switch(tcb_t *heir, tcb_t *next)
     if (likely(NODE_STATE(benchmark_log_utilisation_enabled))) {
 
         /* Check if an overflow occurred while we have been in the kernel */
-        if (likely(ksEnter > heir->benchmark.schedule_start_time)) {
+        if (likely(NODE_STATE(ksEnter) > heir->benchmark.schedule_start_time)) {
 
-            heir->benchmark.utilisation += (ksEnter - heir->benchmark.schedule_start_time);
+            heir->benchmark.utilisation += (NODE_STATE(ksEnter) - heir->benchmark.schedule_start_time);
 
         } else {
 #ifdef CONFIG_ARM_ENABLE_PMU_OVERFLOW_INTERRUPT
-            heir->benchmark.utilisation += (UINT32_MAX - heir->benchmark.schedule_start_time) + ksEnter;
+            heir->benchmark.utilisation += (UINT32_MAX - heir->benchmark.schedule_start_time) + NODE_STATE(ksEnter);
             armv_handleOverflowIRQ();
 #endif /* CONFIG_ARM_ENABLE_PMU_OVERFLOW_INTERRUPT */
         }
 
         /* Reset next thread utilisation */
-        next->benchmark.schedule_start_time = ksEnter;
+        next->benchmark.schedule_start_time = NODE_STATE(ksEnter);
         next->benchmark.number_schedules++;
         NODE_STATE(benchmark_kernel_number_schedules)++;
 
+#if CONFIG_BENCHMARK_TRACK_UTILISATION_PMU_COUNTERS > 0
+        benchmark_utilisation_pmu_switch(heir, next);
+#endif
+
     }
 }
 
@@ -54,7 +80,7 @@ static inline void benchmark_utilisation_finalise(void)
     /* Add the time between when NODE_STATE(ksCurThread), and benchmark finalise */
     benchmark_utilisation_switch(NODE_STATE(ksCurThread), NODE_STATE(ksIdleThread));
 
-    NODE_STATE(benchmark_end_time) = ksEnter;
+    NODE_STATE(benchmark_end_time) = NODE_STATE(ksEnter);
     NODE_STATE(benchmark_log_utilisation_enabled) = false;
 }
 
@@ -16,6 +16,12 @@ typedef struct {
     uint64_t    number_schedules;
     uint64_t    kernel_utilisation;
     uint64_t    number_kernel_entries;
+#if CONFIG_BENCHMARK_TRACK_UTILISATION_PMU_COUNTERS > 0
+    /* PMU event counter values when the thread was last scheduled */
+    uint32_t    pmu_start[CONFIG_BENCHMARK_TRACK_UTILISATION_PMU_COUNTERS];
+    /* Events counted while the thread was scheduled */
+    uint64_t    pmu_counters[CONFIG_BENCHMARK_TRACK_UTILISATION_PMU_COUNTERS];
+#endif
 
 } benchmark_util_t;
 #endif /* CONFIG_BENCHMARK_TRACK_UTILISATION */
@@ -116,3 +116,61 @@ static inline reply_t *thread_state_get_replyObject_np(thread_state_t ts)
 
 #include <arch/fastpath/fastpath.h>
 
+#ifdef CONFIG_FASTPATH_LONG_MESSAGES
+/* Replaces fastpath_mi_check when long messages are enabled. Only checks that
+ * there are no extra caps and the length is valid, as messages longer than
+ * the message registers are handled using the IPC buffers. */
+static inline int fastpath_mi_check_long(word_t msgInfo)
+{
+    seL4_MessageInfo_t info = messageInfoFromWord_raw(msgInfo);
+
+    return seL4_MessageInfo_get_extraCaps(info) != 0 ||
+           seL4_MessageInfo_get_length(info) > seL4_MsgMaxLength;
+}
+
+/* Copy the words of a message that are passed in the IPC buffer. IPC buffers
+ * are aligned to their size, so two buffers are either the same or disjoint.
+ * Copying in blocks of words lets the compiler use paired or wider loads and
+ * stores where the architecture has them. */
+static inline void fastpath_copy_buffer_words(word_t n, const word_t *restrict src,
+                                              word_t *restrict dest)
+{
+    word_t i;
+
+    if (unlikely(src == dest)) {
+        return;
+    }
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        word_t w0 = src[i];
+        word_t w1 = src[i + 1];
+        word_t w2 = src[i + 2];
+        word_t w3 = src[i + 3];
+        dest[i] = w0;
+        dest[i + 1] = w1;
+        dest[i + 2] = w2;
+        dest[i + 3] = w3;
+    }
+    for (; i < n; i++) {
+        dest[i] = src[i];
+    }
+}
+
+/* As fastpath_copy_mrs, but for messages of any length. The buffers are only
+ * used, and must only be non-NULL, when the message is longer than the
+ * message registers. */
+static inline void fastpath_copy_mrs_long(word_t length, tcb_t *src, word_t *sendBuf,
+                                          tcb_t *dest, word_t *recvBuf)
+{
+    if (likely(length <= n_msgRegisters)) {
+        fastpath_copy_mrs(length, src, dest);
+        return;
+    }
+
+    fastpath_copy_mrs(n_msgRegisters, src, dest);
+    /* the first word of the IPC buffer is the message tag */
+    fastpath_copy_buffer_words(length - n_msgRegisters, sendBuf + n_msgRegisters + 1,
+                               recvBuf + n_msgRegisters + 1);
+}
+#endif /* CONFIG_FASTPATH_LONG_MESSAGES */
+
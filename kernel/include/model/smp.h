@@ -23,5 +23,15 @@ extern smpStatedata_t ksSMP[CONFIG_MAX_NUM_NODES];
 
 void migrateTCB(tcb_t *tcb, word_t new_core);
 
+#ifdef CONFIG_SMP_LOAD_BALANCING
+/* Take the highest priority migratable thread waiting on the core with the
+ * most of them, moving it to the current core. Returns NULL if there is none. */
+tcb_t *balancePullThread(void);
+
+/* Ask an idle core to take a thread if any core has migratable threads
+ * waiting. The IPI is sent with the other pending reschedule IPIs. */
+void balanceKickIdleCore(void);
+#endif /* CONFIG_SMP_LOAD_BALANCING */
+
 #endif /* ENABLE_SMP_SUPPORT */
 
@@ -11,6 +11,7 @@
 #include <object/structures.h>
 #include <object/tcb.h>
 #include <mode/types.h>
+#include <sel4/benchmark_track_types.h>
 
 #ifdef ENABLE_SMP_SUPPORT
 #define NODE_STATE_BEGIN(_name)                 typedef struct _name {
@@ -88,6 +89,20 @@ NODE_STATE_DECLARE(timestamp_t, benchmark_kernel_time);
 NODE_STATE_DECLARE(timestamp_t, benchmark_kernel_number_entries);
 NODE_STATE_DECLARE(timestamp_t, benchmark_kernel_number_schedules);
 #endif /* CONFIG_BENCHMARK_TRACK_UTILISATION */
+#if defined(CONFIG_DEBUG_BUILD) || defined(CONFIG_BENCHMARK_TRACK_KERNEL_ENTRIES)
+/* Details of the current kernel entry on this core */
+NODE_STATE_DECLARE(kernel_entry_t, ksKernelEntry);
+#endif
+#if defined(CONFIG_BENCHMARK_TRACK_KERNEL_ENTRIES) || defined(CONFIG_BENCHMARK_TRACK_UTILISATION)
+/* Time at which this core entered the kernel */
+NODE_STATE_DECLARE(timestamp_t, ksEnter);
+#endif
+#ifdef CONFIG_SMP_LOAD_BALANCING
+/* Number of migratable threads in each domain's ready queues on this core */
+NODE_STATE_DECLARE(word_t, ksNumMigratableQueued[CONFIG_NUM_DOMAINS]);
+/* Set when another core has asked this idle core to take one of its threads */
+NODE_STATE_DECLARE(bool_t, ksBalanceRequested);
+#endif /* CONFIG_SMP_LOAD_BALANCING */
 
 NODE_STATE_END(nodeState);
 
@@ -293,6 +293,11 @@ struct tcb {
     word_t tcbAffinity;
 #endif /* ENABLE_SMP_SUPPORT */
 
+#ifdef CONFIG_SMP_LOAD_BALANCING
+    /* whether idle cores may take this thread from its core's ready queue, 1 word */
+    word_t tcbMigratable;
+#endif
+
     /* Previous and next pointers for scheduler queues , 2 words */
     struct tcb *tcbSchedNext;
     struct tcb *tcbSchedPrev;
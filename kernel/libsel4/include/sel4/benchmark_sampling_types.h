@@ -0,0 +1,52 @@
+/*
+ * Copyright 2020, Data61, CSIRO (ABN 41 687 119 230)
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef HAVE_AUTOCONF
+#include <autoconf.h>
+#endif
+
+#ifdef CONFIG_BENCHMARK_SAMPLING_PROFILER
+
+#define seL4_SampleNameLength 16
+
+/* A sample of the thread that was running when the kernel timer fired */
+typedef struct benchmark_sample {
+    /* Kernel address of the sampled TCB, used to tell threads apart */
+    seL4_Word tcb;
+    /* User PC of the thread, or 0 if the idle thread was running */
+    seL4_Word pc;
+    /* Number of valid entries in frames */
+    seL4_Word depth;
+    /* Return addresses found by following the user frame pointer chain,
+     * innermost first */
+    seL4_Word frames[CONFIG_BENCHMARK_SAMPLE_STACK_DEPTH];
+#ifdef CONFIG_DEBUG_BUILD
+    /* Start of the thread's name, not NULL terminated if it is truncated */
+    char name[seL4_SampleNameLength];
+#endif
+} benchmark_sample_t;
+
+/* The log buffer is split into one ring of samples per core, each starting
+ * with this header. It works the same way as the kernel entry trace rings:
+ * the kernel advances head, user level advances tail and samples taken while
+ * the ring is full are counted in dropped. */
+typedef struct benchmark_sample_ring {
+    seL4_Word head;
+    seL4_Word dropped;
+    seL4_Word mask;
+    /* Written by user level, kept apart from the kernel written fields */
+    seL4_Word tail __attribute__((aligned(64)));
+    benchmark_sample_t samples[] __attribute__((aligned(64)));
+} benchmark_sample_ring_t;
+
+/* Size of each core's ring within the log buffer */
+#define seL4_SampleRingSize ((seL4_LogBufferSize / CONFIG_MAX_NUM_NODES) & ~0x3fUL)
+
+#endif /* CONFIG_BENCHMARK_SAMPLING_PROFILER */
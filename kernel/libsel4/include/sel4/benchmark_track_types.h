@@ -64,5 +64,24 @@ typedef struct benchmark_syscall_log_entry {
     kernel_entry_t entry;
 } benchmark_track_kernel_entry_t;
 
+#ifdef CONFIG_BENCHMARK_TRACK_KERNEL_ENTRIES_RING
+/* In ring mode the log buffer is split into one ring per core, each starting
+ * with this header. The kernel advances head as it records entries and user
+ * level advances tail once it has consumed them. Both indices are free
+ * running and masked with mask to find an entry. Entries that arrive while a
+ * ring is full are counted in dropped rather than overwriting unread ones. */
+typedef struct benchmark_track_ring {
+    seL4_Word head;
+    seL4_Word dropped;
+    seL4_Word mask;
+    /* Written by user level, kept apart from the kernel written fields */
+    seL4_Word tail __attribute__((aligned(64)));
+    benchmark_track_kernel_entry_t entries[] __attribute__((aligned(64)));
+} benchmark_track_ring_t;
+
+/* Size of each core's ring within the log buffer */
+#define seL4_LogRingSize ((seL4_LogBufferSize / CONFIG_MAX_NUM_NODES) & ~0x3fUL)
+#endif /* CONFIG_BENCHMARK_TRACK_KERNEL_ENTRIES_RING */
+
 #endif /* CONFIG_BENCHMARK_TRACK_KERNEL_ENTRIES || CONFIG_DEBUG_BUILD */
 
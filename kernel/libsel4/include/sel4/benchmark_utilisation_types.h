@@ -42,6 +42,12 @@ enum benchmark_track_util_ipc_index {
     BENCHMARK_TOTAL_KERNEL_UTILISATION,
     /* Total number of times the kernel is entered on the current core */
     BENCHMARK_TOTAL_NUMBER_KERNEL_ENTRIES,
+
+#if CONFIG_BENCHMARK_TRACK_UTILISATION_PMU_COUNTERS > 0
+    /* Events counted by PMU event counter 0 while the thread was scheduled,
+     * followed by one entry for each further tracked counter */
+    BENCHMARK_TCB_PMU_COUNTERS,
+#endif
 };
 
 #endif /* CONFIG_BENCHMARK_TRACK_UTILISATION */
@@ -184,7 +184,8 @@ seL4_DebugRun(void (* userfn)(void *), void *userarg);
  * The behaviour of this system call depends on benchmarking mode in action while invoking
  * this system call:
  *    1. `BENCHMARK_TRACEPOINTS`: resets the log index to 0,
- *    2. `BENCHMARK_TRACK_KERNEL_ENTRIES`:  as above,
+ *    2. `BENCHMARK_TRACK_KERNEL_ENTRIES`:  as above. With `BENCHMARK_TRACK_KERNEL_ENTRIES_RING`,
+ *        empties the trace ring of every core and starts recording into them,
  *    3. `BENCHMARK_TRACK_UTILISATION`: resets benchmark and current thread
  *        start time (to the time of invoking this syscall), resets idle
  *        thread utilisation to 0, and starts tracking utilisation.
@@ -10,6 +10,7 @@
 #include <arch/benchmark.h>
 #include <benchmark/benchmark_track.h>
 #include <benchmark/benchmark_utilisation.h>
+#include <benchmark/benchmark_sampling.h>
 #include <api/syscall.h>
 #include <api/failures.h>
 #include <api/faults.h>
@@ -211,14 +212,23 @@ exception_t handleUnknownSyscall(word_t w)
         }
 
         ksLogIndex = 0;
+#ifdef CONFIG_BENCHMARK_TRACK_KERNEL_ENTRIES_RING
+        benchmark_track_ring_reset();
+#endif
+#ifdef CONFIG_BENCHMARK_SAMPLING_PROFILER
+        benchmark_sampling_reset();
+#endif
 #endif /* CONFIG_KERNEL_LOG_BUFFER */
 #ifdef CONFIG_BENCHMARK_TRACK_UTILISATION
         NODE_STATE(benchmark_log_utilisation_enabled) = true;
         benchmark_track_reset_utilisation(NODE_STATE(ksIdleThread));
-        NODE_STATE(ksCurThread)->benchmark.schedule_start_time = ksEnter;
+        NODE_STATE(ksCurThread)->benchmark.schedule_start_time = NODE_STATE(ksEnter);
         NODE_STATE(ksCurThread)->benchmark.number_schedules++;
+#if CONFIG_BENCHMARK_TRACK_UTILISATION_PMU_COUNTERS > 0
+        benchmark_utilisation_pmu_start(NODE_STATE(ksCurThread));
+#endif
 
-        NODE_STATE(benchmark_start_time) = ksEnter;
+        NODE_STATE(benchmark_start_time) = NODE_STATE(ksEnter);
         NODE_STATE(benchmark_kernel_time) = 0;
         NODE_STATE(benchmark_kernel_number_entries) = 0;
         NODE_STATE(benchmark_kernel_number_schedules) = 1;
@@ -2448,7 +2448,7 @@ void kernelDataAbort(word_t pc)
 }
 #endif
 
-#ifdef CONFIG_PRINTING
+#if defined(CONFIG_PRINTING) || defined(CONFIG_BENCHMARK_SAMPLING_PROFILER)
 typedef struct readWordFromVSpace_ret {
     exception_t status;
     word_t value;
@@ -2477,7 +2477,43 @@ static readWordFromVSpace_ret_t readWordFromVSpace(vspace_root_t *pd, word_t vad
     ret.value = *value;
     return ret;
 }
+#endif
+
+#ifdef CONFIG_BENCHMARK_SAMPLING_PROFILER
+word_t Arch_userStackWalk(tcb_t *tptr, word_t *frames, word_t max_frames)
+{
+    cap_t threadRoot;
+    vspace_root_t *vspaceRoot;
+    word_t fp;
+    word_t depth = 0;
+
+    threadRoot = TCB_PTR_CTE_PTR(tptr, tcbVTable)->cap;
+    if (cap_get_capType(threadRoot) != cap_vtable_root_cap) {
+        return 0;
+    }
+    vspaceRoot = cap_vtable_root_get_basePtr(threadRoot);
+
+    /* Each frame record holds the caller's frame pointer followed by the
+     * return address. Callers' records are at higher addresses, so stop
+     * if the chain doesn't move up the stack. */
+    fp = getRegister(tptr, X29);
+    while (depth < max_frames && fp != 0 && IS_ALIGNED(fp, seL4_WordSizeBits)) {
+        readWordFromVSpace_ret_t next = readWordFromVSpace(vspaceRoot, fp);
+        readWordFromVSpace_ret_t ret = readWordFromVSpace(vspaceRoot, fp + sizeof(word_t));
+        if (next.status != EXCEPTION_NONE || ret.status != EXCEPTION_NONE) {
+            break;
+        }
+        frames[depth++] = ret.value;
+        if (next.value <= fp) {
+            break;
+        }
+        fp = next.value;
+    }
+    return depth;
+}
+#endif
 
+#ifdef CONFIG_PRINTING
 void Arch_userStackTrace(tcb_t *tptr)
 {
     cap_t threadRoot;
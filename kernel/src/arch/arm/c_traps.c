@@ -22,8 +22,8 @@ void VISIBLE NORETURN c_handle_undefined_instruction(void)
     c_entry_hook();
 
 #ifdef TRACK_KERNEL_ENTRIES
-    ksKernelEntry.path = Entry_UserLevelFault;
-    ksKernelEntry.word = getRegister(NODE_STATE(ksCurThread), NextIP);
+    NODE_STATE(ksKernelEntry).path = Entry_UserLevelFault;
+    NODE_STATE(ksKernelEntry).word = getRegister(NODE_STATE(ksCurThread), NextIP);
 #endif
 
 #if defined(CONFIG_HAVE_FPU) && defined(CONFIG_ARCH_AARCH32)
@@ -68,8 +68,8 @@ static inline void NORETURN c_handle_vm_fault(vm_fault_type_t type)
     c_entry_hook();
 
 #ifdef TRACK_KERNEL_ENTRIES
-    ksKernelEntry.path = Entry_VMFault;
-    ksKernelEntry.word = getRegister(NODE_STATE(ksCurThread), NextIP);
+    NODE_STATE(ksKernelEntry).path = Entry_VMFault;
+    NODE_STATE(ksKernelEntry).word = getRegister(NODE_STATE(ksCurThread), NextIP);
 #endif
 
     handleVMFaultEvent(type);
@@ -93,10 +93,10 @@ void VISIBLE NORETURN c_handle_interrupt(void)
     c_entry_hook();
 
 #ifdef TRACK_KERNEL_ENTRIES
-    ksKernelEntry.path = Entry_Interrupt;
-    ksKernelEntry.word = IRQT_TO_IRQ(getActiveIRQ());
+    NODE_STATE(ksKernelEntry).path = Entry_Interrupt;
+    NODE_STATE(ksKernelEntry).word = IRQT_TO_IRQ(getActiveIRQ());
 #ifdef ENABLE_SMP_SUPPORT
-    ksKernelEntry.core = getCurrentCPUIndex();
+    NODE_STATE(ksKernelEntry).core = getCurrentCPUIndex();
 #endif
 #endif
 
@@ -108,13 +108,13 @@ void NORETURN slowpath(syscall_t syscall)
 {
     if (unlikely(syscall < SYSCALL_MIN || syscall > SYSCALL_MAX)) {
 #ifdef TRACK_KERNEL_ENTRIES
-        ksKernelEntry.path = Entry_UnknownSyscall;
+        NODE_STATE(ksKernelEntry).path = Entry_UnknownSyscall;
         /* ksKernelEntry.word word is already set to syscall */
 #endif /* TRACK_KERNEL_ENTRIES */
         handleUnknownSyscall(syscall);
     } else {
 #ifdef TRACK_KERNEL_ENTRIES
-        ksKernelEntry.is_fastpath = 0;
+        NODE_STATE(ksKernelEntry).is_fastpath = 0;
 #endif /* TRACK KERNEL ENTRIES */
         handleSyscall(syscall);
     }
@@ -130,9 +130,16 @@ void VISIBLE c_handle_syscall(word_t cptr, word_t msgInfo, syscall_t syscall)
     c_entry_hook();
 #ifdef TRACK_KERNEL_ENTRIES
     benchmark_debug_syscall_start(cptr, msgInfo, syscall);
-    ksKernelEntry.is_fastpath = 0;
+    NODE_STATE(ksKernelEntry).is_fastpath = 0;
 #endif /* DEBUG */
 
+#ifdef CONFIG_SIGNAL_FASTPATH
+    if (syscall == (syscall_t)SysSend) {
+        fastpath_signal(cptr, msgInfo);
+        UNREACHABLE();
+    }
+#endif /* CONFIG_SIGNAL_FASTPATH */
+
     slowpath(syscall);
     UNREACHABLE();
 }
@@ -146,7 +153,7 @@ void VISIBLE c_handle_fastpath_call(word_t cptr, word_t msgInfo)
     c_entry_hook();
 #ifdef TRACK_KERNEL_ENTRIES
     benchmark_debug_syscall_start(cptr, msgInfo, SysCall);
-    ksKernelEntry.is_fastpath = 1;
+    NODE_STATE(ksKernelEntry).is_fastpath = 1;
 #endif /* DEBUG */
 
     fastpath_call(cptr, msgInfo);
@@ -165,7 +172,7 @@ void VISIBLE c_handle_fastpath_reply_recv(word_t cptr, word_t msgInfo)
     c_entry_hook();
 #ifdef TRACK_KERNEL_ENTRIES
     benchmark_debug_syscall_start(cptr, msgInfo, SysReplyRecv);
-    ksKernelEntry.is_fastpath = 1;
+    NODE_STATE(ksKernelEntry).is_fastpath = 1;
 #endif /* DEBUG */
 
 #ifdef CONFIG_KERNEL_MCS
@@ -186,8 +193,8 @@ VISIBLE NORETURN void c_handle_vcpu_fault(word_t hsr)
     c_entry_hook();
 
 #ifdef TRACK_KERNEL_ENTRIES
-    ksKernelEntry.path = Entry_VCPUFault;
-    ksKernelEntry.word = hsr;
+    NODE_STATE(ksKernelEntry).path = Entry_VCPUFault;
+    NODE_STATE(ksKernelEntry).word = hsr;
 #endif
     handleVCPUFault(hsr);
     restore_user_context();
@@ -129,6 +129,9 @@ static void NORETURN restore_vmx(void)
 void VISIBLE NORETURN restore_user_context(void)
 {
     NODE_UNLOCK_IF_HELD;
+    /* the fastpath may have left a context switch to finish, for example
+     * when it falls back to this function to return with iret */
+    SMP_COND_STATEMENT(finishDeferredSwitch());
     c_exit_hook();
 
     /* we've now 'exited' the kernel. If we have a pending interrupt
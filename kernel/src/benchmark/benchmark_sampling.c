@@ -0,0 +1,87 @@
+/*
+ * Copyright 2020, Data61, CSIRO (ABN 41 687 119 230)
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#include <config.h>
+#include <benchmark/benchmark_sampling.h>
+#include <arch/machine.h>
+#include <arch/kernel/vspace.h>
+
+#ifdef CONFIG_BENCHMARK_SAMPLING_PROFILER
+
+/* The ring headers live in user writable memory, so the kernel keeps its own
+ * copy of each producer index and of the ring size. */
+static word_t ksSampleRingHead[CONFIG_MAX_NUM_NODES];
+static word_t ksSampleRingMask;
+
+static inline benchmark_sample_ring_t *benchmark_sample_ring(word_t core)
+{
+    return (benchmark_sample_ring_t *)(KS_LOG_PPTR + core * seL4_SampleRingSize);
+}
+
+void benchmark_sampling_reset(void)
+{
+    word_t entries = (seL4_SampleRingSize - sizeof(benchmark_sample_ring_t)) /
+                     sizeof(benchmark_sample_t);
+    /* Use a power of two number of samples so indices can be masked */
+    word_t size = 1;
+    while (size * 2 <= entries) {
+        size *= 2;
+    }
+    ksSampleRingMask = size - 1;
+
+    for (word_t core = 0; core < CONFIG_MAX_NUM_NODES; core++) {
+        benchmark_sample_ring_t *ring = benchmark_sample_ring(core);
+        ksSampleRingHead[core] = 0;
+        ring->head = 0;
+        ring->dropped = 0;
+        ring->mask = ksSampleRingMask;
+        ring->tail = 0;
+    }
+}
+
+void benchmark_sampling_record(void)
+{
+    /* The rings are only initialised once the log has been reset */
+    if (unlikely(ksUserLogBuffer == 0 || ksSampleRingMask == 0)) {
+        return;
+    }
+
+    word_t core = CURRENT_CPU_INDEX();
+    benchmark_sample_ring_t *ring = benchmark_sample_ring(core);
+    word_t head = ksSampleRingHead[core];
+    word_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+    if (unlikely(head - tail > ksSampleRingMask)) {
+        ring->dropped++;
+        return;
+    }
+
+    tcb_t *tcb = NODE_STATE(ksCurThread);
+    benchmark_sample_t *sample = &ring->samples[head & ksSampleRingMask];
+    sample->tcb = (word_t) tcb;
+    if (tcb == NODE_STATE(ksIdleThread)) {
+        sample->pc = 0;
+        sample->depth = 0;
+    } else {
+        sample->pc = getRestartPC(tcb);
+        sample->depth = Arch_userStackWalk(tcb, sample->frames, CONFIG_BENCHMARK_SAMPLE_STACK_DEPTH);
+    }
+#ifdef CONFIG_DEBUG_BUILD
+    const char *name = TCB_PTR_DEBUG_PTR(tcb)->tcbName;
+    for (word_t i = 0; i < seL4_SampleNameLength; i++) {
+        sample->name[i] = name[i];
+        if (name[i] == '\0') {
+            break;
+        }
+    }
+#endif
+
+    /* Publish the sample only after it has been written */
+    ksSampleRingHead[core] = head + 1;
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+#endif /* CONFIG_BENCHMARK_SAMPLING_PROFILER */
@@ -10,25 +10,87 @@
 
 #ifdef CONFIG_BENCHMARK_TRACK_KERNEL_ENTRIES
 
-timestamp_t ksEnter;
 seL4_Word ksLogIndex;
 seL4_Word ksLogIndexFinalized;
 
+#ifdef CONFIG_BENCHMARK_TRACK_KERNEL_ENTRIES_RING
+/* The ring headers live in user writable memory, so the kernel keeps its own
+ * copy of each producer index and of the ring size and never uses the values
+ * in the buffer to index it. */
+static word_t ksLogRingHead[CONFIG_MAX_NUM_NODES];
+static word_t ksLogRingMask;
+
+static inline benchmark_track_ring_t *benchmark_track_ring(word_t core)
+{
+    return (benchmark_track_ring_t *)(KS_LOG_PPTR + core * seL4_LogRingSize);
+}
+
+void benchmark_track_ring_reset(void)
+{
+    word_t entries = (seL4_LogRingSize - sizeof(benchmark_track_ring_t)) /
+                     sizeof(benchmark_track_kernel_entry_t);
+    /* Use a power of two number of entries so indices can be masked */
+    word_t size = 1;
+    while (size * 2 <= entries) {
+        size *= 2;
+    }
+    ksLogRingMask = size - 1;
+
+    for (word_t core = 0; core < CONFIG_MAX_NUM_NODES; core++) {
+        benchmark_track_ring_t *ring = benchmark_track_ring(core);
+        ksLogRingHead[core] = 0;
+        ring->head = 0;
+        ring->dropped = 0;
+        ring->mask = ksLogRingMask;
+        ring->tail = 0;
+    }
+}
+
+static inline void benchmark_track_ring_exit(timestamp_t ksExit)
+{
+    word_t core = CURRENT_CPU_INDEX();
+    benchmark_track_ring_t *ring = benchmark_track_ring(core);
+    word_t head = ksLogRingHead[core];
+    word_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+    if (unlikely(head - tail > ksLogRingMask)) {
+        ring->dropped++;
+        return;
+    }
+
+    benchmark_track_kernel_entry_t *entry = &ring->entries[head & ksLogRingMask];
+    entry->entry = NODE_STATE(ksKernelEntry);
+    entry->start_time = NODE_STATE(ksEnter);
+    entry->duration = ksExit - NODE_STATE(ksEnter);
+
+    /* Publish the entry only after it has been written */
+    ksLogRingHead[core] = head + 1;
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+#endif /* CONFIG_BENCHMARK_TRACK_KERNEL_ENTRIES_RING */
+
 void benchmark_track_exit(void)
 {
-    timestamp_t duration = 0;
     timestamp_t ksExit = timestamp();
+
+#ifdef CONFIG_BENCHMARK_TRACK_KERNEL_ENTRIES_RING
+    /* The rings are only initialised once the log has been reset */
+    if (likely(ksUserLogBuffer != 0 && ksLogRingMask != 0)) {
+        benchmark_track_ring_exit(ksExit);
+    }
+#else
     benchmark_track_kernel_entry_t *ksLog = (benchmark_track_kernel_entry_t *) KS_LOG_PPTR;
 
     if (likely(ksUserLogBuffer != 0)) {
         /* If Log buffer is filled, do nothing */
         if (likely(ksLogIndex < MAX_LOG_SIZE)) {
-            duration = ksExit - ksEnter;
-            ksLog[ksLogIndex].entry = ksKernelEntry;
-            ksLog[ksLogIndex].start_time = ksEnter;
+            timestamp_t duration = ksExit - NODE_STATE(ksEnter);
+            ksLog[ksLogIndex].entry = NODE_STATE(ksKernelEntry);
+            ksLog[ksLogIndex].start_time = NODE_STATE(ksEnter);
             ksLog[ksLogIndex].duration = duration;
             ksLogIndex++;
         }
     }
+#endif /* CONFIG_BENCHMARK_TRACK_KERNEL_ENTRIES_RING */
 }
 #endif /* CONFIG_BENCHMARK_TRACK_KERNEL_ENTRIES */
@@ -9,8 +9,6 @@
 
 #ifdef CONFIG_BENCHMARK_TRACK_UTILISATION
 
-timestamp_t ksEnter;
-
 void benchmark_track_utilisation_dump(void)
 {
     uint64_t *buffer = ((uint64_t *) & (((seL4_IPCBuffer *)lookupIPCBuffer(true, NODE_STATE(ksCurThread)))->msg[0]));
@@ -65,6 +63,13 @@ void benchmark_track_utilisation_dump(void)
     buffer[BENCHMARK_TOTAL_KERNEL_UTILISATION] = NODE_STATE(benchmark_kernel_time);
     buffer[BENCHMARK_TOTAL_NUMBER_KERNEL_ENTRIES] = NODE_STATE(benchmark_kernel_number_entries);
 
+#if CONFIG_BENCHMARK_TRACK_UTILISATION_PMU_COUNTERS > 0
+    /* Selected TCB PMU event counters */
+    for (word_t i = 0; i < CONFIG_BENCHMARK_TRACK_UTILISATION_PMU_COUNTERS; i++) {
+        buffer[BENCHMARK_TCB_PMU_COUNTERS + i] = tcb->benchmark.pmu_counters[i];
+    }
+#endif
+
 }
 
 void benchmark_track_reset_utilisation(tcb_t *tcb)
@@ -74,5 +79,10 @@ void benchmark_track_reset_utilisation(tcb_t *tcb)
     tcb->benchmark.number_kernel_entries = 0;
     tcb->benchmark.kernel_utilisation = 0;
     tcb->benchmark.schedule_start_time = 0;
+#if CONFIG_BENCHMARK_TRACK_UTILISATION_PMU_COUNTERS > 0
+    for (word_t i = 0; i < CONFIG_BENCHMARK_TRACK_UTILISATION_PMU_COUNTERS; i++) {
+        tcb->benchmark.pmu_counters[i] = 0;
+    }
+#endif
 }
 #endif /* CONFIG_BENCHMARK_TRACK_UTILISATION */
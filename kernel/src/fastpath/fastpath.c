@@ -14,6 +14,9 @@
 #include <benchmark/benchmark_track.h>
 #endif
 #include <benchmark/benchmark_utilisation.h>
+#ifdef CONFIG_FASTPATH_LONG_MESSAGES
+#include <arch/kernel/vspace.h>
+#endif
 
 #ifdef CONFIG_ARCH_ARM
 static inline
@@ -42,7 +45,11 @@ void NORETURN fastpath_call(word_t cptr, word_t msgInfo)
 
     /* Check there's no extra caps, the length is ok and there's no
      * saved fault. */
+#ifdef CONFIG_FASTPATH_LONG_MESSAGES
+    if (unlikely(fastpath_mi_check_long(msgInfo) ||
+#else
     if (unlikely(fastpath_mi_check(msgInfo) ||
+#endif
                  fault_type != seL4_Fault_NullFault)) {
         slowpath(SysCall);
     }
@@ -153,6 +160,20 @@ void NORETURN fastpath_call(word_t cptr, word_t msgInfo)
     }
 #endif /* ENABLE_SMP_SUPPORT */
 
+#ifdef CONFIG_FASTPATH_LONG_MESSAGES
+    /* Words beyond the message registers are copied between the IPC buffers,
+     * so both threads need a valid one */
+    word_t *sendBuf = NULL;
+    word_t *recvBuf = NULL;
+    if (unlikely(length > n_msgRegisters)) {
+        sendBuf = lookupIPCBuffer(false, NODE_STATE(ksCurThread));
+        recvBuf = lookupIPCBuffer(true, dest);
+        if (unlikely(sendBuf == NULL || recvBuf == NULL)) {
+            slowpath(SysCall);
+        }
+    }
+#endif
+
     /*
      * --- POINT OF NO RETURN ---
      *
@@ -160,7 +181,7 @@ void NORETURN fastpath_call(word_t cptr, word_t msgInfo)
      */
 
 #ifdef CONFIG_BENCHMARK_TRACK_KERNEL_ENTRIES
-    ksKernelEntry.is_fastpath = true;
+    NODE_STATE(ksKernelEntry).is_fastpath = true;
 #endif
 
     /* Dequeue the destination. */
@@ -209,7 +230,11 @@ void NORETURN fastpath_call(word_t cptr, word_t msgInfo)
         &replySlot->cteMDBNode, CTE_REF(callerSlot), 1, 1);
 #endif
 
+#ifdef CONFIG_FASTPATH_LONG_MESSAGES
+    fastpath_copy_mrs_long(length, NODE_STATE(ksCurThread), sendBuf, dest, recvBuf);
+#else
     fastpath_copy_mrs(length, NODE_STATE(ksCurThread), dest);
+#endif
 
     /* Dest thread is set Running, but not queued. */
     thread_state_ptr_set_tsType_np(&dest->tcbState,
@@ -254,7 +279,11 @@ void NORETURN fastpath_reply_recv(word_t cptr, word_t msgInfo)
 
     /* Check there's no extra caps, the length is ok and there's no
      * saved fault. */
+#ifdef CONFIG_FASTPATH_LONG_MESSAGES
+    if (unlikely(fastpath_mi_check_long(msgInfo) ||
+#else
     if (unlikely(fastpath_mi_check(msgInfo) ||
+#endif
                  fault_type != seL4_Fault_NullFault)) {
         slowpath(SysReplyRecv);
     }
@@ -394,6 +423,20 @@ void NORETURN fastpath_reply_recv(word_t cptr, word_t msgInfo)
     }
 #endif /* ENABLE_SMP_SUPPORT */
 
+#ifdef CONFIG_FASTPATH_LONG_MESSAGES
+    /* Words beyond the message registers are copied between the IPC buffers,
+     * so both threads need a valid one */
+    word_t *sendBuf = NULL;
+    word_t *recvBuf = NULL;
+    if (unlikely(length > n_msgRegisters)) {
+        sendBuf = lookupIPCBuffer(false, NODE_STATE(ksCurThread));
+        recvBuf = lookupIPCBuffer(true, caller);
+        if (unlikely(sendBuf == NULL || recvBuf == NULL)) {
+            slowpath(SysReplyRecv);
+        }
+    }
+#endif
+
 #ifdef CONFIG_KERNEL_MCS
     /* not possible to set reply object and not be blocked */
     assert(thread_state_get_replyObject(NODE_STATE(ksCurThread)->tcbState) == 0);
@@ -406,7 +449,7 @@ void NORETURN fastpath_reply_recv(word_t cptr, word_t msgInfo)
      */
 
 #ifdef CONFIG_BENCHMARK_TRACK_KERNEL_ENTRIES
-    ksKernelEntry.is_fastpath = true;
+    NODE_STATE(ksKernelEntry).is_fastpath = true;
 #endif
 
     /* Set thread state to BlockedOnReceive */
@@ -481,7 +524,11 @@ void NORETURN fastpath_reply_recv(word_t cptr, word_t msgInfo)
     /* Replies don't have a badge. */
     badge = 0;
 
+#ifdef CONFIG_FASTPATH_LONG_MESSAGES
+    fastpath_copy_mrs_long(length, NODE_STATE(ksCurThread), sendBuf, caller, recvBuf);
+#else
     fastpath_copy_mrs(length, NODE_STATE(ksCurThread), caller);
+#endif
 
     /* Dest thread is set Running, but not queued. */
     thread_state_ptr_set_tsType_np(&caller->tcbState,
@@ -492,3 +539,122 @@ void NORETURN fastpath_reply_recv(word_t cptr, word_t msgInfo)
 
     fastpath_restore(badge, msgInfo, NODE_STATE(ksCurThread));
 }
+
+#ifdef CONFIG_SIGNAL_FASTPATH
+#ifdef CONFIG_ARCH_ARM
+static inline
+#ifndef CONFIG_ARCH_ARM_V6
+FORCE_INLINE
+#endif
+#endif
+void NORETURN fastpath_signal(word_t cptr, word_t msgInfo)
+{
+    seL4_MessageInfo_t info;
+    cap_t ntfn_cap;
+    notification_t *ntfn_ptr;
+    word_t badge;
+    tcb_t *dest;
+
+    /* Extra caps are looked up by the slowpath even though signal ignores them */
+    info = messageInfoFromWord_raw(msgInfo);
+    if (unlikely(seL4_MessageInfo_get_extraCaps(info) != 0)) {
+        slowpath(SysSend);
+    }
+
+    /* Lookup the cap */
+    ntfn_cap = lookup_fp(TCB_PTR_CTE_PTR(NODE_STATE(ksCurThread), tcbCTable)->cap, cptr);
+
+    /* Check it's a notification we can send to */
+    if (unlikely(!cap_capType_equals(ntfn_cap, cap_notification_cap) ||
+                 !cap_notification_cap_get_capNtfnCanSend(ntfn_cap))) {
+        slowpath(SysSend);
+    }
+
+    ntfn_ptr = NTFN_PTR(cap_notification_cap_get_capNtfnPtr(ntfn_cap));
+    badge = cap_notification_cap_get_capNtfnBadge(ntfn_cap);
+
+    switch (notification_ptr_get_state(ntfn_ptr)) {
+    case NtfnState_Idle:
+        dest = TCB_PTR(notification_ptr_get_ntfnBoundTCB(ntfn_ptr));
+        /* Waking a bound thread requires cancelling its IPC */
+        if (unlikely(dest != NULL &&
+                     (thread_state_ptr_get_tsType(&dest->tcbState) == ThreadState_BlockedOnReceive
+#ifdef CONFIG_VTX
+                      || thread_state_ptr_get_tsType(&dest->tcbState) == ThreadState_RunningVM
+#endif
+                     ))) {
+            slowpath(SysSend);
+        }
+        notification_ptr_set_state(ntfn_ptr, NtfnState_Active);
+        notification_ptr_set_ntfnMsgIdentifier(ntfn_ptr, badge);
+        break;
+
+    case NtfnState_Active:
+        notification_ptr_set_ntfnMsgIdentifier(ntfn_ptr,
+                                               notification_ptr_get_ntfnMsgIdentifier(ntfn_ptr) | badge);
+        break;
+
+    case NtfnState_Waiting:
+        dest = TCB_PTR(notification_ptr_get_ntfnQueue_head(ntfn_ptr));
+
+        /* Only wake threads that won't preempt us, so the current thread
+         * keeps running without a trip through the scheduler */
+        if (unlikely(dest->tcbPriority > NODE_STATE(ksCurThread)->tcbPriority ||
+                     NODE_STATE(ksSchedulerAction) != SchedulerAction_ResumeCurrentThread)) {
+            slowpath(SysSend);
+        }
+
+        if (unlikely(dest->tcbDomain != ksCurDomain && maxDom)) {
+            slowpath(SysSend);
+        }
+
+#ifdef ENABLE_SMP_SUPPORT
+        if (unlikely(dest->tcbAffinity != getCurrentCPUIndex())) {
+            slowpath(SysSend);
+        }
+#endif /* ENABLE_SMP_SUPPORT */
+
+#ifdef CONFIG_KERNEL_MCS
+        /* Threads without their own runnable scheduling context may need
+         * one donated from the notification */
+        if (unlikely(dest->tcbSchedContext == NULL ||
+                     !sc_active(dest->tcbSchedContext) ||
+                     thread_state_get_tcbInReleaseQueue(dest->tcbState))) {
+            slowpath(SysSend);
+        }
+#endif
+
+        /* Dequeue the destination. */
+        notification_ptr_set_ntfnQueue_head(ntfn_ptr, TCB_REF(dest->tcbEPNext));
+        if (unlikely(dest->tcbEPNext)) {
+            dest->tcbEPNext->tcbEPPrev = NULL;
+        } else {
+            notification_ptr_set_ntfnQueue_tail(ntfn_ptr, 0);
+            notification_ptr_set_state(ntfn_ptr, NtfnState_Idle);
+        }
+
+        thread_state_ptr_set_tsType_np(&dest->tcbState, ThreadState_Running);
+        setRegister(dest, badgeRegister, badge);
+
+        /* This is where schedule() would place the woken thread: behind the
+         * current thread at the same priority, or at the head of its own
+         * lower priority queue */
+        if (dest->tcbPriority == NODE_STATE(ksCurThread)->tcbPriority) {
+            SCHED_APPEND(dest);
+        } else {
+            SCHED_ENQUEUE(dest);
+        }
+        break;
+
+    default:
+        slowpath(SysSend);
+    }
+
+#ifdef CONFIG_BENCHMARK_TRACK_KERNEL_ENTRIES
+    NODE_STATE(ksKernelEntry).is_fastpath = true;
+#endif
+
+    restore_user_context();
+    UNREACHABLE();
+}
+#endif /* CONFIG_SIGNAL_FASTPATH */
@@ -16,6 +16,7 @@
 #include <object/schedcontext.h>
 #endif
 #include <model/statedata.h>
+#include <model/smp.h>
 #include <arch/machine.h>
 #include <arch/kernel/thread.h>
 #include <machine/registerset.h>
@@ -385,6 +386,9 @@ void schedule(void)
     }
     NODE_STATE(ksSchedulerAction) = SchedulerAction_ResumeCurrentThread;
 #ifdef ENABLE_SMP_SUPPORT
+#ifdef CONFIG_SMP_LOAD_BALANCING
+    balanceKickIdleCore();
+#endif
     doMaskReschedule(ARCH_NODE_STATE(ipiReschedulePending));
     ARCH_NODE_STATE(ipiReschedulePending) = 0;
 #endif /* ENABLE_SMP_SUPPORT */
@@ -411,6 +415,10 @@ void chooseThread(void)
         dom = 0;
     }
 
+#ifdef CONFIG_SMP_LOAD_BALANCING
+    NODE_STATE(ksBalanceRequested) = false;
+#endif
+
     if (likely(NODE_STATE(ksReadyQueuesL1Bitmap[dom]))) {
         prio = getHighestPrio(dom);
         thread = NODE_STATE(ksReadyQueues)[ready_queues_index(dom, prio)].head;
@@ -422,6 +430,14 @@ void chooseThread(void)
 #endif
         switchToThread(thread);
     } else {
+#ifdef CONFIG_SMP_LOAD_BALANCING
+        /* Rather than idling, take a thread that is waiting on a busy core */
+        thread = balancePullThread();
+        if (thread != NULL) {
+            switchToThread(thread);
+            return;
+        }
+#endif
         switchToIdleThread();
     }
 }
@@ -7,6 +7,7 @@
 #include <config.h>
 #include <model/smp.h>
 #include <object/tcb.h>
+#include <kernel/thread.h>
 
 #ifdef ENABLE_SMP_SUPPORT
 
@@ -22,4 +23,96 @@ void migrateTCB(tcb_t *tcb, word_t new_core)
 #endif
 }
 
+#ifdef CONFIG_SMP_LOAD_BALANCING
+/* Only threads in the current domain may be pulled onto an idle core */
+static inline dom_t balanceDomain(void)
+{
+    if (CONFIG_NUM_DOMAINS > 1) {
+        return ksCurDomain;
+    } else {
+        return 0;
+    }
+}
+
+/* Find the highest priority migratable thread in a domain's ready queues of a core */
+static tcb_t *findMigratableThread(word_t core, dom_t dom)
+{
+    word_t l1 = NODE_STATE_ON_CORE(ksReadyQueuesL1Bitmap[dom], core);
+
+    while (l1) {
+        word_t l1index = wordBits - 1 - clzl(l1);
+        word_t l2 = NODE_STATE_ON_CORE(ksReadyQueuesL2Bitmap[dom][invert_l1index(l1index)], core);
+
+        while (l2) {
+            word_t l2index = wordBits - 1 - clzl(l2);
+            prio_t prio = l1index_to_prio(l1index) | l2index;
+            tcb_t *thread = NODE_STATE_ON_CORE(ksReadyQueues[ready_queues_index(dom, prio)], core).head;
+
+            for (; thread != NULL; thread = thread->tcbSchedNext) {
+                if (thread->tcbMigratable) {
+                    return thread;
+                }
+            }
+            l2 &= ~BIT(l2index);
+        }
+        l1 &= ~BIT(l1index);
+    }
+    return NULL;
+}
+
+tcb_t *balancePullThread(void)
+{
+    word_t cpu = getCurrentCPUIndex();
+    dom_t dom = balanceDomain();
+    word_t busiest = cpu;
+    word_t most = 0;
+    tcb_t *thread;
+
+    for (word_t i = 0; i < ksNumCPUs; i++) {
+        if (i != cpu && NODE_STATE_ON_CORE(ksNumMigratableQueued[dom], i) > most) {
+            most = NODE_STATE_ON_CORE(ksNumMigratableQueued[dom], i);
+            busiest = i;
+        }
+    }
+    if (most == 0) {
+        return NULL;
+    }
+
+    thread = findMigratableThread(busiest, dom);
+    assert(thread != NULL);
+    assert(isRunnable(thread));
+
+    tcbSchedDequeue(thread);
+    migrateTCB(thread, cpu);
+    return thread;
+}
+
+void balanceKickIdleCore(void)
+{
+    word_t cpu = getCurrentCPUIndex();
+    dom_t dom = balanceDomain();
+    word_t waiting = 0;
+
+    /* Threads may have been queued on other cores by this kernel entry */
+    for (word_t i = 0; i < ksNumCPUs; i++) {
+        waiting += NODE_STATE_ON_CORE(ksNumMigratableQueued[dom], i);
+    }
+    if (waiting == 0) {
+        return;
+    }
+
+    for (word_t i = 0; i < ksNumCPUs; i++) {
+        if (i == cpu || NODE_STATE_ON_CORE(ksCurThread, i) != NODE_STATE_ON_CORE(ksIdleThread, i)) {
+            continue;
+        }
+        /* Only one idle core needs to be on its way to take a thread */
+        if (!NODE_STATE_ON_CORE(ksBalanceRequested, i)) {
+            NODE_STATE_ON_CORE(ksBalanceRequested, i) = true;
+            ARCH_NODE_STATE(ipiReschedulePending) |= BIT(i);
+        }
+        return;
+    }
+}
+#endif /* CONFIG_SMP_LOAD_BALANCING */
+
 #endif /* ENABLE_SMP_SUPPORT */
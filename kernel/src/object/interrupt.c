@@ -19,6 +19,7 @@
 #include <model/statedata.h>
 #include <machine/timer.h>
 #include <smp/ipi.h>
+#include <benchmark/benchmark_sampling.h>
 
 exception_t decodeIRQControlInvocation(word_t invLabel, word_t length,
                                        cte_t *srcSlot, word_t *buffer)
@@ -83,7 +84,8 @@ exception_t invokeIRQControl(irq_t irq, cte_t *handlerSlot, cte_t *controlSlot)
     return EXCEPTION_NONE;
 }
 
-exception_t decodeIRQHandlerInvocation(word_t invLabel, irq_t irq)
+exception_t decodeIRQHandlerInvocation(word_t invLabel, word_t length, irq_t irq,
+                                       word_t *buffer)
 {
     switch (invLabel) {
     case IRQAckIRQ:
@@ -91,6 +93,53 @@ exception_t decodeIRQHandlerInvocation(word_t invLabel, irq_t irq)
         invokeIRQHandler_AckIRQ(irq);
         return EXCEPTION_NONE;
 
+    case IRQAckIRQs: {
+        cptr_t base;
+        word_t mask;
+
+        if (length < 2) {
+            userError("IRQHandler AckBatch: Truncated message.");
+            current_syscall_error.type = seL4_TruncatedMessage;
+            return EXCEPTION_SYSCALL_ERROR;
+        }
+        base = getSyscallArg(0, buffer);
+        mask = getSyscallArg(1, buffer);
+
+        /* Check every handler before acknowledging any of them */
+        for (word_t i = 0; i < wordBits; i++) {
+            lookupCap_ret_t lu_ret;
+
+            if (!(mask & BIT(i))) {
+                continue;
+            }
+            lu_ret = lookupCap(NODE_STATE(ksCurThread), base + i);
+            if (lu_ret.status != EXCEPTION_NONE) {
+                userError("IRQHandler AckBatch: Failed to lookup handler %lu.", (unsigned long)(base + i));
+                current_syscall_error.type = seL4_FailedLookup;
+                current_syscall_error.failedLookupWasSource = false;
+                return EXCEPTION_SYSCALL_ERROR;
+            }
+            if (cap_get_capType(lu_ret.cap) != cap_irq_handler_cap) {
+                userError("IRQHandler AckBatch: %lu is not an IRQ handler capability.", (unsigned long)(base + i));
+                current_syscall_error.type = seL4_InvalidArgument;
+                current_syscall_error.invalidArgumentNumber = 1;
+                return EXCEPTION_SYSCALL_ERROR;
+            }
+        }
+
+        /* Look the handlers up again rather than keeping their IRQs on the
+         * stack, the checks above guarantee these lookups succeed */
+        setThreadState(NODE_STATE(ksCurThread), ThreadState_Restart);
+        invokeIRQHandler_AckIRQ(irq);
+        for (word_t i = 0; i < wordBits; i++) {
+            if (mask & BIT(i)) {
+                cap_t cap = lookupCap(NODE_STATE(ksCurThread), base + i).cap;
+                invokeIRQHandler_AckIRQ(IDX_TO_IRQT(cap_irq_handler_cap_get_capIRQ(cap)));
+            }
+        }
+        return EXCEPTION_NONE;
+    }
+
     case IRQSetIRQHandler: {
         cap_t ntfnCap;
         cte_t *slot;
@@ -213,6 +262,9 @@ void handleInterrupt(irq_t irq)
     }
 
     case IRQTimer:
+#ifdef CONFIG_BENCHMARK_SAMPLING_PROFILER
+        benchmark_sampling_record();
+#endif
 #ifdef CONFIG_KERNEL_MCS
         ackDeadlineIRQ();
         NODE_STATE(ksReprogram) = true;
@@ -745,8 +745,9 @@ exception_t decodeInvocation(word_t invLabel, word_t length,
         return decodeIRQControlInvocation(invLabel, length, slot, buffer);
 
     case cap_irq_handler_cap:
-        return decodeIRQHandlerInvocation(invLabel,
-                                          IDX_TO_IRQT(cap_irq_handler_cap_get_capIRQ(cap)));
+        return decodeIRQHandlerInvocation(invLabel, length,
+                                          IDX_TO_IRQT(cap_irq_handler_cap_get_capIRQ(cap)),
+                                          buffer);
 
 #ifdef CONFIG_KERNEL_MCS
     case cap_sched_control_cap:
@@ -110,6 +110,11 @@ void tcbSchedEnqueue(tcb_t *tcb)
         NODE_STATE_ON_CORE(ksReadyQueues[idx], tcb->tcbAffinity) = queue;
 
         thread_state_ptr_set_tcbQueued(&tcb->tcbState, true);
+#ifdef CONFIG_SMP_LOAD_BALANCING
+        if (tcb->tcbMigratable) {
+            NODE_STATE_ON_CORE(ksNumMigratableQueued[tcb->tcbDomain], tcb->tcbAffinity)++;
+        }
+#endif
     }
 }
 
@@ -145,6 +150,11 @@ void tcbSchedAppend(tcb_t *tcb)
         NODE_STATE_ON_CORE(ksReadyQueues[idx], tcb->tcbAffinity) = queue;
 
         thread_state_ptr_set_tcbQueued(&tcb->tcbState, true);
+#ifdef CONFIG_SMP_LOAD_BALANCING
+        if (tcb->tcbMigratable) {
+            NODE_STATE_ON_CORE(ksNumMigratableQueued[tcb->tcbDomain], tcb->tcbAffinity)++;
+        }
+#endif
     }
 }
 
@@ -180,6 +190,11 @@ void tcbSchedDequeue(tcb_t *tcb)
         NODE_STATE_ON_CORE(ksReadyQueues[idx], tcb->tcbAffinity) = queue;
 
         thread_state_ptr_set_tcbQueued(&tcb->tcbState, false);
+#ifdef CONFIG_SMP_LOAD_BALANCING
+        if (tcb->tcbMigratable) {
+            NODE_STATE_ON_CORE(ksNumMigratableQueued[tcb->tcbDomain], tcb->tcbAffinity)--;
+        }
+#endif
     }
 }
 
@@ -518,6 +533,33 @@ static exception_t decodeSetAffinity(cap_t cap, word_t length, word_t *buffer)
 #endif
 #endif /* ENABLE_SMP_SUPPORT */
 
+#ifdef CONFIG_SMP_LOAD_BALANCING
+static exception_t invokeTCB_SetMigratable(tcb_t *thread, bool_t migratable)
+{
+    /* requeue the tcb so its core's count of migratable threads stays right */
+    bool_t queued = thread_state_get_tcbQueued(thread->tcbState);
+    tcbSchedDequeue(thread);
+    thread->tcbMigratable = migratable;
+    if (queued) {
+        SCHED_APPEND(thread);
+    }
+    return EXCEPTION_NONE;
+}
+
+static exception_t decodeSetMigratable(cap_t cap, word_t length, word_t *buffer)
+{
+    if (length < 1) {
+        userError("TCB SetMigratable: Truncated message.");
+        current_syscall_error.type = seL4_TruncatedMessage;
+        return EXCEPTION_SYSCALL_ERROR;
+    }
+
+    setThreadState(NODE_STATE(ksCurThread), ThreadState_Restart);
+    return invokeTCB_SetMigratable(TCB_PTR(cap_thread_cap_get_capTCBPtr(cap)),
+                                   getSyscallArg(0, buffer) != 0);
+}
+#endif /* CONFIG_SMP_LOAD_BALANCING */
+
 #ifdef CONFIG_HARDWARE_DEBUG_API
 static exception_t invokeConfigureSingleStepping(word_t *buffer, tcb_t *t,
                                                  uint16_t bp_num, word_t n_instrs)
@@ -841,6 +883,11 @@ exception_t decodeTCBInvocation(word_t invLabel, word_t length, cap_t cap,
 #endif /* ENABLE_SMP_SUPPORT */
 #endif
 
+#ifdef CONFIG_SMP_LOAD_BALANCING
+    case TCBSetMigratable:
+        return decodeSetMigratable(cap, length, buffer);
+#endif
+
         /* There is no notion of arch specific TCB invocations so this needs to go here */
 #ifdef CONFIG_VTX
     case TCBSetEPTRoot:
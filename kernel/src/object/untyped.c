@@ -232,6 +232,15 @@ exception_t decodeUntypedInvocation(word_t invLabel, word_t length, cte_t *slot,
                                 destCNode, nodeOffset, nodeWindow, deviceMemory);
 }
 
+static inline void clearUntypedMemory(void *ptr, word_t bits)
+{
+#ifdef CONFIG_FAST_UNTYPED_RESET
+    clearMemoryBulk(ptr, bits);
+#else
+    clearMemory(ptr, bits);
+#endif
+}
+
 static exception_t resetUntypedCap(cte_t *srcSlot)
 {
     cap_t prev_cap = srcSlot->cap;
@@ -253,13 +262,13 @@ static exception_t resetUntypedCap(cte_t *srcSlot)
 
     if (deviceMemory || block_size < chunk) {
         if (! deviceMemory) {
-            clearMemory(regionBase, block_size);
+            clearUntypedMemory(regionBase, block_size);
         }
         srcSlot->cap = cap_untyped_cap_set_capFreeIndex(prev_cap, 0);
     } else {
         for (offset = ROUND_DOWN(offset - 1, chunk);
              offset != - BIT(chunk); offset -= BIT(chunk)) {
-            clearMemory(GET_OFFSET_FREE_PTR(regionBase, offset), chunk);
+            clearUntypedMemory(GET_OFFSET_FREE_PTR(regionBase, offset), chunk);
             srcSlot->cap = cap_untyped_cap_set_capFreeIndex(prev_cap, OFFSET_TO_FREE_INDEX(offset));
             status = preemptionPoint();
             if (status != EXCEPTION_NONE) {
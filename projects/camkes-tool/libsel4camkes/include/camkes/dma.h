@@ -65,6 +65,14 @@ seL4_CPtr camkes_dma_get_cptr(void *ptr);
  */
 int camkes_dma_manager(ps_dma_man_t *man) NONNULL_ALL WARN_UNUSED_RESULT;
 
+/* Size classes of the slab caches used when CAmkESDMASlabCaches is enabled.
+ * Allocations of up to 2^CAMKES_DMA_SLAB_MAX_BITS bytes are rounded up to the
+ * next power of two, no smaller than 2^CAMKES_DMA_SLAB_MIN_BITS.
+ */
+#define CAMKES_DMA_SLAB_MIN_BITS 6
+#define CAMKES_DMA_SLAB_MAX_BITS 12
+#define CAMKES_DMA_SLAB_CLASSES (CAMKES_DMA_SLAB_MAX_BITS - CAMKES_DMA_SLAB_MIN_BITS + 1)
+
 /* Debug functionality for profiling DMA heap usage. This information is
  * returned from a call to `camkes_dma_stats`. Note that this functionality is
  * only available when NDEBUG is not defined.
@@ -127,6 +135,23 @@ typedef struct {
     /* Minimum alignment constraint (succeeded or failed) in bytes. */
     int minimum_alignment;
 
+    /* Number of allocations of each size class that were served from the
+     * slab caches (hits) and that had to carve new objects or use the free
+     * list (misses). Only counted when CAmkESDMASlabCaches is enabled.
+     */
+    uint64_t slab_hits[CAMKES_DMA_SLAB_CLASSES];
+    uint64_t slab_misses[CAMKES_DMA_SLAB_CLASSES];
+
+    /* Percentage of slab cacheable allocations, over all size classes, that
+     * were hits.
+     */
+    unsigned int slab_hit_rate;
+
+    /* Number of times the slab caches were returned to the free list to
+     * satisfy an allocation.
+     */
+    uint64_t slab_flushes;
+
 } camkes_dma_stats_t;
 
 /* Retrieve the above statistics for the current DMA heap. This function is
@@ -9,6 +9,7 @@
 #include <sel4/sel4.h>
 #include <virtqueue.h>
 #include <stddef.h>
+#include <stdbool.h>
 #include <inttypes.h>
 
 /* Max camkes virtqueue id */
@@ -138,9 +139,18 @@ void *camkes_virtqueue_driver_offset_to_buffer(virtqueue_driver_t *virtqueue, ui
  */
 int camkes_virtqueue_driver_send_buffer(virtqueue_driver_t *vq, void *buffer, size_t size);
 
+/* Check whether a buffer of the given size can currently be sent with
+ * camkes_virtqueue_driver_scatter_send_buffer. Space is returned as the device hands back used buffers.
+ * @param vq the driver side virtqueue
+ * @param size the size of the buffer
+ * @return true if there are enough free chunks and descriptors for the buffer
+ */
+bool camkes_virtqueue_driver_scatter_send_space(virtqueue_driver_t *vq, size_t size);
+
 /* Scatter and send one buffer (add to the available ring). Performs the pointer to offset conversion.
  * Doesn't notify the other side. Scatters the buffer into chunks of BLOCK_SIZE, so the buffer can have
- * an arbitrary size, and the scatterlist will contain several buffers.
+ * an arbitrary size, and the scatterlist will contain several buffers. If there isn't enough space for
+ * the whole buffer nothing is added to the virtqueue.
  * @param vq the driver side virtqueue
  * @param buffer the buffer to add
  * @param size the size of the buffer
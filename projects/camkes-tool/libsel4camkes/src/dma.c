@@ -20,6 +20,7 @@
 #include <camkes/error.h>
 #include <utils/util.h>
 #include <sel4/sel4.h>
+#include <sel4camkes/gen_config.h>
 #include <vspace/page.h>
 
 /* Check consistency of bookkeeping structures */
@@ -238,6 +239,16 @@ const camkes_dma_stats_t *camkes_dma_stats(void)
     } else {
         stats.average_allocation = 0;
     }
+    uint64_t slab_hits = 0, slab_lookups = 0;
+    for (int i = 0; i < CAMKES_DMA_SLAB_CLASSES; i++) {
+        slab_hits += stats.slab_hits[i];
+        slab_lookups += stats.slab_hits[i] + stats.slab_misses[i];
+    }
+    if (slab_lookups > 0) {
+        stats.slab_hit_rate = slab_hits * 100 / slab_lookups;
+    } else {
+        stats.slab_hit_rate = 0;
+    }
     return (const camkes_dma_stats_t *)&stats;
 }
 #endif
@@ -364,6 +375,30 @@ static dma_frame_t *get_frame_desc(void *ptr)
     return NULL;
 }
 
+static void account_alloc(size_t size UNUSED)
+{
+    STATS(({
+        stats.current_outstanding += size;
+        if (stats.heap_size - stats.current_outstanding < stats.minimum_heap_size)
+        {
+            stats.minimum_heap_size = stats.heap_size - stats.current_outstanding;
+        }
+    }));
+}
+
+static void account_free(size_t size UNUSED)
+{
+    STATS(({
+        if (size >= stats.current_outstanding)
+        {
+            stats.current_outstanding = 0;
+        } else
+        {
+            stats.current_outstanding -= size;
+        }
+    }));
+}
+
 static void free_region(void *ptr, size_t size, bool cached)
 {
     /* Although we've already checked the address, do another quick sanity check */
@@ -388,15 +423,7 @@ static void free_region(void *ptr, size_t size, bool cached)
      */
     assert((uintptr_t)ptr % alignof(region_t) == 0);
 
-    STATS(({
-        if (size >= stats.current_outstanding)
-        {
-            stats.current_outstanding = 0;
-        } else
-        {
-            stats.current_outstanding -= size;
-        }
-    }));
+    account_free(size);
 
     region_t *p = ptr;
     p->paddr_upper = 0;
@@ -620,6 +647,7 @@ static void *alloc(size_t size, int align, bool cached)
                                 r->paddr_upper = 0;
                             }
                             r->size = p->size - size;
+                            r->cached = p->cached;
                             replace_node(prev, p, r);
                         }
                     } else if (q + size == (void *)p + p->size) {
@@ -641,6 +669,7 @@ static void *alloc(size_t size, int align, bool cached)
                             end->paddr_upper = 0;
                         }
                         end->size = p->size - size - start_size;
+                        end->cached = p->cached;
                         prepend_node(end);
                         p->size = start_size;
                     }
@@ -655,6 +684,121 @@ static void *alloc(size_t size, int align, bool cached)
     return NULL;
 }
 
+#ifdef CONFIG_CAMKES_DMA_SLAB_CACHES
+
+/* Slab caches for small allocations. Each size class keeps a list of free
+ * objects of exactly that size, separately for uncached and cached memory, so
+ * allocating and freeing them is a push or pop instead of a walk of the free
+ * list. Objects are naturally aligned to their size, so any request whose
+ * alignment is no larger than its size class can be served from the cache.
+ *
+ * Cached objects are linked through region_t nodes stored in-place, as in the
+ * free list. The node is overwritten while the object is in use, so the
+ * physical address is saved again from the object's frame each time it is
+ * cached. Objects are only returned to the free list when an allocation would
+ * otherwise fail.
+ */
+static region_t *slabs[2][CAMKES_DMA_SLAB_CLASSES];
+
+/* Slabs are carved out of the free list in chunks of this size, or a single
+ * object for the largest classes.
+ */
+#define SLAB_CHUNK_SIZE PAGE_SIZE_4K
+
+static_assert(BIT(CAMKES_DMA_SLAB_MIN_BITS) >= sizeof(region_t),
+              "smallest slab object cannot hold bookkeeping");
+static_assert(BIT(CAMKES_DMA_SLAB_MAX_BITS) <= SLAB_CHUNK_SIZE,
+              "largest slab object does not fit in a slab chunk");
+
+/* Returns the size class for an allocation of 'size' bytes, or -1 if it is
+ * too large to be cached.
+ */
+static int slab_class(size_t size)
+{
+    if (size > BIT(CAMKES_DMA_SLAB_MAX_BITS)) {
+        return -1;
+    }
+    int class = 0;
+    while (BIT(CAMKES_DMA_SLAB_MIN_BITS + class) < size) {
+        class++;
+    }
+    return class;
+}
+
+static size_t slab_object_size(int class)
+{
+    return BIT(CAMKES_DMA_SLAB_MIN_BITS + class);
+}
+
+/* Save the physical address of a slab object from its frame, when the frame's
+ * address has already been looked up, so it doesn't have to be found again
+ * when the object is handed out.
+ */
+static void slab_save_paddr(region_t *r, dma_frame_t *frame)
+{
+    uintptr_t paddr = 0;
+    if (frame != NULL && frame->paddr != 0) {
+        paddr = frame->paddr + ((uintptr_t)r & MASK(ffs(frame->size) - 1));
+    }
+    save_paddr(r, paddr);
+}
+
+static void slab_push(int class, bool cached, region_t *r)
+{
+    r->size = slab_object_size(class);
+    r->cached = cached;
+    r->next = slabs[cached][class];
+    slabs[cached][class] = r;
+}
+
+/* Carve a chunk of the free list into objects of a size class. */
+static bool slab_refill(int class, bool cached)
+{
+    size_t object_size = slab_object_size(class);
+    void *chunk = alloc(SLAB_CHUNK_SIZE, object_size, cached);
+    if (chunk == NULL) {
+        return false;
+    }
+    /* Push from the end so the lowest addresses are handed out first. */
+    for (size_t offset = SLAB_CHUNK_SIZE; offset > 0; offset -= object_size) {
+        region_t *r = chunk + offset - object_size;
+        slab_save_paddr(r, get_frame_desc(r));
+        slab_push(class, cached, r);
+    }
+    return true;
+}
+
+static void *slab_alloc(int class, bool cached)
+{
+    if (slabs[cached][class] == NULL && !slab_refill(class, cached)) {
+        return NULL;
+    }
+    region_t *r = slabs[cached][class];
+    slabs[cached][class] = r->next;
+    return r;
+}
+
+/* Return every cached object to the free list, so defrag can coalesce them. */
+static void slab_flush(void)
+{
+    bool flushed = false;
+    for (int cached = 0; cached < 2; cached++) {
+        for (int class = 0; class < CAMKES_DMA_SLAB_CLASSES; class++) {
+            while (slabs[cached][class] != NULL) {
+                region_t *r = slabs[cached][class];
+                slabs[cached][class] = r->next;
+                prepend_node(r);
+                flushed = true;
+            }
+        }
+    }
+    if (flushed) {
+        STATS(stats.slab_flushes++);
+    }
+}
+
+#endif
+
 void *camkes_dma_alloc(size_t size, int align, bool cached)
 {
 
@@ -679,17 +823,53 @@ void *camkes_dma_alloc(size_t size, int align, bool cached)
         total_allocation_bytes += size;
     }));
 
+    if (align == 0) {
+        /* No alignment requirements. */
+        align = 1;
+    }
+
+#ifdef CONFIG_CAMKES_DMA_SLAB_CACHES
+    int class = slab_class(size);
+    if (class >= 0) {
+        /* Small allocations always occupy a whole object of their class, even
+         * when their alignment is too large to use the cache, so that they can
+         * be cached when they are freed.
+         */
+        size = slab_object_size(class);
+        if (align <= (int)size) {
+            /* Anything we carve for this class below must be naturally
+             * aligned too, as it may later be handed out from the cache.
+             */
+            align = size;
+            bool hit = slabs[cached][class] != NULL;
+            void *p = slab_alloc(class, cached);
+            if (p != NULL) {
+                if (hit) {
+                    STATS(stats.slab_hits[class]++);
+                } else {
+                    STATS(stats.slab_misses[class]++);
+                }
+                account_alloc(size);
+                return p;
+            }
+        }
+        STATS(stats.slab_misses[class]++);
+    }
+
+    if (head == NULL) {
+        /* Memory sitting in the slab caches is only reclaimed when we run
+         * out.
+         */
+        slab_flush();
+    }
+#endif
+
     if (head == NULL) {
         /* Nothing in the free list. */
         STATS(stats.failed_allocations_out_of_memory++);
         return NULL;
     }
 
-    if (align == 0) {
-        /* No alignment requirements. */
-        align = 1;
-    }
-
     if (align < (int)alignof(region_t)) {
         /* Allocating something with a weaker alignment constraint than our
          * bookkeeping data may lead to us giving out a chunk of memory that is
@@ -721,6 +901,9 @@ void *camkes_dma_alloc(size_t size, int align, bool cached)
          * satisfy this allocation by defragmenting the free list and
          * re-attempting.
          */
+#ifdef CONFIG_CAMKES_DMA_SLAB_CACHES
+        slab_flush();
+#endif
         defrag();
         p = alloc(size, align, cached);
 
@@ -734,13 +917,7 @@ void *camkes_dma_alloc(size_t size, int align, bool cached)
     if (p == NULL) {
         STATS(stats.failed_allocations_other++);
     } else {
-        STATS(({
-            stats.current_outstanding += size;
-            if (stats.heap_size - stats.current_outstanding < stats.minimum_heap_size)
-            {
-                stats.minimum_heap_size = stats.heap_size - stats.current_outstanding;
-            }
-        }));
+        account_alloc(size);
     }
 
     return p;
@@ -764,6 +941,18 @@ void camkes_dma_free(void *ptr, size_t size)
 
     cached = dma_frame->cached;
 
+#ifdef CONFIG_CAMKES_DMA_SLAB_CACHES
+    int class = slab_class(size);
+    if (class >= 0) {
+        /* This was allocated as a whole object of its class. */
+        region_t *r = ptr;
+        slab_save_paddr(r, dma_frame);
+        slab_push(class, cached, r);
+        account_free(slab_object_size(class));
+        return;
+    }
+#endif
+
     /* Call the common function to free the DMA memory */
     free_region(ptr, size, cached);
 }
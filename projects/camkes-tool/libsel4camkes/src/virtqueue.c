@@ -34,6 +34,7 @@ int camkes_virtqueue_buffer_alloc(virtqueue_driver_t *virtqueue, void **buf, siz
     }
     *buf = allocator->buffer + IDX_TO_OFFSET(allocator->block_size, allocator->head);
     allocator->head = allocator->free_list[allocator->head];
+    allocator->num_free--;
     return 0;
 }
 
@@ -53,6 +54,7 @@ void camkes_virtqueue_buffer_free(virtqueue_driver_t *virtqueue, void *buffer)
     }
     allocator->free_list[idx] = allocator->head;
     allocator->head = idx;
+    allocator->num_free++;
 }
 
 static camkes_virtqueue_channel_t *get_virtqueue_channel(virtqueue_role_t role, unsigned int camkes_virtqueue_id)
@@ -176,12 +178,27 @@ static int chain_vq_buf(virtqueue_driver_t *vq, virtqueue_ring_object_t *handle,
     return 0;
 }
 
+bool camkes_virtqueue_driver_scatter_send_space(virtqueue_driver_t *vq, size_t size)
+{
+    struct vq_buf_alloc *allocator = vq->cookie;
+    unsigned num_blocks = DIV_ROUND_UP(size, BLOCK_SIZE);
+
+    /* Keep one descriptor spare so that the available ring can never wrap
+     * around onto entries the device has not consumed yet. */
+    return allocator->num_free >= num_blocks && virtqueue_num_free_desc(vq) > num_blocks;
+}
+
 int camkes_virtqueue_driver_scatter_send_buffer(virtqueue_driver_t *vq, void *buffer, size_t size)
 {
     size_t sent = 0;
     virtqueue_ring_object_t handle;
     virtqueue_init_ring_object(&handle);
 
+    /* Check up front so that a full queue never leaves a partial scatter list behind */
+    if (!camkes_virtqueue_driver_scatter_send_space(vq, size)) {
+        return -1;
+    }
+
     while (sent < size) {
         void *vq_buf = NULL;
         size_t to_send = 0;
@@ -45,6 +45,7 @@ struct vq_buf_alloc *init_vq_allocator(void *mem_pool, unsigned len, size_t bloc
         allocator->free_list[i] = i + 1;
     }
     allocator->head = 0;
+    allocator->num_free = allocator->free_list_size;
 
     return allocator;
 }
@@ -16,6 +16,7 @@ struct vq_buf_alloc {
     unsigned free_list_size;
     unsigned *free_list;
     unsigned head;
+    unsigned num_free;
 };
 
 struct vq_buf_alloc *init_vq_allocator(void *mem_pool, unsigned len, size_t block_size);
@@ -98,6 +98,8 @@ void virtio_net_notify(vm_t *vm)
 {
     int len;
     int status;
+    /* deliver the whole burst to the guest with a single interrupt */
+    net_virtio_emul_batch_begin(virtio_net->emul);
     status = ethdriver_rx(&len);
     while (status != -1) {
         void *cookie;
@@ -115,6 +117,7 @@ void virtio_net_notify(vm_t *vm)
             status = -1;
         }
     }
+    net_virtio_emul_batch_end(virtio_net->emul);
 }
 
 void make_virtio_net(vm_t *vm, vmm_pci_space_t *pci, vmm_io_port_list_t *io_ports)
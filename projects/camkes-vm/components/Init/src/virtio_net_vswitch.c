@@ -58,92 +58,319 @@ static void virtio_net_notify_vswitch_send(vswitch_node_t *node)
     }
 }
 
+/* Frames waiting for space in the send virtqueue of one or more nodes. The
+ * emulated device doesn't reuse a buffer until we complete it, so frames are
+ * held here rather than copied. Each node has its own queue of held frames,
+ * so a node that stops draining only holds back frames sent to it.
+ */
+#define TX_PENDING_LEN 64
+/* Most frames held for any one node. Further frames for it are dropped */
+#define TX_PENDING_NODE_LEN 32
+/* How long a node can go without taking a frame, in nanoseconds, before
+ * everything held for it is dropped. Until it takes a frame again, frames for
+ * it are dropped rather than held.
+ */
+#define TX_STALL_TIMEOUT_NS (100 * NS_IN_MS)
+
+/* A set of node indices */
+#define NODE_SET_WORD_BITS (sizeof(unsigned long) * 8)
+typedef struct node_set {
+    unsigned long words[DIV_ROUND_UP(VSWITCH_NUM_NODES, NODE_SET_WORD_BITS)];
+} node_set_t;
+
+static void node_set_add(node_set_t *set, int i)
+{
+    set->words[i / NODE_SET_WORD_BITS] |= BIT(i % NODE_SET_WORD_BITS);
+}
+
+static void node_set_remove(node_set_t *set, int i)
+{
+    set->words[i / NODE_SET_WORD_BITS] &= ~BIT(i % NODE_SET_WORD_BITS);
+}
+
+static bool node_set_empty(node_set_t *set)
+{
+    for (int w = 0; w < ARRAY_SIZE(set->words); w++) {
+        if (set->words[w]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Remove and return the lowest node in the set, or -1 if it is empty */
+static int node_set_pop(node_set_t *set)
+{
+    for (int w = 0; w < ARRAY_SIZE(set->words); w++) {
+        if (set->words[w]) {
+            int i = CTZL(set->words[w]);
+            set->words[w] &= ~BIT(i);
+            return w * NODE_SET_WORD_BITS + i;
+        }
+    }
+    return -1;
+}
+
+typedef struct tx_pending {
+    void *buf;
+    unsigned int len;
+    void *cookie;
+    /* Nodes the frame still has to be sent to. A frame with no destinations
+     * is a free slot */
+    node_set_t dests;
+} tx_pending_t;
+
+typedef struct tx_node_queue {
+    /* Indices into tx_pending, in the order the frames were sent */
+    uint8_t frames[TX_PENDING_NODE_LEN];
+    unsigned int head, tail;
+    /* Whether the last attempt to send to the node failed, and when the
+     * failures started */
+    bool blocked;
+    uint64_t blocked_since;
+    /* Whether the node has been blocked for longer than TX_STALL_TIMEOUT_NS */
+    bool stalled;
+} tx_node_queue_t;
+
+compile_time_assert(tx_pending_fits_index, TX_PENDING_LEN <= 256);
+
+static tx_pending_t tx_pending[TX_PENDING_LEN];
+static tx_node_queue_t tx_queues[VSWITCH_NUM_NODES];
+
+/* Nodes that have been sent frames since they were last notified */
+static node_set_t tx_notify_set;
+
+/* Completing held frames lets the emulated device transmit more, which polls
+ * us and so drains again. Those drains are folded into the one in progress.
+ */
+static bool tx_draining;
+static bool tx_drain_again;
+
+static bool tx_queue_empty(tx_node_queue_t *q)
+{
+    return q->head == q->tail;
+}
+
+static bool tx_queue_full(tx_node_queue_t *q)
+{
+    return q->tail - q->head == TX_PENDING_NODE_LEN;
+}
+
+static bool tx_node_stalled(int i)
+{
+    return tx_queues[i].stalled;
+}
+
+static void tx_notify_nodes(void)
+{
+    int i;
+    while ((i = node_set_pop(&tx_notify_set)) >= 0) {
+        g_vswitch.nodes[i].virtqueues.send_queue->notify();
+    }
+}
+
+/* Note a failed attempt to send to node i. The clock is only read while the
+ * node is refusing frames */
+static void tx_node_blocked(int i)
+{
+    tx_node_queue_t *q = &tx_queues[i];
+    uint64_t now = init_timer_time();
+    if (!q->blocked) {
+        q->blocked = true;
+        q->blocked_since = now;
+    } else if (now - q->blocked_since >= TX_STALL_TIMEOUT_NS) {
+        q->stalled = true;
+    }
+}
+
+/* Try to copy a frame into the send virtqueue of a node. Returns false if
+ * the node didn't have space for it.
+ */
+static bool tx_to_node(int i, void *buf, unsigned int len)
+{
+    virtqueue_driver_t *vq = g_vswitch.nodes[i].virtqueues.send_queue;
+
+    if (!camkes_virtqueue_driver_scatter_send_space(vq, len)) {
+        /* Reclaim anything the other end has finished with and try again */
+        virtio_net_notify_vswitch_send(&g_vswitch.nodes[i]);
+        if (!camkes_virtqueue_driver_scatter_send_space(vq, len)) {
+            /* The other end might not have seen what we have already sent */
+            node_set_add(&tx_notify_set, i);
+            tx_node_blocked(i);
+            return false;
+        }
+    }
+    tx_queues[i].blocked = false;
+    tx_queues[i].stalled = false;
+    if (camkes_virtqueue_driver_scatter_send_buffer(vq, buf, len) < 0) {
+        ZF_LOGE("Unknown error while enqueuing available buffer for dest "
+                PR_MAC802_ADDR ".",
+                PR_MAC802_ADDR_ARGS((struct ether_addr *)buf));
+        return true;
+    }
+    node_set_add(&tx_notify_set, i);
+    return true;
+}
+
+/* Record that a held frame no longer has to be sent to node i, and return it
+ * to the emulated device once it has gone to every node.
+ */
+static void tx_pending_done(tx_pending_t *frame, int i)
+{
+    node_set_remove(&frame->dests, i);
+    if (node_set_empty(&frame->dests)) {
+        /* Completing the frame may cause the device to transmit more */
+        virtio_net->emul_driver->i_cb.tx_complete(virtio_net->emul_driver->cb_cookie, frame->cookie);
+    }
+}
+
+/* Send as many of the frames held for node i as there is now space for, in
+ * order, or drop them all if the node has stalled.
+ */
+static void tx_node_drain(int i)
+{
+    tx_node_queue_t *q = &tx_queues[i];
+
+    while (!tx_queue_empty(q)) {
+        tx_pending_t *frame = &tx_pending[q->frames[q->head % TX_PENDING_NODE_LEN]];
+        if (!tx_to_node(i, frame->buf, frame->len)) {
+            if (!tx_node_stalled(i)) {
+                break;
+            }
+            ZF_LOGW("Node " PR_MAC802_ADDR " stalled. Dropping %u held frames.",
+                    PR_MAC802_ADDR_ARGS(&g_vswitch.nodes[i].addr), q->tail - q->head);
+            while (!tx_queue_empty(q)) {
+                frame = &tx_pending[q->frames[q->head % TX_PENDING_NODE_LEN]];
+                q->head++;
+                tx_pending_done(frame, i);
+            }
+            break;
+        }
+        q->head++;
+        tx_pending_done(frame, i);
+    }
+}
+
+static void tx_pending_drain(void)
+{
+    if (tx_draining) {
+        tx_drain_again = true;
+        return;
+    }
+    tx_draining = true;
+    do {
+        tx_drain_again = false;
+        for (int i = 0; i < g_vswitch.n_connected; i++) {
+            tx_node_drain(g_vswitch.fanout[i]);
+        }
+        tx_notify_nodes();
+    } while (tx_drain_again);
+    tx_draining = false;
+}
+
+static tx_pending_t *tx_pending_alloc(void)
+{
+    for (int i = 0; i < TX_PENDING_LEN; i++) {
+        if (node_set_empty(&tx_pending[i].dests)) {
+            return &tx_pending[i];
+        }
+    }
+    return NULL;
+}
+
 /*
  * We transmit packets to other VM's through using our virtqueue
- * implementation. The current virtqueue implementation is limited to
- * sending a single packet at a time and hence may drop a large number of
- * packets when sending a multi-packet payloads. Our TX implementation
- * is limited by the following:
- * - Can't send payloads larger than 4K (maximum size of buffer)
- * - Can send only one packet at once
- *   - We yield between packet sends to give the other end a chance to
- *   consume the virtqueue buffer. However if this does not happen we
- *   will ultimately drop the packet.
- * - If we can't send a packet, we will drop the packet and end the
- *   transmission. We currently don't have a mechanism to retry the
- *   transmission.
+ * implementation. Frames larger than a virtqueue buffer are scattered across
+ * a chain of them. If a destination's virtqueue is full the frame is held
+ * back for that destination, along with every later frame for it, until the
+ * other end returns some buffers. Holding on to the frame stops the emulated
+ * device from reusing the guest's descriptors, so the guest sees
+ * back-pressure instead of loss. Destinations that stay full for longer than
+ * TX_STALL_TIMEOUT_NS, or have too many frames held, have frames for them
+ * dropped instead so they cannot hold the device's buffers indefinitely.
+ * Nodes are only notified once per batch of frames, when the emulated device
+ * polls us at the end of a pass over the guest's transmit ring.
  */
 static int emul_raw_tx(struct eth_driver *driver,
                        unsigned int num, uintptr_t *phys, unsigned int *len,
                        void *cookie)
 {
-    /* Copy to the virtqueue */
-    for (int i = 0; i < num; i++) {
-        struct ether_addr *destaddr;
-        int err, destnode_start_idx, destnode_n_idxs;
-
-        /* Initialize a convenience pointer to the dest macaddr.
-         * The dest MAC addr is the first member of an ethernet frame.
-         */
-        destaddr = (struct ether_addr *)phys[i];
+    struct ether_addr *destaddr;
+    const int *destnode_idxs;
+    int destnode_n_idxs;
+    node_set_t blocked = {0};
+
+    /* The emulated device always hands us a frame in a single buffer */
+    if (num != 1) {
+        ZF_LOGE("Scattered frames are not supported. Dropping frame.");
+        return ETHIF_TX_FAILED;
+    }
 
-        /* Set up the bounds of the loop below that copies the frames into the
-         * destination Guest's virtqueue.
-         */
-        if (mac802_addr_eq_bcast(destaddr)) {
-            /* Send to all nodes on the VLAN if destaddr is bcast addr. */
-            destnode_n_idxs = g_vswitch.n_connected;
-            destnode_start_idx = 0;
-        } else {
-            /* Send only to the target node */
-            destnode_n_idxs = 1;
-            destnode_start_idx = vswitch_get_destnode_index_by_macaddr(
-                                     &g_vswitch,
-                                     destaddr);
-            if (destnode_start_idx < 0) {
-                ZF_LOGE("Unreachable dest macaddr " PR_MAC802_ADDR ". Dropping "
-                        "frame.",
-                        PR_MAC802_ADDR_ARGS(destaddr));
-
-                /* This function seems to be pretending to send multiple frames
-                 * at once, but in reality, it is only ever invoked with the
-                 * "num" argment being "1".
-                 *
-                 * So return error instead of "continue"-ing here.
-                 */
-                return ETHIF_TX_COMPLETE;
-            }
-        }
+    /* Initialize a convenience pointer to the dest macaddr.
+     * The dest MAC addr is the first member of an ethernet frame.
+     */
+    destaddr = (struct ether_addr *)phys[0];
 
-        /* Copy the frame into the virtqueue of each of the targets we decided
-         * upon.
-         */
-        for (int j = destnode_start_idx; j < destnode_start_idx + destnode_n_idxs; j++) {
-            vswitch_node_t *destnode;
-
-            destnode = vswitch_get_destnode_by_index(&g_vswitch, j);
-            if (destnode == NULL) {
-                /* This could happen in the broadcast case if there are holes in
-                 * the array, though that would still be odd.
-                 */
-                ZF_LOGW("Found holes in node array while sending to dest MAC "
-                        PR_MAC802_ADDR".",
-                        PR_MAC802_ADDR_ARGS(destaddr));
-                continue;
-            }
+    /* Look up the nodes to copy the frame to: every connected node for
+     * broadcast and multicast frames, otherwise only the target node.
+     */
+    destnode_n_idxs = vswitch_get_destnode_indices_by_macaddr(&g_vswitch,
+                                                              destaddr,
+                                                              &destnode_idxs);
+    if (destnode_n_idxs == 0) {
+        ZF_LOGE("Unreachable dest macaddr " PR_MAC802_ADDR ". Dropping "
+                "frame.",
+                PR_MAC802_ADDR_ARGS(destaddr));
+        return ETHIF_TX_COMPLETE;
+    }
 
-            if (camkes_virtqueue_driver_scatter_send_buffer(destnode->virtqueues.send_queue, (void *)phys[i], len[i]) < 0) {
-                ZF_LOGE("Unknown error while enqueuing available buffer for dest "
-                        PR_MAC802_ADDR ".",
-                        PR_MAC802_ADDR_ARGS(destaddr));
-                return ETHIF_TX_COMPLETE;
-            }
+    for (int n = 0; n < destnode_n_idxs; n++) {
+        int i = destnode_idxs[n];
+        /* Frames can only go straight out if none are waiting ahead of them */
+        if (!tx_queue_empty(&tx_queues[i]) || !tx_to_node(i, (void *)phys[0], len[0])) {
+            node_set_add(&blocked, i);
+        }
+    }
+    if (node_set_empty(&blocked)) {
+        return ETHIF_TX_COMPLETE;
+    }
 
-            destnode->virtqueues.send_queue->notify();
+    tx_pending_t *frame = tx_pending_alloc();
+    if (frame == NULL) {
+        ZF_LOGW("Transmit backlog full. Dropping frame for " PR_MAC802_ADDR ".",
+                PR_MAC802_ADDR_ARGS(destaddr));
+        return ETHIF_TX_FAILED;
+    }
+    *frame = (tx_pending_t) {
+        .buf = (void *)phys[0],
+        .len = len[0],
+        .cookie = cookie,
+    };
+    int i;
+    while ((i = node_set_pop(&blocked)) >= 0) {
+        tx_node_queue_t *q = &tx_queues[i];
+        if (tx_node_stalled(i) || tx_queue_full(q)) {
+            ZF_LOGW("Transmit backlog for " PR_MAC802_ADDR " full. Dropping frame.",
+                    PR_MAC802_ADDR_ARGS(&g_vswitch.nodes[i].addr));
+            continue;
         }
+        q->frames[q->tail % TX_PENDING_NODE_LEN] = frame - tx_pending;
+        q->tail++;
+        node_set_add(&frame->dests, i);
+    }
+    if (node_set_empty(&frame->dests)) {
+        /* Only dropped, the slot stays free */
+        return ETHIF_TX_FAILED;
     }
 
-    return ETHIF_TX_COMPLETE;
+    return ETHIF_TX_ENQUEUED;
+}
+
+static void emul_raw_poll(struct eth_driver *driver)
+{
+    /* Held frames can only be completed from here, once the emulated device
+     * has finished its pass over the guest's transmit ring */
+    tx_pending_drain();
 }
 
 static void emul_low_level_init(struct eth_driver *driver, uint8_t *mac, int *mtu)
@@ -211,9 +438,21 @@ static void virtio_net_notify_vswitch_recv(vswitch_node_t *node)
         if (camkes_virtqueue_device_gather_copy_buffer(node->virtqueues.recv_queue, &handle, emul_buf, len) < 0) {
             ZF_LOGW("Dropping frame for " PR_MAC802_ADDR ": Can't gather vq buffer.",
                     PR_MAC802_ADDR_ARGS(&myaddr));
+            /* An empty frame hands the buffer back to the emulated device */
+            unsigned int empty_len = 0;
+            virtio_net->emul_driver->i_cb.rx_complete(virtio_net->emul_driver->cb_cookie, 1,
+                                                      &cookie, &empty_len);
             break;
         }
 
+        /* Remember which node the source address is behind. The source MAC
+         * addr follows the dest MAC addr in an ethernet frame.
+         */
+        if (len >= 2 * ETH_ALEN) {
+            vswitch_learn_macaddr(&g_vswitch, (struct ether_addr *)((uintptr_t)emul_buf + ETH_ALEN),
+                                  node - g_vswitch.nodes);
+        }
+
         virtio_net->emul_driver->i_cb.rx_complete(virtio_net->emul_driver->cb_cookie, 1,
                                                   &cookie, (unsigned int *)&len);
     }
@@ -223,14 +462,20 @@ static void virtio_net_notify_vswitch_recv(vswitch_node_t *node)
 
 void virtio_net_notify_vswitch(vm_t *vm)
 {
-    for (int i = 0; i < VSWITCH_NUM_NODES; i++) {
-        if (g_vswitch.nodes[i].virtqueues.send_queue && VQ_DRV_POLL(g_vswitch.nodes[i].virtqueues.send_queue)) {
-            virtio_net_notify_vswitch_send(&g_vswitch.nodes[i]);
+    /* frames received from every node are delivered with a single interrupt */
+    net_virtio_emul_batch_begin(virtio_net->emul);
+    for (int i = 0; i < g_vswitch.n_connected; i++) {
+        vswitch_node_t *node = &g_vswitch.nodes[g_vswitch.fanout[i]];
+        if (VQ_DRV_POLL(node->virtqueues.send_queue)) {
+            virtio_net_notify_vswitch_send(node);
         }
-        if (g_vswitch.nodes[i].virtqueues.recv_queue && VQ_DEV_POLL(g_vswitch.nodes[i].virtqueues.recv_queue)) {
-            virtio_net_notify_vswitch_recv(&g_vswitch.nodes[i]);
+        if (VQ_DEV_POLL(node->virtqueues.recv_queue)) {
+            virtio_net_notify_vswitch_recv(node);
         }
     }
+    /* nodes may have returned enough buffers for held frames to go out */
+    tx_pending_drain();
+    net_virtio_emul_batch_end(virtio_net->emul);
 }
 
 static int make_vswitch_net(void)
@@ -275,6 +520,7 @@ void make_virtio_net_vswitch_driver(vm_t *vm, vmm_pci_space_t *pci, vmm_io_port_
 {
     struct raw_iface_funcs backend = virtio_net_default_backend();
     backend.raw_tx = emul_raw_tx;
+    backend.raw_poll = emul_raw_poll;
     backend.low_level_init = emul_low_level_init;
     backend.raw_handleIRQ = emul_raw_handle_irq;
 
@@ -39,20 +39,22 @@ void self_mac(uint8_t *mac)
 static int tx_virtqueue_forward(char *eth_buffer, size_t length, virtio_net_t *virtio_net)
 {
     struct ether_addr *destaddr;
-    int err, destnode_start_idx, destnode_n_idxs;
+    const int *destnode_idxs;
+    int destnode_n_idxs;
 
     /* The dest MAC addr is the first member of an ethernet frame. */
     destaddr = (struct ether_addr *)eth_buffer;
 
-    destnode_n_idxs = virtio_vswitch.n_connected;
-    destnode_start_idx = 0;
-    for (int i = destnode_start_idx; i < destnode_start_idx + destnode_n_idxs; i++) {
+    destnode_n_idxs = vswitch_get_destnode_indices_by_macaddr(&virtio_vswitch, destaddr, &destnode_idxs);
+    if (destnode_n_idxs == 0) {
+        /* Flood frames for addresses we don't know about yet */
+        destnode_idxs = virtio_vswitch.fanout;
+        destnode_n_idxs = virtio_vswitch.n_connected;
+    }
+    for (int i = 0; i < destnode_n_idxs; i++) {
         vswitch_node_t *destnode;
-        destnode = vswitch_get_destnode_by_index(&virtio_vswitch, i);
+        destnode = vswitch_get_destnode_by_index(&virtio_vswitch, destnode_idxs[i]);
         if (destnode == NULL) {
-            /* This could happen in the broadcast case if there are holes in
-             * the array, though that would still be odd.
-             */
             continue;
         }
 
@@ -100,6 +102,12 @@ static int virtio_net_notify_recv(vswitch_node_t *node)
             continue;
         }
 
+        if (len >= 2 * ETH_ALEN) {
+            /* The source MAC addr follows the dest MAC addr */
+            vswitch_learn_macaddr(&virtio_vswitch, (struct ether_addr *)(emul_buf + ETH_ALEN),
+                                  node - virtio_vswitch.nodes);
+        }
+
         int err = virtio_net_rx(emul_buf, len, virtio_net);
         if (err) {
             ZF_LOGE("Unable to forward recieved buffer to the guest");
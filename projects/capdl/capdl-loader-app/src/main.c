@@ -72,6 +72,14 @@ static seL4_UserContext global_user_context;
 extern char _capdl_archive[];
 extern char _capdl_archive_end[];
 
+/* Index of the files in the embedded archive so that frame fills don't rescan it.
+ * Built by 'init_archive_index'; if the archive has more files than the buffer
+ * can hold, lookups fall back to scanning the archive. */
+static struct cpio_index archive_index;
+static struct cpio_index_entry archive_index_buf[CPIO_INDEX_BUF_SIZE(CONFIG_CAPDL_LOADER_MAX_ARCHIVE_FILES) /
+                                                 sizeof(struct cpio_index_entry)];
+static bool archive_indexed;
+
 /* This symbol is provided by the GNU linker and points at the start/end of our
  * ELF image.
  */
@@ -1954,15 +1962,90 @@ static void fill_frame_with_bootinfo(uintptr_t base, CDL_FrameFill_Element_t fra
     }
 }
 
-static void fill_frame_with_filedata(uintptr_t base, CDL_FrameFill_Element_t frame_fill)
+static void init_archive_index(void)
 {
-    unsigned long file_size;
     unsigned long cpio_size = _capdl_archive_end - _capdl_archive;
-    void *file = cpio_get_file(_capdl_archive, cpio_size, frame_fill.file_data_type.filename, &file_size);
-    memcpy((void *)base + frame_fill.dest_offset, file + frame_fill.file_data_type.file_offset, frame_fill.dest_len);
+    int error = cpio_index_init(&archive_index, _capdl_archive, cpio_size, archive_index_buf,
+                                sizeof(archive_index_buf));
+    if (error) {
+        ZF_LOGW("Could not index archive, is CapDLLoaderMaxArchiveFiles large enough?");
+        return;
+    }
+    archive_indexed = true;
+}
+
+/* A pending copy of file data, extended while successive fills continue both
+ * the source file and the destination window so they can be done in one memcpy */
+struct file_copy {
+    void *dest;
+    void *src;
+    size_t len;
+};
+
+static void flush_file_copy(struct file_copy *copy)
+{
+    if (copy->len > 0) {
+        memcpy(copy->dest, copy->src, copy->len);
+        copy->len = 0;
+    }
+}
+
+static void fill_frame_with_filedata(uintptr_t base, CDL_FrameFill_Element_t frame_fill, struct file_copy *copy)
+{
+    unsigned long file_size;
+    void *file;
+    if (archive_indexed) {
+        file = cpio_index_get_file(&archive_index, frame_fill.file_data_type.filename, &file_size);
+    } else {
+        unsigned long cpio_size = _capdl_archive_end - _capdl_archive;
+        file = cpio_get_file(_capdl_archive, cpio_size, frame_fill.file_data_type.filename, &file_size);
+    }
+    ZF_LOGF_IF(file == NULL, "File %s not found in archive", frame_fill.file_data_type.filename);
+
+    void *dest = (void *)base + frame_fill.dest_offset;
+    void *src = file + frame_fill.file_data_type.file_offset;
+    if (copy->len > 0 && copy->dest + copy->len == dest && copy->src + copy->len == src) {
+        copy->len += frame_fill.dest_len;
+        return;
+    }
+    flush_file_copy(copy);
+    *copy = (struct file_copy) {
+        .dest = dest, .src = src, .len = frame_fill.dest_len
+    };
+}
+
+static bool frame_has_fills(CDL_Model *spec, CDL_ObjID obj_id)
+{
+    return spec->objects[obj_id].type == CDL_Frame
+           && spec->objects[obj_id].frame_extra.fill[0].type != CDL_FrameFill_None;
+}
+
+/* Perform all the fills of a frame that is mapped at base */
+static void fill_frame(CDL_Model *spec, CDL_ObjID obj_id, uintptr_t base, struct file_copy *copy)
+{
+    for (int i = 0; i < CONFIG_CAPDL_LOADER_FILLS_PER_FRAME
+         && spec->objects[obj_id].frame_extra.fill[i].type != CDL_FrameFill_None; i++) {
+        CDL_FrameFill_Element_t frame_fill = spec->objects[obj_id].frame_extra.fill[i];
+
+        ssize_t max = BIT(spec->objects[obj_id].size_bits) - frame_fill.dest_offset;
+        ZF_LOGF_IF(frame_fill.dest_len > max, "Bad spec, fill frame with len larger than frame size");
+
+        /* Check for which type */
+        switch (frame_fill.type) {
+        case CDL_FrameFill_BootInfo:
+            flush_file_copy(copy);
+            fill_frame_with_bootinfo(base, frame_fill);
+            break;
+        case CDL_FrameFill_FileData:
+            fill_frame_with_filedata(base, frame_fill, copy);
+            break;
+        default:
+            ZF_LOGF("Unsupported frame fill type %u", frame_fill.type);
+        }
+    }
 }
 
-static void init_frame(CDL_Model *spec, CDL_ObjID obj_id, CDL_FrameFill_Element_t frame_fill)
+static void init_frame(CDL_Model *spec, CDL_ObjID obj_id)
 {
     seL4_CPtr cap = orig_caps(obj_id);
 
@@ -1979,36 +2062,65 @@ static void init_frame(CDL_Model *spec, CDL_ObjID obj_id, CDL_FrameFill_Element_
     }
     ZF_LOGF_IFERR(error, "");
 
-    ssize_t max = BIT(spec->objects[obj_id].size_bits) - frame_fill.dest_offset;
-    ZF_LOGF_IF(frame_fill.dest_len > max, "Bad spec, fill frame with len larger than frame size");
-
-    /* Check for which type */
-    switch (frame_fill.type) {
-    case CDL_FrameFill_BootInfo:
-        fill_frame_with_bootinfo(base, frame_fill);
-        break;
-    case CDL_FrameFill_FileData:
-        fill_frame_with_filedata(base, frame_fill);
-        break;
-    default:
-        ZF_LOGF("Unsupported frame fill type %u", frame_fill.type);
-    }
+    struct file_copy copy = { .len = 0 };
+    fill_frame(spec, obj_id, base, &copy);
+    flush_file_copy(&copy);
 
     /* Unmap the frame */
     error = seL4_ARCH_Page_Unmap(cap);
     ZF_LOGF_IFERR(error, "");
 }
 
+/* Number of 4K frames that can be mapped together at copy_addr_with_pt */
+#define COPY_WINDOW_FRAMES (sizeof(copy_addr_with_pt) / PAGE_SIZE_4K)
+
+/* Map a batch of 4K frames next to each other at copy_addr_with_pt, perform
+ * all of their fills and unmap them again. Fills that continue from one frame
+ * into the next are done with a single copy across the window. */
+static void init_frame_window(CDL_Model *spec, CDL_ObjID *frames, int num_frames)
+{
+    for (int i = 0; i < num_frames; i++) {
+        int error = seL4_ARCH_Page_Map(orig_caps(frames[i]), seL4_CapInitThreadPD,
+                                       (seL4_Word)copy_addr_with_pt + i * PAGE_SIZE_4K,
+                                       seL4_ReadWrite, seL4_ARCH_Default_VMAttributes);
+        ZF_LOGF_IFERR(error, "");
+    }
+
+    struct file_copy copy = { .len = 0 };
+    for (int i = 0; i < num_frames; i++) {
+        fill_frame(spec, frames[i], (uintptr_t)copy_addr_with_pt + i * PAGE_SIZE_4K, &copy);
+    }
+    flush_file_copy(&copy);
+
+    for (int i = 0; i < num_frames; i++) {
+        int error = seL4_ARCH_Page_Unmap(orig_caps(frames[i]));
+        ZF_LOGF_IFERR(error, "");
+    }
+}
+
 static void init_frames(CDL_Model *spec)
 {
+    CDL_ObjID window[COPY_WINDOW_FRAMES];
+    int num_window = 0;
+
     for (CDL_ObjID obj_id = 0; obj_id < spec->num; obj_id++) {
-        if (spec->objects[obj_id].type == CDL_Frame) {
-            for (int i = 0; i < CONFIG_CAPDL_LOADER_FILLS_PER_FRAME
-                 && spec->objects[obj_id].frame_extra.fill[i].type != CDL_FrameFill_None; i++) {
-                CDL_FrameFill_Element_t frame_fill = spec->objects[obj_id].frame_extra.fill[i];
-                init_frame(spec, obj_id, frame_fill);
-            }
+        if (!frame_has_fills(spec, obj_id)) {
+            continue;
         }
+        /* 4K frames are batched into the window, larger frames are
+         * mapped on their own at copy_addr */
+        if (spec->objects[obj_id].size_bits != seL4_PageBits) {
+            init_frame(spec, obj_id);
+            continue;
+        }
+        window[num_window++] = obj_id;
+        if (num_window == COPY_WINDOW_FRAMES) {
+            init_frame_window(spec, window, num_window);
+            num_window = 0;
+        }
+    }
+    if (num_window > 0) {
+        init_frame_window(spec, window, num_window);
     }
 }
 
@@ -2061,6 +2173,7 @@ static void init_system(CDL_Model *spec)
     simple_default_init_bootinfo(&simple, bootinfo);
 
     init_copy_frame(bootinfo);
+    init_archive_index();
 
     parse_bootinfo(bootinfo, spec);
 
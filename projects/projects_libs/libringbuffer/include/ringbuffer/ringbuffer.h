@@ -12,13 +12,16 @@
 
 /* This interface allows a user to treat a region of memory as a ring buffer,
  * to which they read or write. It is intended for unidirectional communication
- * only.
+ * between a single sender and a single receiver.
  *
- * Note that, although it is not obvious from this interface, there is no flow
- * control provided. The effect of this is that a sender transmitting
- * characters at a rapid rate can have an entire buffer's worth of their data
- * missed by the receiver. This is semi-deliberate because any mechanism to
- * prevent this would introduce a back channel from the receiver to the sender.
+ * The start of the region holds a producer (head) and a consumer (tail) index,
+ * each on its own cache line, and the remainder is used for data. Both ends
+ * call rb_new on the same region, which must be zeroed before either end uses
+ * it (as shared dataports are). Any byte value, including 0, can be sent.
+ *
+ * The sender never overwrites data the receiver has not yet consumed. The
+ * transmit functions instead send as much as fits and return how much was
+ * sent.
  */
 
 #ifndef _RINGBUFFER_RINGBUFFER_H_
@@ -29,18 +32,50 @@
 /* Opaque type. Callers should be agnostic to the contents of this struct. */
 typedef struct ringbuffer ringbuffer_t;
 
+/* Optional hook used to signal or wait on the other end of the buffer.
+ *  cookie - Value given when the hook was installed.
+ */
+typedef void (*rb_notify_fn_t)(void *cookie);
+
 /* Create a new ring buffer.
- *  base - A pointer to the start of the region to use as the buffer.
+ *  base - A pointer to the start of the region to use as the buffer. Must be
+ *         64-byte (cache line) aligned, as the indices are laid out on
+ *         separate cache lines.
  *  size - The size of the buffer in bytes.
- * Returns NULL on failure.
+ * Returns NULL on failure, including if the region is too small to hold the
+ * indices and any data.
  */
 ringbuffer_t *rb_new(void *base, size_t size);
 
+/* Install a hook the sender calls after making new data available, for
+ * example to signal a notification the receiver waits on.
+ *  r - Buffer to send via.
+ *  notify - Function to call, or NULL to not notify.
+ *  cookie - Value to pass to notify.
+ */
+void rb_set_notify(ringbuffer_t *r, rb_notify_fn_t notify, void *cookie);
+
+/* Install a hook the receiver calls instead of spinning when it has to block
+ * for data, for example waiting on the notification the sender signals. The
+ * hook may return spuriously; the receiver rechecks for data each time.
+ *  r - Buffer to read from.
+ *  wait - Function to call, or NULL to busy wait.
+ *  cookie - Value to pass to wait.
+ */
+void rb_set_wait(ringbuffer_t *r, rb_notify_fn_t wait, void *cookie);
+
+/* Returns the number of bytes available to be received. */
+size_t rb_available(ringbuffer_t *r);
+
+/* Returns the number of bytes that can be sent before the buffer is full. */
+size_t rb_space(ringbuffer_t *r);
+
 /* Send a byte.
  *  r - Buffer to send via.
  *  c - Byte to send.
+ * Returns 1 if the byte was sent, or 0 if the buffer was full.
  */
-void rb_transmit_byte(ringbuffer_t *r, unsigned char c);
+size_t rb_transmit_byte(ringbuffer_t *r, unsigned char c);
 
 /* Receive a byte.
  *  r - Buffer to read from.
@@ -50,7 +85,8 @@ void rb_transmit_byte(ringbuffer_t *r, unsigned char c);
 unsigned char rb_receive_byte(ringbuffer_t *r);
 
 /* Poll for new data. Identical to rb_receive_byte, except it is non-blocking
- * and returns 0 to indicate no data available.
+ * and returns 0 to indicate no data available. As 0 is also a valid byte,
+ * callers sending binary data should check rb_available instead.
  */
 unsigned char rb_poll_byte(ringbuffer_t *r);
 
@@ -62,12 +98,12 @@ void rb_destroy(ringbuffer_t *r);
 /* Send a null-terminated string.
  *  r - Buffer to send via.
  *  s - String to send.
- & Returns the number of characters sent.
+ * Returns the number of characters sent.
  */
 size_t rb_transmit_string(ringbuffer_t *r, const char *s);
 
 /* Receive a string. Note, this function does not null-terminate the resulting
- * string.
+ * string. Does not return until len characters have been received.
  *  r - Buffer to read from.
  *  s - Location to receive into.
  *  len - Maximum characters to write into the destination location.
@@ -75,20 +111,21 @@ size_t rb_transmit_string(ringbuffer_t *r, const char *s);
  */
 size_t rb_receive_string(ringbuffer_t *r, char *s, size_t len);
 
-/* Send an arbitrary block of data. The block cannot contain any 0 bytes.
+/* Send an arbitrary block of data. Non-blocking.
  *  r - Buffer to send via.
  *  src - Location to read from.
  *  len - Number of bytes to send.
- * Returns the number of bytes sent.
+ * Returns the number of bytes sent, which is less than len if the buffer
+ * filled up.
  */
 size_t rb_transmit(ringbuffer_t *r, const void *src, size_t len);
 
-/* Receive an arbitrary block of data.
+/* Receive an arbitrary block of data. Non-blocking.
  *  r - Buffer to read from.
  *  dest - Location to write bytes received into.
  *  len - Maximum number of bytes to write to destination location.
  * Returns the number of bytes received.
  */
-size_t rb_receive(ringbuffer_t *r, void *dest, size_t len);
+size_t rb_receive_data(ringbuffer_t *r, void *dest, size_t len);
 
 #endif
@@ -12,63 +12,167 @@
 
 #include <assert.h>
 #include <ringbuffer/ringbuffer.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 
+#define RB_CACHE_LINE 64
+
+/* Layout of the shared region. The indices are free running and only ever
+ * written by one side each: head by the sender and tail by the receiver.
+ * Keeping them on separate cache lines stops the two ends from bouncing a
+ * line between them on every update.
+ */
+struct rb_shared {
+    uint32_t head __attribute__((aligned(RB_CACHE_LINE)));
+    uint32_t tail __attribute__((aligned(RB_CACHE_LINE)));
+    unsigned char data[] __attribute__((aligned(RB_CACHE_LINE)));
+};
+
 struct ringbuffer {
-    volatile unsigned char *base;
-    size_t size;
-    off_t offset;
+    struct rb_shared *shared;
+    /* Size of the data area. Always a power of two so the free running
+     * indices can be masked.
+     */
+    uint32_t size;
+    rb_notify_fn_t notify;
+    void *notify_cookie;
+    rb_notify_fn_t wait;
+    void *wait_cookie;
 };
 
+static inline uint32_t load_acquire(uint32_t *p) {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static inline void store_release(uint32_t *p, uint32_t v) {
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
 ringbuffer_t *rb_new(void *base, size_t size) {
-    ringbuffer_t *r = malloc(sizeof(*r));
+    if (base == NULL || (uintptr_t)base % RB_CACHE_LINE != 0 ||
+            size <= sizeof(struct rb_shared)) {
+        return NULL;
+    }
+
+    /* Use the largest power of two that fits after the indices. */
+    size_t data_size = size - sizeof(struct rb_shared);
+    if (data_size > UINT32_MAX / 2 + 1) {
+        data_size = UINT32_MAX / 2 + 1;
+    }
+    uint32_t pow2 = 1;
+    while ((size_t)pow2 * 2 <= data_size) {
+        pow2 *= 2;
+    }
+
+    ringbuffer_t *r = calloc(1, sizeof(*r));
     if (r == NULL) {
         return NULL;
     }
 
-    r->base = (volatile unsigned char*)base;
-    r->size = size;
-    r->offset = 0;
+    r->shared = (struct rb_shared*)base;
+    r->size = pow2;
     return r;
 }
 
-void rb_transmit_byte(ringbuffer_t *r, unsigned char c) {
-    /* We can't send 0s. */
-    if (c == 0) {
-        return;
+void rb_set_notify(ringbuffer_t *r, rb_notify_fn_t notify, void *cookie) {
+    r->notify = notify;
+    r->notify_cookie = cookie;
+}
+
+void rb_set_wait(ringbuffer_t *r, rb_notify_fn_t wait, void *cookie) {
+    r->wait = wait;
+    r->wait_cookie = cookie;
+}
+
+size_t rb_available(ringbuffer_t *r) {
+    uint32_t head = load_acquire(&r->shared->head);
+    uint32_t tail = __atomic_load_n(&r->shared->tail, __ATOMIC_RELAXED);
+    return head - tail;
+}
+
+size_t rb_space(ringbuffer_t *r) {
+    uint32_t head = __atomic_load_n(&r->shared->head, __ATOMIC_RELAXED);
+    uint32_t tail = load_acquire(&r->shared->tail);
+    return r->size - (head - tail);
+}
+
+size_t rb_transmit(ringbuffer_t *r, const void *src, size_t len) {
+    uint32_t head = __atomic_load_n(&r->shared->head, __ATOMIC_RELAXED);
+    uint32_t tail = load_acquire(&r->shared->tail);
+    size_t space = r->size - (head - tail);
+    if (len > space) {
+        len = space;
+    }
+    if (len == 0) {
+        return 0;
     }
 
-    /* Write 0 into the following slot in the buffer. We always need a zero
-     * following the last piece of data to indicate to the receiver where to
-     * wait for more data.
-     */
-    off_t next = (r->offset + 1) % r->size;
-    r->base[next] = 0;
+    /* Copy in at most two pieces, either side of the wrap point. */
+    uint32_t offset = head & (r->size - 1);
+    size_t first = r->size - offset;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(r->shared->data + offset, src, first);
+    memcpy(r->shared->data, (const unsigned char*)src + first, len - first);
 
-    /* Write the character and increment to the next slot for next time. */
-    r->base[r->offset] = c;
-    r->offset = next;
+    store_release(&r->shared->head, head + len);
+    if (r->notify != NULL) {
+        r->notify(r->notify_cookie);
+    }
+    return len;
 }
 
-unsigned char rb_poll_byte(ringbuffer_t *r) {
-    if (r->base[r->offset] != 0) {
+size_t rb_receive_data(ringbuffer_t *r, void *dest, size_t len) {
+    uint32_t tail = __atomic_load_n(&r->shared->tail, __ATOMIC_RELAXED);
+    uint32_t head = load_acquire(&r->shared->head);
+    size_t available = head - tail;
+    if (len > available) {
+        len = available;
+    }
+    if (len == 0) {
+        return 0;
+    }
+
+    uint32_t offset = tail & (r->size - 1);
+    size_t first = r->size - offset;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(dest, r->shared->data + offset, first);
+    memcpy((unsigned char*)dest + first, r->shared->data, len - first);
 
-        /* Read the data that's now available and increment to the next slot.
-         */
-        unsigned char c = r->base[r->offset];
-        r->offset = (r->offset + 1) % r->size;
+    store_release(&r->shared->tail, tail + len);
+    return len;
+}
+
+size_t rb_transmit_byte(ringbuffer_t *r, unsigned char c) {
+    return rb_transmit(r, &c, 1);
+}
+
+unsigned char rb_poll_byte(ringbuffer_t *r) {
+    unsigned char c = 0;
+    rb_receive_data(r, &c, 1);
+    return c;
+}
 
-        return c;
+/* Block until data is available, using the wait hook if one was given. */
+static void rb_wait_for_data(ringbuffer_t *r) {
+    while (rb_available(r) == 0) {
+        if (r->wait != NULL) {
+            r->wait(r->wait_cookie);
+        }
     }
-    return 0;
 }
 
 unsigned char rb_receive_byte(ringbuffer_t *r) {
     unsigned char c;
 
-    /* Busy wait for available data. */
-    while ((c = rb_poll_byte(r)) == 0);
+    while (rb_receive_data(r, &c, 1) == 0) {
+        rb_wait_for_data(r);
+    }
 
     return c;
 }
@@ -78,43 +182,16 @@ void rb_destroy(ringbuffer_t *r) {
 }
 
 size_t rb_transmit_string(ringbuffer_t *r, const char *s) {
-    size_t sent = 0;
-    while (*s != '\0') {
-        rb_transmit_byte(r, (unsigned char)*s);
-        sent++;
-        s++;
-    }
-    return sent;
+    return rb_transmit(r, s, strlen(s));
 }
 
 size_t rb_receive_string(ringbuffer_t *r, char *s, size_t len) {
     size_t received = 0;
-    while (len > 0) {
-        *s = (char)rb_receive_byte(r);
-        s++;
-        len--;
-    }
-    return received;
-}
-
-size_t rb_transmit(ringbuffer_t *r, const void *src, size_t len) {
-    size_t sent = 0;
-    unsigned char *s = (unsigned char*)src;
-    while (len > 0) {
-        rb_transmit_byte(r, *s);
-        s++;
-        len--;
-    }
-    return sent;
-}
-
-size_t rb_receive_data(ringbuffer_t *r, void *dest, size_t len) {
-    size_t received = 0;
-    unsigned char *d = (unsigned char*)dest;
-    while (len > 0) {
-        *d = rb_receive_byte(r);
-        d++;
-        len--;
+    while (received < len) {
+        received += rb_receive_data(r, s + received, len - received);
+        if (received < len) {
+            rb_wait_for_data(r);
+        }
     }
     return received;
 }
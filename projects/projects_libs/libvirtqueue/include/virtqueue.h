@@ -79,6 +79,7 @@ typedef struct virtqueue_driver {
 
     unsigned queue_len;         /* The number of entries in rings and descriptor table */
     unsigned free_desc_head;    /* The head of the free list in the descriptor table */
+    unsigned num_free_desc;     /* The number of entries in the free list */
     unsigned u_ring_last_seen;  /* Index of the last seen element in the used ring */
 
     struct vq_vring_avail *avail_ring; /* The available ring */
@@ -136,6 +137,13 @@ void virtqueue_init_used_ring(vq_vring_used_t *ring);
 int virtqueue_add_available_buf(virtqueue_driver_t *vq, virtqueue_ring_object_t *obj,
                                 void *buf, unsigned len, vq_flags_t flag);
 
+/* Get the number of free entries in the descriptor table. A scatter list of n buffers
+ * can be added if this is at least n.
+ * @param vq the driver virtqueue
+ * @return the number of free descriptors
+ */
+unsigned virtqueue_num_free_desc(virtqueue_driver_t *vq);
+
 /* Get buffer from used ring. Dequeue a buffer from the used ring and get an iterator to the scatterlist
  * @param vq the driver side virtqueue
  * @param robj a pointer to the iterator that will be returned
@@ -21,6 +21,7 @@ void virtqueue_init_driver(virtqueue_driver_t *vq, unsigned queue_len, vq_vring_
         ZF_LOGE("Invalid queue_len: %d, must be a power of 2.", queue_len);
     }
     vq->free_desc_head = 0;
+    vq->num_free_desc = queue_len;
     vq->queue_len = queue_len;
     vq->u_ring_last_seen = vq->queue_len - 1;
     vq->avail_ring = avail_ring;
@@ -84,6 +85,7 @@ static unsigned vq_add_desc(virtqueue_driver_t *vq, void *buf, unsigned len,
         return new;
     }
     vq->free_desc_head = vq->desc_table[new].next;
+    vq->num_free_desc--;
     desc = vq->desc_table + new;
 
     // casting pointers to integers directly is not allowed, must cast the
@@ -114,6 +116,7 @@ static unsigned vq_pop_desc(virtqueue_driver_t *vq, unsigned idx,
     *flag = vq->desc_table[idx].flags;
     vq->desc_table[idx].next = vq->free_desc_head;
     vq->free_desc_head = idx;
+    vq->num_free_desc++;
 
     return next;
 }
@@ -138,6 +141,11 @@ int virtqueue_add_available_buf(virtqueue_driver_t *vq, virtqueue_ring_object_t
     return 1;
 }
 
+unsigned virtqueue_num_free_desc(virtqueue_driver_t *vq)
+{
+    return vq->num_free_desc;
+}
+
 int virtqueue_get_used_buf(virtqueue_driver_t *vq, virtqueue_ring_object_t *obj, uint32_t *len)
 {
     unsigned next = (vq->u_ring_last_seen + 1) & (vq->queue_len - 1);
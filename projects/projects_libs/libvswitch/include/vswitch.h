@@ -20,11 +20,16 @@
 #include <net/ethernet.h>
 
 #include <virtqueue.h>
-
-/* TODO: Need to introduce or paramterise this variable into the
- * build system
- */
-#define VSWITCH_NUM_NODES           (4)
+#include <vswitch/gen_config.h>
+
+#define VSWITCH_NUM_NODES           (CONFIG_LIB_VSWITCH_NUM_NODES)
+/* Number of entries in the MAC forwarding table */
+#define VSWITCH_MAC_TABLE_SIZE      (1 << CONFIG_LIB_VSWITCH_MAC_TABLE_BITS)
+/* Learned addresses are forgotten once they have not been seen for this many
+ * ageing epochs. An epoch ends every VSWITCH_MAC_AGE_EPOCH_FRAMES frames that
+ * are learned from, or whenever "vswitch_age_macaddrs()" is called. */
+#define VSWITCH_MAC_MAX_AGE         4
+#define VSWITCH_MAC_AGE_EPOCH_FRAMES 1024
 /* MAC address print format*/
 #define PR_MAC802_ADDR                      "%x:%x:%x:%x:%x:%x"
 /* Expects a *pointer* to a struct ether_addr */
@@ -64,11 +69,33 @@ mac802_addr_eq_bcast(struct ether_addr *addr)
     return mac802_addr_eq(addr, &bcast_macaddr);
 }
 
+/* True for broadcast and multicast (group) addresses */
+static inline bool
+mac802_addr_is_group(struct ether_addr *addr)
+{
+    return addr->ether_addr_octet[0] & 0x01;
+}
+
 typedef struct vswitch_node_ {
     struct ether_addr addr;
     vswitch_virtqueues_t virtqueues;
 } vswitch_node_t;
 
+/*
+ * An entry in the MAC forwarding table. Entries either come from
+ * "vswitch_connect()", and live as long as the vswitch, or are learned from
+ * the source address of received frames and age out.
+ */
+typedef struct vswitch_mac_entry_ {
+    struct ether_addr addr;
+    bool in_use;
+    bool learned;
+    /* Index of the node frames for this address are forwarded to */
+    int node;
+    /* Ageing epoch the address was last seen in, for learned entries */
+    uint32_t last_seen;
+} vswitch_mac_entry_t;
+
 /*
  * Each component participating in a vswitch topology should have a
  * MAC address assigned to them. It is expected during the initialisation of
@@ -82,6 +109,15 @@ typedef struct vswitch_node_ {
 typedef struct vswitch_ {
     int n_connected;
     vswitch_node_t nodes[VSWITCH_NUM_NODES];
+    /* Open addressed hash table, keyed on MAC address */
+    vswitch_mac_entry_t mac_table[VSWITCH_MAC_TABLE_SIZE];
+    int n_learned;
+    uint32_t age_epoch;
+    /* Frames learned from in the current epoch */
+    uint32_t epoch_frames;
+    /* Indices of all connected nodes, which broadcast and multicast frames
+     * are flooded to */
+    int fanout[VSWITCH_NUM_NODES];
 } vswitch_t;
 
 /** Initialize an instance of this library
@@ -121,6 +157,48 @@ int vswitch_connect(vswitch_t *lib,
 int vswitch_get_destnode_index_by_macaddr(vswitch_t *lib,
                                           struct ether_addr *mac);
 
+/** Look up the set of nodes a frame with destination "mac" should be
+ * forwarded to. Broadcast and multicast addresses are flooded to all connected
+ * nodes; unicast addresses go to the node that registered or was learned for
+ * the address.
+ *
+ * @param lib Initialized instance of this library.
+ * @param mac Destination mac address of the frame.
+ * @param[out] indices Set to an array of node indices, valid until the next
+ *                     call that modifies the library.
+ * @return The number of entries in "indices". 0 if the destination is unknown.
+ */
+int vswitch_get_destnode_indices_by_macaddr(vswitch_t *lib,
+                                            struct ether_addr *mac,
+                                            const int **indices);
+
+/** Record that frames with source address "mac" arrived from the node at
+ * "index", so that frames addressed to "mac" are forwarded to that node.
+ * Addresses registered with "vswitch_connect()" are never overridden. This
+ * also ages the table, and if it is full the least recently seen learned
+ * address is forgotten to make room.
+ *
+ * @param lib Initialized instance of this library.
+ * @param mac Source mac address of a received frame.
+ * @param index Index of the node the frame arrived from.
+ * @return 0 on success, negative integer if the address or index is invalid.
+ */
+int vswitch_learn_macaddr(vswitch_t *lib,
+                          struct ether_addr *mac,
+                          int index);
+
+/** Advance the ageing epoch and forget learned addresses that have not been
+ * seen for "max_age" epochs. Epochs also advance as frames are learned from,
+ * so calling this is only needed to age out addresses on an idle switch.
+ * Lookups treat addresses older than VSWITCH_MAC_MAX_AGE as unknown.
+ *
+ * @param lib Initialized instance of this library.
+ * @param max_age Number of epochs a learned address stays valid without being
+ *                seen.
+ * @return The number of learned addresses removed.
+ */
+int vswitch_age_macaddrs(vswitch_t *lib, uint32_t max_age);
+
 /** Used to iterate through all the registered destinations indiscriminately.
  * @param lib Initialized instance of this library.
  * @param index Positive integer from 0 to VSWITCH_NUM_NODES.
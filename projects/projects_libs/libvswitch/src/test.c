@@ -0,0 +1,105 @@
+/*
+ * Copyright 2018, Data61
+ * Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+ * ABN 41 687 119 230.
+ *
+ * This software may be distributed and modified according to the terms of
+ * the GNU General Public License version 2. Note that NO WARRANTY is provided.
+ * See "LICENSE_GPLv2.txt" for details.
+ *
+ * @TAG(DATA61_GPL)
+ */
+
+#include <vswitch.h>
+#include <vswitch/test.h>
+
+#include <sel4test/test.h>
+#include <sel4test/testutil.h>
+
+void get_vswitch_tests(void)
+{
+}
+
+static struct ether_addr test_macaddr(int i)
+{
+    struct ether_addr mac = { .ether_addr_octet = {0x02, 0, 0, 0, (i >> 8) & 0xff, i & 0xff} };
+    return mac;
+}
+
+/* Connect two nodes. Their virtqueues are never used by the forwarding table */
+static void test_vswitch_setup(vswitch_t *lib)
+{
+    struct ether_addr node0 = test_macaddr(0xf000), node1 = test_macaddr(0xf001);
+    vswitch_init(lib);
+    vswitch_connect(lib, &node0, NULL, NULL);
+    vswitch_connect(lib, &node1, NULL, NULL);
+}
+
+static int test_vswitch_lookup(vswitch_t *lib, int i)
+{
+    struct ether_addr mac = test_macaddr(i);
+    const int *indices;
+    if (vswitch_get_destnode_indices_by_macaddr(lib, &mac, &indices) != 1) {
+        return -1;
+    }
+    return indices[0];
+}
+
+static vswitch_t test_lib;
+
+static int test_vswitch_age_expires(env_t env)
+{
+    vswitch_t *lib = &test_lib;
+    struct ether_addr mac = test_macaddr(1);
+
+    test_vswitch_setup(lib);
+    test_eq(vswitch_learn_macaddr(lib, &mac, 1), 0);
+    test_eq(test_vswitch_lookup(lib, 1), 1);
+
+    for (int i = 0; i < VSWITCH_MAC_MAX_AGE; i++) {
+        vswitch_age_macaddrs(lib, VSWITCH_MAC_MAX_AGE);
+    }
+    test_eq(test_vswitch_lookup(lib, 1), 1);
+
+    test_eq(vswitch_age_macaddrs(lib, VSWITCH_MAC_MAX_AGE), 1);
+    test_eq(test_vswitch_lookup(lib, 1), -1);
+
+    /* Connected nodes never expire */
+    test_eq(test_vswitch_lookup(lib, 0xf001), 1);
+    return sel4test_get_result();
+}
+DEFINE_TEST(VSWITCH_001, "Learned vswitch addresses expire", test_vswitch_age_expires, true)
+
+static int test_vswitch_age_on_learn(env_t env)
+{
+    vswitch_t *lib = &test_lib;
+    struct ether_addr stale = test_macaddr(1), busy = test_macaddr(2);
+
+    test_vswitch_setup(lib);
+    test_eq(vswitch_learn_macaddr(lib, &stale, 0), 0);
+
+    /* Traffic from other addresses alone ages the table */
+    for (int i = 0; i < VSWITCH_MAC_AGE_EPOCH_FRAMES * (VSWITCH_MAC_MAX_AGE + 1); i++) {
+        test_eq(vswitch_learn_macaddr(lib, &busy, 1), 0);
+    }
+    test_eq(test_vswitch_lookup(lib, 1), -1);
+    test_eq(test_vswitch_lookup(lib, 2), 1);
+    return sel4test_get_result();
+}
+DEFINE_TEST(VSWITCH_002, "vswitch addresses age as frames are learned", test_vswitch_age_on_learn, true)
+
+static int test_vswitch_learn_full(env_t env)
+{
+    vswitch_t *lib = &test_lib;
+
+    test_vswitch_setup(lib);
+    /* Learning keeps working once the table is full, by forgetting the least
+     * recently seen address */
+    for (int i = 0; i < VSWITCH_MAC_TABLE_SIZE; i++) {
+        struct ether_addr mac = test_macaddr(i);
+        test_eq(vswitch_learn_macaddr(lib, &mac, i % 2), 0);
+        test_eq(test_vswitch_lookup(lib, i), i % 2);
+    }
+    return sel4test_get_result();
+}
+DEFINE_TEST(VSWITCH_003, "vswitch learning evicts when the table is full", test_vswitch_learn_full, true)
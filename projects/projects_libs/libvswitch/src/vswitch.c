@@ -18,6 +18,7 @@
 #include <vswitch.h>
 #include <utils/zf_log.h>
 #include <utils/fence.h>
+#include <utils/compile_time.h>
 
 struct ether_addr null_macaddr = { .ether_addr_octet = {0, 0, 0, 0, 0, 0} };
 struct ether_addr bcast_macaddr = { .ether_addr_octet = {
@@ -25,15 +26,95 @@ struct ether_addr bcast_macaddr = { .ether_addr_octet = {
     }
 };
 
-static int vswitch_find_free_slot(vswitch_t *lib)
+compile_time_assert(vswitch_mac_table_large_enough,
+                    VSWITCH_MAC_TABLE_SIZE >= 2 * VSWITCH_NUM_NODES);
+
+/* Learned addresses may only fill the table up to this point, so that probe
+ * sequences stay short and there is always room for connecting nodes. */
+#define VSWITCH_MAX_LEARNED (VSWITCH_MAC_TABLE_SIZE / 2 - VSWITCH_NUM_NODES)
+
+static inline uint32_t vswitch_mac_hash(struct ether_addr *mac)
+{
+    /* FNV-1a */
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < ETH_ALEN; i++) {
+        hash ^= mac->ether_addr_octet[i];
+        hash *= 16777619u;
+    }
+    return hash & (VSWITCH_MAC_TABLE_SIZE - 1);
+}
+
+/* Returns the slot holding "mac", or the empty slot that terminated the probe
+ * sequence if it is not present. */
+static int vswitch_mac_table_probe(vswitch_t *lib, struct ether_addr *mac)
+{
+    uint32_t slot = vswitch_mac_hash(mac);
+    while (lib->mac_table[slot].in_use &&
+           !mac802_addr_eq(&lib->mac_table[slot].addr, mac)) {
+        slot = (slot + 1) & (VSWITCH_MAC_TABLE_SIZE - 1);
+    }
+    return slot;
+}
+
+static void vswitch_mac_table_remove(vswitch_t *lib, int slot)
 {
-    for (int i = 0; i < VSWITCH_NUM_NODES; i++) {
-        if (mac802_addr_eq((void *)&lib->nodes[i].addr, &null_macaddr)) {
-            return i;
+    /* Backward shift deletion: move later entries of the same probe
+     * sequence into the hole so that lookups never need tombstones. */
+    uint32_t hole = slot;
+    uint32_t next = (hole + 1) & (VSWITCH_MAC_TABLE_SIZE - 1);
+    while (lib->mac_table[next].in_use) {
+        uint32_t home = vswitch_mac_hash(&lib->mac_table[next].addr);
+        /* Only move the entry if its home slot is not in (hole, next] */
+        if (((next - home) & (VSWITCH_MAC_TABLE_SIZE - 1)) >=
+            ((next - hole) & (VSWITCH_MAC_TABLE_SIZE - 1))) {
+            lib->mac_table[hole] = lib->mac_table[next];
+            hole = next;
         }
+        next = (next + 1) & (VSWITCH_MAC_TABLE_SIZE - 1);
     }
+    lib->mac_table[hole].in_use = false;
+}
 
-    return -1;
+static bool vswitch_mac_entry_expired(vswitch_t *lib, vswitch_mac_entry_t *entry,
+                                      uint32_t max_age)
+{
+    return entry->learned && lib->age_epoch - entry->last_seen > max_age;
+}
+
+static vswitch_mac_entry_t *vswitch_mac_table_find(vswitch_t *lib, struct ether_addr *mac)
+{
+    int slot = vswitch_mac_table_probe(lib, mac);
+    vswitch_mac_entry_t *entry = &lib->mac_table[slot];
+    if (!entry->in_use) {
+        return NULL;
+    }
+    if (vswitch_mac_entry_expired(lib, entry, VSWITCH_MAC_MAX_AGE)) {
+        /* Age out stale addresses as they are looked up, so a frame is never
+         * forwarded on an expired binding */
+        vswitch_mac_table_remove(lib, slot);
+        lib->n_learned--;
+        return NULL;
+    }
+    return entry;
+}
+
+/* Forget the least recently seen learned address. Only used when the table
+ * is full, so the scan is rare. */
+static void vswitch_mac_table_evict_oldest(vswitch_t *lib)
+{
+    int oldest = -1;
+    for (int i = 0; i < VSWITCH_MAC_TABLE_SIZE; i++) {
+        vswitch_mac_entry_t *entry = &lib->mac_table[i];
+        if (entry->in_use && entry->learned &&
+            (oldest < 0 || lib->age_epoch - entry->last_seen >
+             lib->age_epoch - lib->mac_table[oldest].last_seen)) {
+            oldest = i;
+        }
+    }
+    if (oldest >= 0) {
+        vswitch_mac_table_remove(lib, oldest);
+        lib->n_learned--;
+    }
 }
 
 int vswitch_init(vswitch_t *lib)
@@ -59,20 +140,34 @@ int vswitch_connect(vswitch_t *lib,
         return -1;
     }
 
-    slot = vswitch_find_free_slot(lib);
-    if (slot < 0) {
-        ZF_LOGE("Failed to find free slot for new client " PR_MAC802_ADDR ".",
+    vswitch_mac_entry_t *entry = &lib->mac_table[vswitch_mac_table_probe(lib, guest_macaddr)];
+    if (entry->in_use && !entry->learned) {
+        ZF_LOGE("Client " PR_MAC802_ADDR " is already connected.",
                 PR_MAC802_ADDR_ARGS(guest_macaddr));
         return -1;
     }
+    if (entry->in_use) {
+        /* A connecting node takes over an address learned elsewhere */
+        lib->n_learned--;
+    }
+
+    /* Nodes are never disconnected, so they are allocated in order */
+    slot = lib->n_connected;
 
     /* Fill out the node structure */
     memcpy((void *)&lib->nodes[slot].addr, guest_macaddr,
            sizeof(*guest_macaddr));
     lib->nodes[slot].virtqueues.send_queue = send_virtqueue;
     lib->nodes[slot].virtqueues.recv_queue = recv_virtqueue;
+    lib->fanout[lib->n_connected] = slot;
     lib->n_connected++;
 
+    /* And the forwarding table */
+    entry->addr = *guest_macaddr;
+    entry->in_use = true;
+    entry->learned = false;
+    entry->node = slot;
+
     ZF_LOGI("Added new route to guest at MAC " PR_MAC802_ADDR,
             PR_MAC802_ADDR_ARGS(guest_macaddr));
 
@@ -82,18 +177,106 @@ int vswitch_connect(vswitch_t *lib,
 int vswitch_get_destnode_index_by_macaddr(vswitch_t *lib,
                                           struct ether_addr *mac)
 {
-    for (int i = 0; i < VSWITCH_NUM_NODES; i++) {
-        if (mac802_addr_eq((void *)&lib->nodes[i].addr, mac)) {
-            return i;
+    vswitch_mac_entry_t *entry = vswitch_mac_table_find(lib, mac);
+    if (entry == NULL) {
+        return -1;
+    }
+
+    return entry->node;
+}
+
+int vswitch_get_destnode_indices_by_macaddr(vswitch_t *lib,
+                                            struct ether_addr *mac,
+                                            const int **indices)
+{
+    if (mac802_addr_is_group(mac)) {
+        *indices = lib->fanout;
+        return lib->n_connected;
+    }
+
+    vswitch_mac_entry_t *entry = vswitch_mac_table_find(lib, mac);
+    if (entry == NULL) {
+        return 0;
+    }
+
+    *indices = &entry->node;
+    return 1;
+}
+
+int vswitch_learn_macaddr(vswitch_t *lib,
+                          struct ether_addr *mac,
+                          int index)
+{
+    if (index < 0 || index >= lib->n_connected) {
+        return -1;
+    }
+    if (mac802_addr_is_group(mac) || mac802_addr_eq(mac, &null_macaddr)) {
+        /* Group and null addresses are never valid sources */
+        return -1;
+    }
+
+    if (++lib->epoch_frames >= VSWITCH_MAC_AGE_EPOCH_FRAMES) {
+        vswitch_age_macaddrs(lib, VSWITCH_MAC_MAX_AGE);
+    }
+
+    vswitch_mac_entry_t *entry = &lib->mac_table[vswitch_mac_table_probe(lib, mac)];
+    if (entry->in_use) {
+        if (entry->learned) {
+            /* Addresses may move between nodes */
+            entry->node = index;
+            entry->last_seen = lib->age_epoch;
+        }
+        return 0;
+    }
+
+    if (lib->n_learned >= VSWITCH_MAX_LEARNED) {
+        /* Removing an entry can shift others, so probe again */
+        vswitch_mac_table_evict_oldest(lib);
+        if (lib->n_learned >= VSWITCH_MAX_LEARNED) {
+            return -1;
+        }
+        entry = &lib->mac_table[vswitch_mac_table_probe(lib, mac)];
+    }
+
+    entry->addr = *mac;
+    entry->in_use = true;
+    entry->learned = true;
+    entry->node = index;
+    entry->last_seen = lib->age_epoch;
+    lib->n_learned++;
+    return 0;
+}
+
+int vswitch_age_macaddrs(vswitch_t *lib, uint32_t max_age)
+{
+    int removed = 0;
+
+    lib->age_epoch++;
+    lib->epoch_frames = 0;
+    if (lib->n_learned == 0) {
+        return 0;
+    }
+
+    for (int i = 0; i < VSWITCH_MAC_TABLE_SIZE;) {
+        vswitch_mac_entry_t *entry = &lib->mac_table[i];
+        if (entry->in_use && entry->learned &&
+            lib->age_epoch - entry->last_seen > max_age) {
+            vswitch_mac_table_remove(lib, i);
+            lib->n_learned--;
+            removed++;
+            /* Another entry may have been shifted into this slot */
+            continue;
         }
+        i++;
     }
 
-    return -1;
+    return removed;
 }
 
 vswitch_node_t *vswitch_get_destnode_by_index(vswitch_t *lib, size_t index)
 {
-    if (mac802_addr_eq((void *)&lib->nodes[index].addr, &null_macaddr)) {
+    if (index >= VSWITCH_NUM_NODES ||
+        mac802_addr_eq((void *)&lib->nodes[index].addr, &null_macaddr)) {
         /* If the index requested is has a NULL mac addr in it, return
          * error.
          */
@@ -185,6 +185,21 @@ void allocman_mspace_free(allocman_t *alloc, void *ptr, size_t bytes);
  */
 int allocman_cspace_alloc(allocman_t *alloc, cspacepath_t *slot);
 
+/**
+ * Allocates num contiguous cslots in a single cnode, so that they can all be the destination
+ * of one Untyped_Retype. The slots are slot->capPtr to slot->capPtr + num - 1 and are freed
+ * individually with {@link #allocman_cspace_free}. This is an optimisation, and unlike
+ * {@link #allocman_cspace_alloc} it does not fall back to the reserves, so callers should be
+ * prepared to allocate slots one at a time instead.
+ *
+ * @param alloc Allocman to allocate from
+ * @param num Number of slots to allocate
+ * @param slot Stores details of the first allocated slot, with a window of num
+ *
+ * @return returns 0 on sucess
+ */
+int allocman_cspace_alloc_range(allocman_t *alloc, size_t num, cspacepath_t *slot);
+
 /**
  * Frees a cslot from the allocator, as previously allocated by {@link #allocman_cspace_alloc}.
  * To avoid the need to keep cspacepath_t's laying around, it is guaruanteed that
@@ -250,6 +265,26 @@ seL4_Word allocman_utspace_alloc(allocman_t *alloc, size_t size_bits, seL4_Word
     return allocman_utspace_alloc_at(alloc, size_bits, type, path, ALLOCMAN_NO_PADDR, canBeDev, _error);
 }
 
+/**
+ * Allocates a portion of untyped memory, and retypes it into num objects of the same type
+ * with a single seL4_Untyped_Retype. Like {@link #allocman_cspace_alloc_range} this does not
+ * fall back to the reserves.
+ *
+ * @param alloc Allocman to allocate from
+ * @param size_bits The size in bits of the memory that will be required to store each object.
+    This is different to seL4_Untyped_Retype for allocating seL4_CapTableObjects
+ * @param type The seL4 type of the objects being allocated
+ * @param path A path to the first of num contiguous empty slots, as allocated by
+ *  {@link #allocman_cspace_alloc_range}
+ * @param num The number of objects to allocate
+ * @param canBeDev Whether this allocation can be satisified from a device region, provided that
+ *  region is known to be actual RAM. Objects from device regions are not initialized (i.e. not zeroed)
+ * @param cookies Array of num cookies, one per object, that are used to free each object
+ *
+ * @return returns 0 on success
+ */
+int allocman_utspace_alloc_range(allocman_t *alloc, size_t size_bits, seL4_Word type, const cspacepath_t *path, size_t num, bool canBeDev, seL4_Word *cookies);
+
 /**
  * Returns a portion of untyped memory back to the allocator. It is assumed that this
  * memory is now unused, and every capability to this memory has been deleted (including
@@ -16,6 +16,8 @@ typedef struct cspace_interface {
     int (*alloc)(struct allocman *alloc, void *cookie, cspacepath_t *path);
     void (*free)(struct allocman *alloc, void *cookie, const cspacepath_t *path);
     cspacepath_t (*make_path)(void *cookie, seL4_CPtr slot);
+    /* Optional. Allocates num contiguous slots in a single cnode */
+    int (*alloc_range)(struct allocman *alloc, void *cookie, size_t num, cspacepath_t *path);
     struct allocman_properties properties;
     void *cspace;
 } cspace_interface_t;
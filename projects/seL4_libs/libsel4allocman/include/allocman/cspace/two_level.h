@@ -68,6 +68,7 @@ seL4_CPtr _cspace_two_level_boot_alloc(struct allocman *alloc, void *_cspace, in
 int _cspace_two_level_alloc(struct allocman *alloc, void *_cspace, cspacepath_t *slot);
 void _cspace_two_level_free(struct allocman *alloc, void *_cspace, const cspacepath_t *slot);
 int _cspace_two_level_alloc_at(struct allocman *alloc, void *_cspace, seL4_CPtr slot);
+int _cspace_two_level_alloc_range(struct allocman *alloc, void *_cspace, size_t num, cspacepath_t *slot);
 
 cspacepath_t _cspace_two_level_make_path(void *_cspace, seL4_CPtr slot);
 
@@ -76,6 +77,7 @@ static inline cspace_interface_t cspace_two_level_make_interface(cspace_two_leve
         .alloc = _cspace_two_level_alloc,
         .free = _cspace_two_level_free,
         .make_path = _cspace_two_level_make_path,
+        .alloc_range = _cspace_two_level_alloc_range,
         /* We do not want to handle recursion, as it shouldn't happen */
         .properties = ALLOCMAN_DEFAULT_PROPERTIES,
         .cspace = cspace
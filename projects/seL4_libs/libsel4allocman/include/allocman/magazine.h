@@ -0,0 +1,108 @@
+/*
+ * Copyright 2017, Data61, CSIRO (ABN 41 687 119 230)
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <sel4/types.h>
+#include <vka/vka.h>
+#include <vka/object.h>
+#include <allocman/allocman.h>
+
+/*
+ * Magazines allow an allocman to be shared between threads. The allocman itself
+ * is not thread safe, so every call into it is made while holding a lock that
+ * the user provides. To keep that lock uncontended each thread allocates through
+ * its own magazine, which caches free cslots and preallocated small objects and
+ * only takes the lock to refill or drain them in batches.
+ *
+ * The allocman must not itself allocate through a magazine vka, for instance as
+ * the vka of a vspace backing its mspace, as the lock is not recursive.
+ */
+
+/* Number of cslots, or objects of each type, cached by a magazine */
+#define ALLOCMAN_MAGAZINE_SIZE 16
+/* Number of items moved between a magazine and the shared allocman at a time */
+#define ALLOCMAN_MAGAZINE_BATCH (ALLOCMAN_MAGAZINE_SIZE / 2)
+
+/* Object types cached by a magazine, any other allocations go straight to the
+ * shared allocman */
+enum allocman_magazine_cache_type {
+    ALLOCMAN_MAGAZINE_FRAME,
+    ALLOCMAN_MAGAZINE_TCB,
+    ALLOCMAN_MAGAZINE_ENDPOINT,
+    ALLOCMAN_MAGAZINE_NOTIFICATION,
+    ALLOCMAN_MAGAZINE_NUM_CACHES
+};
+
+typedef struct allocman_lock_ops {
+    /* Acquire and release the lock protecting the allocman, for instance a sync_mutex_t */
+    void (*lock)(void *cookie);
+    void (*unlock)(void *cookie);
+    void *cookie;
+} allocman_lock_ops_t;
+
+/* An allocman and the lock that protects it */
+typedef struct allocman_shared {
+    allocman_t *alloc;
+    /* vka of the allocman, only used while holding the lock */
+    vka_t vka;
+    allocman_lock_ops_t lock;
+} allocman_shared_t;
+
+struct allocman_magazine_cache {
+    seL4_Word type;
+    seL4_Word size_bits;
+    size_t count;
+    vka_object_t objects[ALLOCMAN_MAGAZINE_SIZE];
+};
+
+typedef struct allocman_magazine {
+    allocman_shared_t *shared;
+    size_t num_slots;
+    seL4_CPtr slots[ALLOCMAN_MAGAZINE_SIZE];
+    struct allocman_magazine_cache caches[ALLOCMAN_MAGAZINE_NUM_CACHES];
+    /* utspace frees are queued and returned to the allocman in batches */
+    size_t num_frees;
+    struct {
+        seL4_Word type;
+        seL4_Word size_bits;
+        seL4_Word cookie;
+    } frees[ALLOCMAN_MAGAZINE_SIZE];
+} allocman_magazine_t;
+
+/**
+ * Share an allocman between threads
+ *
+ * @param shared Structure to initialize
+ * @param alloc Allocman to share. After this call it should only be used through magazines
+ * @param lock Lock used to serialise calls into the allocman
+ */
+void allocman_shared_init(allocman_shared_t *shared, allocman_t *alloc, allocman_lock_ops_t lock);
+
+/**
+ * Create a magazine for a single thread. Magazines start empty and are filled on demand
+ *
+ * @param mag Magazine to initialize
+ * @param shared Shared allocman to refill the magazine from
+ */
+void allocman_magazine_init(allocman_magazine_t *mag, allocman_shared_t *shared);
+
+/**
+ * Return everything cached in a magazine to the shared allocman
+ *
+ * @param mag Magazine to drain. It can be reused afterwards
+ */
+void allocman_magazine_drain(allocman_magazine_t *mag);
+
+/**
+ * Make a VKA object that allocates through a magazine. The vka, like the magazine,
+ * must only be used by a single thread
+ *
+ * @param vka Structure for the vka interface object
+ * @param mag Magazine to allocate through
+ */
+void allocman_magazine_make_vka(vka_t *vka, allocman_magazine_t *mag);
@@ -0,0 +1,9 @@
+/*
+ * Copyright 2017, Data61, CSIRO (ABN 41 687 119 230)
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+#pragma once
+
+/* Referenced by test applications so that the allocman tests are linked in */
+void get_allocman_magazine_tests(void);
@@ -15,6 +15,8 @@
 /* This is an untyped manager that works by splitting each untyped in half to
  * create smaller untypeds. */
 
+struct utspace_split_pool;
+
 struct utspace_split_node {
     cspacepath_t ut;
     /* if this is a child node, represents our parent. Our parent must by
@@ -22,23 +24,55 @@ struct utspace_split_node {
     struct utspace_split_node *parent;
     /* if we have a parent, then this is a pointer to our other sibling */
     struct utspace_split_node *sibling;
-    /* which (if any) free list this is in */
-    struct utspace_split_node **head;
-    /* which free list this should go back into */
-    struct utspace_split_node **origin_head;
+    /* pool this node belongs to, and the size of the node */
+    struct utspace_split_pool *pool;
+    size_t size_bits;
+    /* whether this node is in the free list of its pool */
+    bool free;
     /* physical address of the node */
     uintptr_t paddr;
     /* if this node is not allocated then these are the next/previous pointers in the free list */
     struct utspace_split_node *next, *prev;
+    /* if this node is not allocated and has a physical address then these are its
+     * children in the address index of its pool */
+    struct utspace_split_node *left, *right;
+};
+
+/* A group of objects created by a single retype from one node. The node is only
+ * returned to the pool once every object in the group has been freed. */
+struct utspace_split_range {
+    struct utspace_split_node *node;
+    /* size of the node the objects were created from */
+    size_t node_size_bits;
+    /* size of each object */
+    size_t size_bits;
+    /* number of objects created, and the number not yet freed */
+    size_t num;
+    size_t live;
+    /* the cookie of each object is the address of its entry, tagged with
+     * UTSPACE_SPLIT_RANGE_COOKIE to distinguish it from a node */
+    struct utspace_split_range_entry {
+        struct utspace_split_range *range;
+    } entries[];
+};
+
+#define UTSPACE_SPLIT_RANGE_COOKIE 1
+
+struct utspace_split_pool {
+    /* free nodes of each size, in no particular order */
+    struct utspace_split_node *heads[CONFIG_WORD_SIZE];
+    /* free nodes of each size that have a physical address, as a search tree
+     * ordered by that address */
+    struct utspace_split_node *index[CONFIG_WORD_SIZE];
 };
 
 typedef struct utspace_split {
     /* untypeds from the kernel window. Used for anything */
-    struct utspace_split_node *heads[CONFIG_WORD_SIZE];
+    struct utspace_split_pool kernel;
     /* untypeds that are unknown device regions */
-    struct utspace_split_node *dev_heads[CONFIG_WORD_SIZE];
+    struct utspace_split_pool dev;
     /* untypeds that are known to be RAM from the device region */
-    struct utspace_split_node *dev_mem_heads[CONFIG_WORD_SIZE];
+    struct utspace_split_pool dev_mem;
 } utspace_split_t;
 
 void utspace_split_create(utspace_split_t *split);
@@ -46,6 +80,7 @@ int _utspace_split_add_uts(struct allocman *alloc, void *_split, size_t num, con
 
 seL4_Word _utspace_split_alloc(struct allocman *alloc, void *_split, size_t size_bits, seL4_Word type, const cspacepath_t *slot, uintptr_t paddr, bool canBeDev, int *error);
 void _utspace_split_free(struct allocman *alloc, void *_split, seL4_Word cookie, size_t size_bits);
+int _utspace_split_alloc_range(struct allocman *alloc, void *_split, size_t size_bits, seL4_Word type, const cspacepath_t *slot, size_t num, bool canBeDev, seL4_Word *cookies);
 
 uintptr_t _utspace_split_paddr(void *_split, seL4_Word cookie, size_t size_bits);
 
@@ -53,6 +88,7 @@ static inline struct utspace_interface utspace_split_make_interface(utspace_spli
     return (struct utspace_interface) {
         .alloc = _utspace_split_alloc,
         .free = _utspace_split_free,
+        .alloc_range = _utspace_split_alloc_range,
         .add_uts = _utspace_split_add_uts,
         .paddr = _utspace_split_paddr,
         .properties = ALLOCMAN_DEFAULT_PROPERTIES,
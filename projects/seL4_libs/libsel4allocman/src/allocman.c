@@ -319,6 +319,44 @@ seL4_Word allocman_utspace_alloc_at(allocman_t *alloc, size_t size_bits, seL4_Wo
     return _allocman_utspace_alloc(alloc, size_bits, type, path, paddr, canBeDev, _error, 1);
 }
 
+int allocman_cspace_alloc_range(allocman_t *alloc, size_t num, cspacepath_t *slot)
+{
+    int root_op;
+    int error;
+    if (!alloc->have_cspace || !alloc->cspace.alloc_range) {
+        return 1;
+    }
+    /* There are no reserves of slot ranges, so a recursive allocation just fails */
+    if (!_can_alloc(alloc->cspace.properties, alloc->cspace_alloc_depth, alloc->cspace_free_depth)) {
+        return 1;
+    }
+    root_op = _start_operation(alloc);
+    alloc->cspace_alloc_depth++;
+    error = alloc->cspace.alloc_range(alloc, alloc->cspace.cspace, num, slot);
+    alloc->cspace_alloc_depth--;
+    _end_operation(alloc, root_op);
+    return error;
+}
+
+int allocman_utspace_alloc_range(allocman_t *alloc, size_t size_bits, seL4_Word type, const cspacepath_t *path, size_t num, bool canBeDev, seL4_Word *cookies)
+{
+    int root_op;
+    int error;
+    if (!alloc->have_utspace || !alloc->utspace.alloc_range) {
+        return 1;
+    }
+    /* There are no reserves of object ranges, so a recursive allocation just fails */
+    if (!_can_alloc(alloc->utspace.properties, alloc->utspace_alloc_depth, alloc->utspace_free_depth)) {
+        return 1;
+    }
+    root_op = _start_operation(alloc);
+    alloc->utspace_alloc_depth++;
+    error = alloc->utspace.alloc_range(alloc, alloc->utspace.utspace, size_bits, type, path, num, canBeDev, cookies);
+    alloc->utspace_alloc_depth--;
+    _end_operation(alloc, root_op);
+    return error;
+}
+
 static int _refill_watermark(allocman_t *alloc)
 {
     int found_empty_pool;
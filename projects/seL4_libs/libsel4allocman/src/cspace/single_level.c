@@ -87,6 +87,43 @@ int _cspace_single_level_alloc_at(allocman_t *alloc, void *_cspace, seL4_CPtr sl
     return 0;
 }
 
+int _cspace_single_level_alloc_range(allocman_t *alloc, void *_cspace, size_t num, cspacepath_t *slot)
+{
+    cspace_single_level_t *cspace = (cspace_single_level_t*)_cspace;
+    size_t num_slots = cspace->bitmap_length * BITS_PER_WORD;
+    size_t run = 0;
+    size_t i = 0;
+    size_t start;
+    if (num == 0) {
+        return 1;
+    }
+    /* find the first run of num free slots */
+    while (i < num_slots && run < num) {
+        size_t word = cspace->bitmap[i / BITS_PER_WORD];
+        if (i % BITS_PER_WORD == 0 && word == 0) {
+            /* skip whole words that are allocated */
+            run = 0;
+            i += BITS_PER_WORD;
+        } else if (word & BIT(i % BITS_PER_WORD)) {
+            run++;
+            i++;
+        } else {
+            run = 0;
+            i++;
+        }
+    }
+    if (run < num) {
+        return 1;
+    }
+    start = i - num;
+    for (i = start; i < start + num; i++) {
+        cspace->bitmap[i / BITS_PER_WORD] &= ~BIT(i % BITS_PER_WORD);
+    }
+    *slot = _cspace_single_level_make_path(cspace, cspace->config.first_slot + start);
+    slot->window = num;
+    return 0;
+}
+
 void _cspace_single_level_free(allocman_t *alloc, void *_cspace, const cspacepath_t *slot)
 {
     cspace_single_level_t *cspace = (cspace_single_level_t*)_cspace;
@@ -226,6 +226,60 @@ static void _destroy_second_level(allocman_t *alloc, cspace_two_level_t *cspace,
     _cspace_single_level_free(alloc, &cspace->first_level, &path);
 }
 
+int _cspace_two_level_alloc_range(allocman_t *alloc, void *_cspace, size_t num, cspacepath_t *slot)
+{
+    cspace_two_level_t *cspace = (cspace_two_level_t *)_cspace;
+    size_t i;
+    int found;
+    int first;
+    int error;
+    cspacepath_t level2_slot;
+    /* the range has to fit within a single second level cnode, which like
+     * _cspace_two_level_alloc never fills more than MASK(level_two_bits) slots of */
+    if (num == 0 || num > MASK(cspace->config.level_two_bits)) {
+        return 1;
+    }
+    /* Hunt for a second level with a large enough free range */
+    i = cspace->last_second_level;
+    found = 0;
+    first = 1;
+    while (!found && (first || i != cspace->last_second_level)) {
+        first = 0;
+        if (cspace->second_levels[i] && cspace->second_levels[i]->count + num <= MASK(cspace->config.level_two_bits)
+                && !_cspace_single_level_alloc_range(alloc, &cspace->second_levels[i]->second_level, num, &level2_slot)) {
+            found = 1;
+        } else {
+            i = (i + 1) % BIT(cspace->config.cnode_size_bits);
+        }
+    }
+    if (!found) {
+        /* ask the first level node for an empty slot */
+        cspacepath_t l1slot;
+        error = _cspace_single_level_alloc(alloc, &cspace->first_level, &l1slot);
+        if (error) {
+            /* our cspace is just full */
+            return error;
+        }
+        /* use this index */
+        error = _create_second_level(alloc, cspace, l1slot.offset, 1);
+        if (error) {
+            return error;
+        }
+        i = l1slot.offset;
+        error = _cspace_single_level_alloc_range(alloc, &cspace->second_levels[i]->second_level, num, &level2_slot);
+        if (error) {
+            _destroy_second_level(alloc, cspace, i);
+            cspace->second_levels[i] = NULL;
+            return error;
+        }
+    }
+    cspace->last_second_level = i;
+    cspace->second_levels[i]->count += num;
+    *slot = _cspace_two_level_make_path(cspace, (i << cspace->config.level_two_bits) | level2_slot.capPtr);
+    slot->window = num;
+    return 0;
+}
+
 void _cspace_two_level_free(struct allocman *alloc, void *_cspace, const cspacepath_t *slot)
 {
     size_t l1slot;
@@ -0,0 +1,331 @@
+/*
+ * Copyright 2017, Data61, CSIRO (ABN 41 687 119 230)
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <allocman/allocman.h>
+#include <allocman/magazine.h>
+#include <allocman/vka.h>
+#include <assert.h>
+#include <string.h>
+#include <sel4/sel4.h>
+#include <vka/capops.h>
+#include <vka/object.h>
+#include <utils/util.h>
+
+static inline void _shared_lock(allocman_shared_t *shared)
+{
+    shared->lock.lock(shared->lock.cookie);
+}
+
+static inline void _shared_unlock(allocman_shared_t *shared)
+{
+    shared->lock.unlock(shared->lock.cookie);
+}
+
+void allocman_shared_init(allocman_shared_t *shared, allocman_t *alloc, allocman_lock_ops_t lock)
+{
+    assert(shared);
+    assert(alloc);
+    assert(lock.lock && lock.unlock);
+    shared->alloc = alloc;
+    shared->lock = lock;
+    allocman_make_vka(&shared->vka, alloc);
+}
+
+void allocman_magazine_init(allocman_magazine_t *mag, allocman_shared_t *shared)
+{
+    assert(mag);
+    assert(shared);
+    memset(mag, 0, sizeof(*mag));
+    mag->shared = shared;
+    mag->caches[ALLOCMAN_MAGAZINE_FRAME].type = seL4_ARCH_4KPage;
+    mag->caches[ALLOCMAN_MAGAZINE_FRAME].size_bits = seL4_PageBits;
+    mag->caches[ALLOCMAN_MAGAZINE_TCB].type = seL4_TCBObject;
+    mag->caches[ALLOCMAN_MAGAZINE_TCB].size_bits = seL4_TCBBits;
+    mag->caches[ALLOCMAN_MAGAZINE_ENDPOINT].type = seL4_EndpointObject;
+    mag->caches[ALLOCMAN_MAGAZINE_ENDPOINT].size_bits = seL4_EndpointBits;
+    mag->caches[ALLOCMAN_MAGAZINE_NOTIFICATION].type = seL4_NotificationObject;
+    mag->caches[ALLOCMAN_MAGAZINE_NOTIFICATION].size_bits = seL4_NotificationBits;
+}
+
+/* The following functions must be called with the shared lock held */
+
+static int _magazine_refill_slots(allocman_magazine_t *mag)
+{
+    vka_t *vka = &mag->shared->vka;
+    seL4_CPtr first;
+    size_t i;
+
+    assert(mag->num_slots == 0);
+    /* Prefer a contiguous range, as that is a single operation on the cspace */
+    if (vka->cspace_alloc_range && vka_cspace_alloc_range(vka, ALLOCMAN_MAGAZINE_BATCH, &first) == 0) {
+        for (i = 0; i < ALLOCMAN_MAGAZINE_BATCH; i++) {
+            mag->slots[mag->num_slots++] = first + i;
+        }
+        return 0;
+    }
+    for (i = 0; i < ALLOCMAN_MAGAZINE_BATCH; i++) {
+        if (vka_cspace_alloc(vka, &mag->slots[mag->num_slots]) != 0) {
+            break;
+        }
+        mag->num_slots++;
+    }
+    return mag->num_slots == 0 ? -1 : 0;
+}
+
+static void _magazine_flush_slots(allocman_magazine_t *mag, size_t keep)
+{
+    while (mag->num_slots > keep) {
+        vka_cspace_free(&mag->shared->vka, mag->slots[--mag->num_slots]);
+    }
+}
+
+static void _magazine_flush_frees(allocman_magazine_t *mag)
+{
+    while (mag->num_frees > 0) {
+        mag->num_frees--;
+        vka_utspace_free(&mag->shared->vka, mag->frees[mag->num_frees].type, mag->frees[mag->num_frees].size_bits,
+                         mag->frees[mag->num_frees].cookie);
+    }
+}
+
+static int _magazine_refill_cache(allocman_magazine_t *mag, struct allocman_magazine_cache *cache)
+{
+    int error;
+
+    assert(cache->count == 0);
+    /* Returning queued frees first gives the allocman a chance to reuse them */
+    _magazine_flush_frees(mag);
+    error = vka_alloc_objects(&mag->shared->vka, cache->type, cache->size_bits, ALLOCMAN_MAGAZINE_BATCH,
+                              cache->objects);
+    if (!error) {
+        cache->count = ALLOCMAN_MAGAZINE_BATCH;
+    }
+    return error;
+}
+
+void allocman_magazine_drain(allocman_magazine_t *mag)
+{
+    size_t i;
+
+    assert(mag);
+    _shared_lock(mag->shared);
+    for (i = 0; i < ALLOCMAN_MAGAZINE_NUM_CACHES; i++) {
+        struct allocman_magazine_cache *cache = &mag->caches[i];
+        while (cache->count > 0) {
+            vka_free_object(&mag->shared->vka, &cache->objects[--cache->count]);
+        }
+    }
+    _magazine_flush_slots(mag, 0);
+    _magazine_flush_frees(mag);
+    _shared_unlock(mag->shared);
+}
+
+static int mag_vka_cspace_alloc(void *data, seL4_CPtr *res)
+{
+    allocman_magazine_t *mag = (allocman_magazine_t *)data;
+    int error;
+
+    assert(mag);
+    assert(res);
+
+    if (mag->num_slots == 0) {
+        _shared_lock(mag->shared);
+        error = _magazine_refill_slots(mag);
+        _shared_unlock(mag->shared);
+        if (error) {
+            return error;
+        }
+    }
+    *res = mag->slots[--mag->num_slots];
+    return 0;
+}
+
+static void mag_vka_cspace_make_path(void *data, seL4_CPtr slot, cspacepath_t *res)
+{
+    allocman_magazine_t *mag = (allocman_magazine_t *)data;
+
+    assert(mag);
+    assert(res);
+
+    _shared_lock(mag->shared);
+    vka_cspace_make_path(&mag->shared->vka, slot, res);
+    _shared_unlock(mag->shared);
+}
+
+static void mag_vka_cspace_free(void *data, seL4_CPtr slot)
+{
+    allocman_magazine_t *mag = (allocman_magazine_t *)data;
+
+    assert(mag);
+
+    if (mag->num_slots == ALLOCMAN_MAGAZINE_SIZE) {
+        _shared_lock(mag->shared);
+        _magazine_flush_slots(mag, ALLOCMAN_MAGAZINE_SIZE - ALLOCMAN_MAGAZINE_BATCH);
+        _shared_unlock(mag->shared);
+    }
+    mag->slots[mag->num_slots++] = slot;
+}
+
+static struct allocman_magazine_cache *_magazine_find_cache(allocman_magazine_t *mag, seL4_Word type,
+                                                            seL4_Word size_bits)
+{
+    size_t i;
+    for (i = 0; i < ALLOCMAN_MAGAZINE_NUM_CACHES; i++) {
+        if (mag->caches[i].type == type && mag->caches[i].size_bits == size_bits) {
+            return &mag->caches[i];
+        }
+    }
+    return NULL;
+}
+
+static int _magazine_alloc_cached(allocman_magazine_t *mag, struct allocman_magazine_cache *cache,
+                                  const cspacepath_t *dest, seL4_Word *res)
+{
+    vka_object_t object;
+    cspacepath_t src;
+    int error;
+
+    if (cache->count == 0) {
+        _shared_lock(mag->shared);
+        error = _magazine_refill_cache(mag, cache);
+        _shared_unlock(mag->shared);
+        if (error) {
+            return error;
+        }
+    }
+
+    /* Objects are cached in slots of their own, so move the cap to where the caller
+     * wants it and keep the old slot for later cslot allocations */
+    object = cache->objects[--cache->count];
+    mag_vka_cspace_make_path(mag, object.cptr, &src);
+    error = vka_cnode_move(dest, &src);
+    if (error != seL4_NoError) {
+        ZF_LOGE("Failed to move cached object");
+        cache->objects[cache->count++] = object;
+        return error;
+    }
+    mag_vka_cspace_free(mag, object.cptr);
+    *res = object.ut;
+    return 0;
+}
+
+static int mag_vka_utspace_alloc_maybe_device(void *data, const cspacepath_t *dest, seL4_Word type,
+                                              seL4_Word size_bits, bool can_use_dev, seL4_Word *res)
+{
+    allocman_magazine_t *mag = (allocman_magazine_t *)data;
+    struct allocman_magazine_cache *cache;
+    int error;
+
+    assert(mag);
+    assert(dest);
+    assert(res);
+
+    cache = can_use_dev ? NULL : _magazine_find_cache(mag, type, size_bits);
+    if (cache) {
+        return _magazine_alloc_cached(mag, cache, dest, res);
+    }
+
+    _shared_lock(mag->shared);
+    error = vka_utspace_alloc_maybe_device(&mag->shared->vka, dest, type, size_bits, can_use_dev, res);
+    _shared_unlock(mag->shared);
+    return error;
+}
+
+static int mag_vka_utspace_alloc(void *data, const cspacepath_t *dest, seL4_Word type, seL4_Word size_bits,
+                                 seL4_Word *res)
+{
+    return mag_vka_utspace_alloc_maybe_device(data, dest, type, size_bits, false, res);
+}
+
+static int mag_vka_utspace_alloc_at(void *data, const cspacepath_t *dest, seL4_Word type, seL4_Word size_bits,
+                                    uintptr_t paddr, seL4_Word *res)
+{
+    allocman_magazine_t *mag = (allocman_magazine_t *)data;
+    int error;
+
+    assert(mag);
+
+    _shared_lock(mag->shared);
+    error = vka_utspace_alloc_at(&mag->shared->vka, dest, type, size_bits, paddr, res);
+    _shared_unlock(mag->shared);
+    return error;
+}
+
+static void mag_vka_utspace_free(void *data, seL4_Word type, seL4_Word size_bits, seL4_Word target)
+{
+    allocman_magazine_t *mag = (allocman_magazine_t *)data;
+
+    assert(mag);
+
+    if (mag->num_frees == ALLOCMAN_MAGAZINE_SIZE) {
+        _shared_lock(mag->shared);
+        _magazine_flush_frees(mag);
+        _shared_unlock(mag->shared);
+    }
+    mag->frees[mag->num_frees].type = type;
+    mag->frees[mag->num_frees].size_bits = size_bits;
+    mag->frees[mag->num_frees].cookie = target;
+    mag->num_frees++;
+}
+
+static uintptr_t mag_vka_utspace_paddr(void *data, seL4_Word target, seL4_Word type, seL4_Word size_bits)
+{
+    allocman_magazine_t *mag = (allocman_magazine_t *)data;
+    uintptr_t paddr;
+
+    assert(mag);
+
+    _shared_lock(mag->shared);
+    paddr = vka_utspace_paddr(&mag->shared->vka, target, type, size_bits);
+    _shared_unlock(mag->shared);
+    return paddr;
+}
+
+static int mag_vka_cspace_alloc_range(void *data, size_t num, seL4_CPtr *res)
+{
+    allocman_magazine_t *mag = (allocman_magazine_t *)data;
+    int error;
+
+    assert(mag);
+
+    _shared_lock(mag->shared);
+    error = vka_cspace_alloc_range(&mag->shared->vka, num, res);
+    _shared_unlock(mag->shared);
+    return error;
+}
+
+static int mag_vka_utspace_alloc_range(void *data, const cspacepath_t *dest, seL4_Word type, seL4_Word size_bits,
+                                       size_t num, bool can_use_dev, seL4_Word *res)
+{
+    allocman_magazine_t *mag = (allocman_magazine_t *)data;
+    int error;
+
+    assert(mag);
+
+    _shared_lock(mag->shared);
+    error = vka_utspace_alloc_range(&mag->shared->vka, dest, type, size_bits, num, can_use_dev, res);
+    _shared_unlock(mag->shared);
+    return error;
+}
+
+void allocman_magazine_make_vka(vka_t *vka, allocman_magazine_t *mag)
+{
+    assert(vka);
+    assert(mag);
+
+    vka->data = mag;
+    vka->cspace_alloc = &mag_vka_cspace_alloc;
+    vka->cspace_make_path = &mag_vka_cspace_make_path;
+    vka->utspace_alloc = &mag_vka_utspace_alloc;
+    vka->utspace_alloc_maybe_device = &mag_vka_utspace_alloc_maybe_device;
+    vka->utspace_alloc_at = &mag_vka_utspace_alloc_at;
+    vka->cspace_free = &mag_vka_cspace_free;
+    vka->utspace_free = &mag_vka_utspace_free;
+    vka->utspace_paddr = &mag_vka_utspace_paddr;
+    /* Ranges are not cached, but passing them through lets callers still retype in batches */
+    vka->cspace_alloc_range = mag->shared->vka.cspace_alloc_range ? &mag_vka_cspace_alloc_range : NULL;
+    vka->utspace_alloc_range = mag->shared->vka.utspace_alloc_range ? &mag_vka_utspace_alloc_range : NULL;
+}
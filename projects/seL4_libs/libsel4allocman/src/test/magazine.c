@@ -0,0 +1,103 @@
+/*
+ * Copyright 2017, Data61, CSIRO (ABN 41 687 119 230)
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <sel4/sel4.h>
+#include <allocman/allocman.h>
+#include <allocman/magazine.h>
+#include <allocman/test.h>
+#include <vka/object.h>
+#include <vspace/page.h>
+
+#include <sel4test/test.h>
+#include <sel4test/testutil.h>
+
+/* More than a magazine holds, so that allocating them refills the caches and
+ * freeing them flushes the magazine back to the allocman */
+#define MAGAZINE_TEST_OBJECTS (ALLOCMAN_MAGAZINE_SIZE * 2 + 1)
+
+void get_allocman_magazine_tests(void)
+{
+}
+
+typedef struct test_lock {
+    bool held;
+    /* Set if the lock was taken while held, or released while not held */
+    bool misused;
+} test_lock_t;
+
+static void test_lock_acquire(void *cookie)
+{
+    test_lock_t *lock = cookie;
+    lock->misused |= lock->held;
+    lock->held = true;
+}
+
+static void test_lock_release(void *cookie)
+{
+    test_lock_t *lock = cookie;
+    lock->misused |= !lock->held;
+    lock->held = false;
+}
+
+static int test_magazine_alloc_free_drain(env_t env)
+{
+    /* The test environment's vka allocates from an allocman */
+    allocman_t *alloc = env->vka.data;
+    test_lock_t lock = { 0 };
+    allocman_lock_ops_t lock_ops = { .lock = test_lock_acquire, .unlock = test_lock_release, .cookie = &lock };
+    allocman_shared_t shared;
+    allocman_magazine_t mag;
+    vka_t vka;
+    vka_object_t ntfns[MAGAZINE_TEST_OBJECTS];
+    vka_object_t frames[MAGAZINE_TEST_OBJECTS];
+
+    allocman_shared_init(&shared, alloc, lock_ops);
+    allocman_magazine_init(&mag, &shared);
+    allocman_magazine_make_vka(&vka, &mag);
+
+    for (int i = 0; i < MAGAZINE_TEST_OBJECTS; i++) {
+        test_eq(vka_alloc_notification(&vka, &ntfns[i]), 0);
+        test_eq(vka_alloc_frame(&vka, seL4_PageBits, &frames[i]), 0);
+        test_assert(!lock.held);
+    }
+    /* Every cap must refer to a distinct, usable object */
+    for (int i = 0; i < MAGAZINE_TEST_OBJECTS; i++) {
+        for (int j = 0; j < i; j++) {
+            test_neq(ntfns[i].cptr, ntfns[j].cptr);
+            test_neq(frames[i].cptr, frames[j].cptr);
+        }
+        /* These fault if the caps are not a notification and a frame */
+        seL4_Word badge;
+        seL4_Signal(ntfns[i].cptr);
+        seL4_Poll(ntfns[i].cptr, &badge);
+        seL4_ARCH_Page_GetAddress_t addr = seL4_ARCH_Page_GetAddress(frames[i].cptr);
+        test_eq(addr.error, (int) seL4_NoError);
+    }
+    for (int i = 0; i < MAGAZINE_TEST_OBJECTS; i++) {
+        vka_free_object(&vka, &ntfns[i]);
+        vka_free_object(&vka, &frames[i]);
+        test_assert(!lock.held);
+    }
+
+    allocman_magazine_drain(&mag);
+    test_eq(mag.num_slots, (size_t) 0);
+    test_eq(mag.num_frees, (size_t) 0);
+    for (int i = 0; i < ALLOCMAN_MAGAZINE_NUM_CACHES; i++) {
+        test_eq(mag.caches[i].count, (size_t) 0);
+    }
+    test_assert(!lock.held);
+    test_assert(!lock.misused);
+
+    /* A drained magazine can be used again */
+    test_eq(vka_alloc_notification(&vka, &ntfns[0]), 0);
+    vka_free_object(&vka, &ntfns[0]);
+    allocman_magazine_drain(&mag);
+    test_assert(!lock.misused);
+
+    return sel4test_get_result();
+}
+DEFINE_TEST(ALLOCMAN_MAGAZINE_001, "Allocate, free and drain objects through an allocman magazine",
+            test_magazine_alloc_free_drain, true)
@@ -13,30 +13,142 @@
 #include <vka/capops.h>
 #include <string.h>
 
-static void _remove_node(struct utspace_split_node **head, struct utspace_split_node *node)
+/* The address index of each pool is a treap. Priorities are a hash of the
+ * address, so no extra state is needed and the tree shape does not depend on
+ * the order nodes are inserted and removed in */
+static inline uintptr_t _index_priority(struct utspace_split_node *node)
 {
+    uintptr_t h = node->paddr;
+    h ^= h >> 16;
+    h *= 0x45d9f3b;
+    h ^= h >> 16;
+    return h;
+}
+
+static struct utspace_split_node *_index_rotate_left(struct utspace_split_node *root)
+{
+    struct utspace_split_node *right = root->right;
+    root->right = right->left;
+    right->left = root;
+    return right;
+}
+
+static struct utspace_split_node *_index_rotate_right(struct utspace_split_node *root)
+{
+    struct utspace_split_node *left = root->left;
+    root->left = left->right;
+    left->right = root;
+    return left;
+}
+
+static struct utspace_split_node *_index_insert(struct utspace_split_node *root, struct utspace_split_node *node)
+{
+    if (!root) {
+        node->left = node->right = NULL;
+        return node;
+    }
+    assert(node->paddr != root->paddr);
+    if (node->paddr < root->paddr) {
+        root->left = _index_insert(root->left, node);
+        if (_index_priority(root->left) > _index_priority(root)) {
+            root = _index_rotate_right(root);
+        }
+    } else {
+        root->right = _index_insert(root->right, node);
+        if (_index_priority(root->right) > _index_priority(root)) {
+            root = _index_rotate_left(root);
+        }
+    }
+    return root;
+}
+
+static struct utspace_split_node *_index_join(struct utspace_split_node *left, struct utspace_split_node *right)
+{
+    if (!left) {
+        return right;
+    }
+    if (!right) {
+        return left;
+    }
+    if (_index_priority(left) > _index_priority(right)) {
+        left->right = _index_join(left->right, right);
+        return left;
+    }
+    right->left = _index_join(left, right->left);
+    return right;
+}
+
+static struct utspace_split_node *_index_remove(struct utspace_split_node *root, struct utspace_split_node *node)
+{
+    assert(root);
+    if (node->paddr < root->paddr) {
+        root->left = _index_remove(root->left, node);
+        return root;
+    }
+    if (node->paddr > root->paddr) {
+        root->right = _index_remove(root->right, node);
+        return root;
+    }
+    assert(root == node);
+    return _index_join(node->left, node->right);
+}
+
+/* Find the free node of the given size in a pool that contains the range
+ * [paddr, paddr + BIT(size_bits)), or NULL if there is none */
+static struct utspace_split_node *_find_node(struct utspace_split_pool *pool, size_t node_size_bits, uintptr_t paddr,
+                                             size_t size_bits)
+{
+    struct utspace_split_node *node = pool->index[node_size_bits];
+    struct utspace_split_node *best = NULL;
+    /* the only candidate is the node with the highest address not above paddr */
+    while (node) {
+        if (node->paddr <= paddr) {
+            best = node;
+            node = node->right;
+        } else {
+            node = node->left;
+        }
+    }
+    if (best && paddr + BIT(size_bits) <= best->paddr + BIT(node_size_bits)) {
+        return best;
+    }
+    return NULL;
+}
+
+static void _remove_node(struct utspace_split_node *node)
+{
+    struct utspace_split_pool *pool = node->pool;
+    assert(node->free);
     if (node->prev) {
         node->prev->next = node->next;
     } else {
-        assert(*head == node);
-        *head = node->next;
+        assert(pool->heads[node->size_bits] == node);
+        pool->heads[node->size_bits] = node->next;
     }
     if (node->next) {
         node->next->prev = node->prev;
     }
-    node->head = head;
+    if (node->paddr != ALLOCMAN_NO_PADDR) {
+        pool->index[node->size_bits] = _index_remove(pool->index[node->size_bits], node);
+    }
+    /* mark node as allocated */
+    node->free = false;
 }
 
-static void _insert_node(struct utspace_split_node **head, struct utspace_split_node *node)
+static void _insert_node(struct utspace_split_node *node)
 {
-    node->next = *head;
+    struct utspace_split_pool *pool = node->pool;
+    node->next = pool->heads[node->size_bits];
     node->prev = NULL;
-    if (*head) {
-        (*head)->prev = node;
+    if (pool->heads[node->size_bits]) {
+        pool->heads[node->size_bits]->prev = node;
+    }
+    pool->heads[node->size_bits] = node;
+    if (node->paddr != ALLOCMAN_NO_PADDR) {
+        pool->index[node->size_bits] = _index_insert(pool->index[node->size_bits], node);
     }
-    *head = node;
     /* mark node as not allocated */
-    node->head = NULL;
+    node->free = true;
 }
 
 static struct utspace_split_node *_new_node(allocman_t *alloc)
@@ -64,7 +176,8 @@ static void _delete_node(allocman_t *alloc, struct utspace_split_node *node)
     allocman_mspace_free(alloc, node, sizeof(*node));
 }
 
-static int _insert_new_node(allocman_t *alloc, struct utspace_split_node **head, cspacepath_t ut, uintptr_t paddr)
+static int _insert_new_node(allocman_t *alloc, struct utspace_split_pool *pool, size_t size_bits, cspacepath_t ut,
+                            uintptr_t paddr)
 {
     int error;
     struct utspace_split_node *node;
@@ -76,19 +189,15 @@ static int _insert_new_node(allocman_t *alloc, struct utspace_split_node **head,
     node->parent = NULL;
     node->ut = ut;
     node->paddr = paddr;
-    node->origin_head = head;
-    _insert_node(head, node);
+    node->pool = pool;
+    node->size_bits = size_bits;
+    _insert_node(node);
     return 0;
 }
 
 void utspace_split_create(utspace_split_t *split)
 {
-    size_t i;
-    for (i = 0; i < ARRAY_SIZE(split->heads); i++) {
-        split->heads[i] = NULL;
-        split->dev_heads[i] = NULL;
-        split->dev_mem_heads[i] = NULL;
-    }
+    memset(split, 0, sizeof(*split));
 }
 
 int _utspace_split_add_uts(allocman_t *alloc, void *_split, size_t num, const cspacepath_t *uts, size_t *size_bits,
@@ -97,22 +206,22 @@ int _utspace_split_add_uts(allocman_t *alloc, void *_split, size_t num, const cs
     utspace_split_t *split = (utspace_split_t *) _split;
     int error;
     size_t i;
-    struct utspace_split_node **list;
+    struct utspace_split_pool *pool;
     switch (utType) {
     case ALLOCMAN_UT_KERNEL:
-        list = split->heads;
+        pool = &split->kernel;
         break;
     case ALLOCMAN_UT_DEV:
-        list = split->dev_heads;
+        pool = &split->dev;
         break;
     case ALLOCMAN_UT_DEV_MEM:
-        list = split->dev_mem_heads;
+        pool = &split->dev_mem;
         break;
     default:
         return -1;
     }
     for (i = 0; i < num; i++) {
-        error = _insert_new_node(alloc, &list[size_bits[i]], uts[i], paddr ? paddr[i] : ALLOCMAN_NO_PADDR);
+        error = _insert_new_node(alloc, pool, size_bits[i], uts[i], paddr ? paddr[i] : ALLOCMAN_NO_PADDR);
         if (error) {
             return error;
         }
@@ -120,26 +229,20 @@ int _utspace_split_add_uts(allocman_t *alloc, void *_split, size_t num, const cs
     return 0;
 }
 
-static int _refill_pool(allocman_t *alloc, utspace_split_t *split, struct utspace_split_node **heads, size_t size_bits,
-                        uintptr_t paddr)
+static int _refill_pool(allocman_t *alloc, struct utspace_split_pool *pool, size_t size_bits, uintptr_t paddr)
 {
     struct utspace_split_node *node;
     struct utspace_split_node *left, *right;
     int sel4_error;
     if (paddr == ALLOCMAN_NO_PADDR) {
         /* see if pool is actually empty */
-        if (heads[size_bits]) {
+        if (pool->heads[size_bits]) {
             return 0;
         }
     } else {
         /* see if the pool has the paddr we want */
-        for (node = heads[size_bits]; node; node = node->next) {
-            if (node->paddr == ALLOCMAN_NO_PADDR) {
-                continue;
-            }
-            if (node->paddr <= paddr && paddr < node->paddr + BIT(size_bits)) {
-                return 0;
-            }
+        if (_find_node(pool, size_bits, paddr, size_bits)) {
+            return 0;
         }
     }
     /* ensure we are not the highest pool */
@@ -149,17 +252,16 @@ static int _refill_pool(allocman_t *alloc, utspace_split_t *split, struct utspac
         return 1;
     }
     /* get something from the highest pool */
-    if (_refill_pool(alloc, split, heads, size_bits + 1, paddr)) {
+    if (_refill_pool(alloc, pool, size_bits + 1, paddr)) {
         /* could not fill higher pool */
         ZF_LOGV("Failed to refill pool of size %zu", size_bits);
         return 1;
     }
     if (paddr == ALLOCMAN_NO_PADDR) {
         /* use the first node for lack of a better one */
-        node = heads[size_bits + 1];
+        node = pool->heads[size_bits + 1];
     } else {
-        for (node = heads[size_bits + 1]; node && (node->paddr == ALLOCMAN_NO_PADDR || !(node->paddr <= paddr
-                                                                                         && paddr < node->paddr + BIT(size_bits + 1))); node = node->next);
+        node = _find_node(pool, size_bits + 1, paddr, size_bits);
         /* _refill_pool should not have returned if this wasn't possible */
         assert(node);
     }
@@ -197,12 +299,12 @@ static int _refill_pool(allocman_t *alloc, utspace_split_t *split, struct utspac
         return 1;
     }
     /* all is done. remove the parent and insert the children */
-    _remove_node(&heads[size_bits + 1], node);
+    _remove_node(node);
     left->parent = right->parent = node;
     left->sibling = right;
-    left->origin_head = &heads[size_bits];
-    right->origin_head = &heads[size_bits];
     right->sibling = left;
+    left->pool = right->pool = pool;
+    left->size_bits = right->size_bits = size_bits;
     if (node->paddr != ALLOCMAN_NO_PADDR) {
         left->paddr = node->paddr;
         right->paddr = node->paddr + BIT(size_bits);
@@ -211,28 +313,42 @@ static int _refill_pool(allocman_t *alloc, utspace_split_t *split, struct utspac
     }
     /* insert in this order so that we end up pulling the untypeds off in order of contiugous
      * physical address. This makes various allocation problems slightly less likely to happen */
-    _insert_node(&heads[size_bits], right);
-    _insert_node(&heads[size_bits], left);
+    _insert_node(right);
+    _insert_node(left);
     return 0;
 }
 
-static struct utspace_split_node **find_head_for_paddr(struct utspace_split_node **head, uintptr_t paddr,
-                                                       size_t size_bits)
+/* Returns whether any free node in the pool, of any size, contains the given range */
+static bool _pool_has_paddr(struct utspace_split_pool *pool, uintptr_t paddr, size_t size_bits)
 {
-    int i;
-    for (i = 0; i < CONFIG_WORD_SIZE; i++) {
-        struct utspace_split_node *node;
-        for (node = head[i]; node; node = node->next) {
-            if (node->paddr == ALLOCMAN_NO_PADDR) {
-                /* skip nodes with no physical address */
-                continue;
-            }
-            if (node->paddr <= paddr && paddr + BIT(size_bits) <= node->paddr + BIT(i)) {
-                return head;
-            }
+    size_t i;
+    for (i = size_bits; i < CONFIG_WORD_SIZE; i++) {
+        if (_find_node(pool, i, paddr, size_bits)) {
+            return true;
         }
     }
-    return NULL;
+    return false;
+}
+
+/* Refill the pool of the given size, preferring device memory if allowed. Returns
+ * the pool that was refilled, or NULL if there is no memory */
+static struct utspace_split_pool *_refill_any_pool(allocman_t *alloc, utspace_split_t *split, size_t size_bits,
+                                                   bool canBeDev)
+{
+    /* if we can use device memory then preference allocating from there */
+    if (canBeDev) {
+        if (_refill_pool(alloc, &split->dev_mem, size_bits, ALLOCMAN_NO_PADDR)) {
+            /* out of memory? Try fall through */
+            ZF_LOGV("Failed to refill device memory pool to allocate object of size %zu", size_bits);
+            ZF_LOGV("Trying regular untyped pool");
+        } else {
+            return &split->dev_mem;
+        }
+    }
+    if (_refill_pool(alloc, &split->kernel, size_bits, ALLOCMAN_NO_PADDR)) {
+        return NULL;
+    }
+    return &split->kernel;
 }
 
 seL4_Word _utspace_split_alloc(allocman_t *alloc, void *_split, size_t size_bits, seL4_Word type,
@@ -248,59 +364,47 @@ seL4_Word _utspace_split_alloc(allocman_t *alloc, void *_split, size_t size_bits
         SET_ERROR(error, 1);
         return 0;
     }
-    struct utspace_split_node **head = NULL;
-    /* if we're allocating at a particular paddr then we will just trawl through every pool
-     * and see if we can find out which one has what we want */
+    struct utspace_split_pool *pool = NULL;
+    /* if we're allocating at a particular paddr then look up which pool, if any, has a
+     * free node covering it */
     if (paddr != ALLOCMAN_NO_PADDR) {
         if (canBeDev) {
-            head = find_head_for_paddr(split->dev_heads, paddr, size_bits);
-            if (!head) {
-                head = find_head_for_paddr(split->dev_mem_heads, paddr, size_bits);
+            if (_pool_has_paddr(&split->dev, paddr, size_bits)) {
+                pool = &split->dev;
+            } else if (_pool_has_paddr(&split->dev_mem, paddr, size_bits)) {
+                pool = &split->dev_mem;
             }
         }
-        if (!head) {
-            head = find_head_for_paddr(split->heads, paddr, size_bits);
+        if (!pool && _pool_has_paddr(&split->kernel, paddr, size_bits)) {
+            pool = &split->kernel;
         }
-        if (!head) {
+        if (!pool) {
             SET_ERROR(error, 1);
             ZF_LOGE("Failed to find any untyped capable of creating an object at address %p", (void *)paddr);
             return 0;
         }
-        if (_refill_pool(alloc, split, head, size_bits, paddr)) {
+        if (_refill_pool(alloc, pool, size_bits, paddr)) {
             /* out of memory? */
             SET_ERROR(error, 1);
             ZF_LOGV("Failed to refill pool to allocate object of size %zu", size_bits);
             return 0;
         }
-        /* search for the node we want to use. We have the advantage of knowing that
+        /* find the node we want to use. We have the advantage of knowing that
          * due to objects being size aligned that the base paddr of the untyped will
          * be exactly the paddr we want */
-        for (node = head[size_bits]; node && (node->paddr == ALLOCMAN_NO_PADDR || node->paddr != paddr); node = node->next);
+        node = _find_node(pool, size_bits, paddr, size_bits);
         /* _refill_pool should not have returned if this wasn't possible */
-        assert(node);
+        assert(node && node->paddr == paddr);
     } else {
-        /* if we can use device memory then preference allocating from there */
-        if (canBeDev) {
-            if (_refill_pool(alloc, split, split->dev_mem_heads, size_bits, ALLOCMAN_NO_PADDR)) {
-                /* out of memory? Try fall through */
-                ZF_LOGV("Failed to refill device memory pool to allocate object of size %zu", size_bits);
-                ZF_LOGV("Trying regular untyped pool");
-            } else {
-                head = split->dev_mem_heads;
-            }
-
-        }
-        if (!head) {
-            head = split->heads;
-            if (_refill_pool(alloc, split, head, size_bits, ALLOCMAN_NO_PADDR)) {
-                /* out of memory? */
-                SET_ERROR(error, 1);
-                ZF_LOGV("Failed to refill pool to allocate object of size %zu", size_bits);
-                return 0;
-            }
+        pool = _refill_any_pool(alloc, split, size_bits, canBeDev);
+        if (!pool) {
+            /* out of memory? */
+            SET_ERROR(error, 1);
+            ZF_LOGV("Failed to refill pool to allocate object of size %zu", size_bits);
+            return 0;
         }
         /* use the first node for lack of a better one */
-        node = head[size_bits];
+        node = pool->heads[size_bits];
     }
     /* Perform the untyped retype */
     sel4_error = seL4_Untyped_Retype(node->ut.capPtr, type, sel4_size_bits, slot->root, slot->dest, slot->destDepth,
@@ -312,21 +416,105 @@ seL4_Word _utspace_split_alloc(allocman_t *alloc, void *_split, size_t size_bits
         return 0;
     }
     /* remove the node */
-    _remove_node(&head[size_bits], node);
+    _remove_node(node);
     SET_ERROR(error, 0);
     /* return the node as a cookie */
     return (seL4_Word)node;
 }
 
+int _utspace_split_alloc_range(allocman_t *alloc, void *_split, size_t size_bits, seL4_Word type,
+                               const cspacepath_t *slot, size_t num, bool canBeDev, seL4_Word *cookies)
+{
+    utspace_split_t *split = (utspace_split_t *)_split;
+    struct utspace_split_range *range;
+    struct utspace_split_pool *pool;
+    struct utspace_split_node *node;
+    size_t sel4_size_bits;
+    size_t node_size_bits;
+    size_t range_bytes;
+    int sel4_error;
+    int error;
+    size_t i;
+    /* get size of untyped call */
+    sel4_size_bits = get_sel4_object_size(type, size_bits);
+    if (size_bits != vka_get_object_size(type, sel4_size_bits) || size_bits == 0) {
+        return 1;
+    }
+    if (num == 0 || num > seL4_UntypedRetypeMaxObjects) {
+        return 1;
+    }
+    /* the objects are created from a single node large enough to hold all of them */
+    node_size_bits = size_bits;
+    while (BIT(node_size_bits - size_bits) < num) {
+        node_size_bits++;
+    }
+    if (node_size_bits >= CONFIG_WORD_SIZE) {
+        return 1;
+    }
+    range_bytes = sizeof(*range) + num * sizeof(range->entries[0]);
+    range = (struct utspace_split_range *) allocman_mspace_alloc(alloc, range_bytes, &error);
+    if (error) {
+        ZF_LOGV("Failed to allocate range of size %zu", range_bytes);
+        return 1;
+    }
+    pool = _refill_any_pool(alloc, split, node_size_bits, canBeDev);
+    if (!pool) {
+        allocman_mspace_free(alloc, range, range_bytes);
+        ZF_LOGV("Failed to refill pool to allocate %zu objects of size %zu", num, size_bits);
+        return 1;
+    }
+    node = pool->heads[node_size_bits];
+    /* Perform the untyped retype */
+    sel4_error = seL4_Untyped_Retype(node->ut.capPtr, type, sel4_size_bits, slot->root, slot->dest, slot->destDepth,
+                                     slot->offset, num);
+    if (sel4_error != seL4_NoError) {
+        allocman_mspace_free(alloc, range, range_bytes);
+        /* Well this shouldn't happen */
+        ZF_LOGE("Failed to retype untyped, error %d\n", sel4_error);
+        return 1;
+    }
+    /* remove the node */
+    _remove_node(node);
+    range->node = node;
+    range->node_size_bits = node_size_bits;
+    range->size_bits = size_bits;
+    range->num = num;
+    range->live = num;
+    for (i = 0; i < num; i++) {
+        range->entries[i].range = range;
+        cookies[i] = (seL4_Word)&range->entries[i] | UTSPACE_SPLIT_RANGE_COOKIE;
+    }
+    return 0;
+}
+
+static void _range_free(allocman_t *alloc, utspace_split_t *split, struct utspace_split_range_entry *entry)
+{
+    struct utspace_split_range *range = entry->range;
+    struct utspace_split_node *node = range->node;
+    size_t node_size_bits = range->node_size_bits;
+    assert(range->live > 0);
+    range->live--;
+    if (range->live == 0) {
+        allocman_mspace_free(alloc, range, sizeof(*range) + range->num * sizeof(range->entries[0]));
+        _utspace_split_free(alloc, split, (seL4_Word) node, node_size_bits);
+    }
+}
+
 void _utspace_split_free(allocman_t *alloc, void *_split, seL4_Word cookie, size_t size_bits)
 {
     utspace_split_t *split = (utspace_split_t *)_split;
-    struct utspace_split_node *node = (struct utspace_split_node *)cookie;
-    struct utspace_split_node *parent = node->parent;
+    struct utspace_split_node *node;
+    struct utspace_split_node *parent;
+    if (cookie & UTSPACE_SPLIT_RANGE_COOKIE) {
+        _range_free(alloc, split, (struct utspace_split_range_entry *)(cookie & ~UTSPACE_SPLIT_RANGE_COOKIE));
+        return;
+    }
+    node = (struct utspace_split_node *)cookie;
+    parent = node->parent;
     /* see if our sibling is also free */
-    if (parent && !node->sibling->head) {
+    if (parent && node->sibling->free) {
         /* remove sibling from free list */
-        _remove_node(node->sibling->origin_head, node->sibling);
+        _remove_node(node->sibling);
         /* delete both of us */
         _delete_node(alloc, node->sibling);
         _delete_node(alloc, node);
@@ -334,12 +522,22 @@ void _utspace_split_free(allocman_t *alloc, void *_split, seL4_Word cookie, size
         _utspace_split_free(alloc, split, (seL4_Word) parent, size_bits + 1);
     } else {
         /* just put ourselves back in */
-        _insert_node(node->head, node);
+        _insert_node(node);
     }
 }
 
 uintptr_t _utspace_split_paddr(void *_split, seL4_Word cookie, size_t size_bits)
 {
-    struct utspace_split_node *node = (struct utspace_split_node *)cookie;
+    struct utspace_split_node *node;
+    if (cookie & UTSPACE_SPLIT_RANGE_COOKIE) {
+        struct utspace_split_range_entry *entry = (struct utspace_split_range_entry *)(cookie & ~UTSPACE_SPLIT_RANGE_COOKIE);
+        struct utspace_split_range *range = entry->range;
+        if (range->node->paddr == ALLOCMAN_NO_PADDR) {
+            return ALLOCMAN_NO_PADDR;
+        }
+        /* objects are laid out in order from the start of the node */
+        return range->node->paddr + (entry - range->entries) * BIT(range->size_bits);
+    }
+    node = (struct utspace_split_node *)cookie;
     return node->paddr;
 }
@@ -173,6 +173,56 @@ static uintptr_t am_vka_utspace_paddr (void *data, seL4_Word target, seL4_Word t
     return allocman_utspace_paddr((allocman_t *)data, target, size_bits);
 }
 
+/**
+ * Allocate a range of contiguous slots in a single cnode
+ *
+ * @param data cookie for the underlying allocator
+ * @param num the number of slots to allocate
+ * @param res pointer to a cptr to store the first allocated slot
+ * @return 0 on success
+ */
+static int am_vka_cspace_alloc_range(void *data, size_t num, seL4_CPtr *res)
+{
+    int error;
+    cspacepath_t path;
+
+    assert(data);
+    assert(res);
+
+    error = allocman_cspace_alloc_range((allocman_t *) data, num, &path);
+    if (!error) {
+        *res = path.capPtr;
+    }
+
+    return error;
+}
+
+/**
+ * Allocate a portion of an untyped into num objects with a single retype
+ *
+ * @param data cookie for the underlying allocator
+ * @param dest path to the first of num contiguous empty cslots
+ * @param type the seL4 object type to allocate (as passed to Untyped_Retype)
+ * @param size_bits the size of each object to allocate (as passed to Untyped_Retype)
+ * @param num the number of objects to allocate
+ * @param can_use_dev whether the allocator can use device untyped instead of regular untyped
+ * @param res array of num locations to store the cookie representing each allocation
+ * @return 0 on success
+ */
+static int am_vka_utspace_alloc_range(void *data, const cspacepath_t *dest, seL4_Word type, seL4_Word size_bits,
+                                      size_t num, bool can_use_dev, seL4_Word *res)
+{
+    assert(data);
+    assert(res);
+    assert(dest);
+
+    /* allocman uses the size in memory internally, where as vka expects size_bits
+     * as passed to Untyped_Retype, so do a conversion here */
+    size_bits = vka_get_object_size(type, size_bits);
+
+    return allocman_utspace_alloc_range((allocman_t *) data, size_bits, type, dest, num, can_use_dev, res);
+}
+
 /**
  * Make a VKA object using this allocman
  *
@@ -193,6 +243,8 @@ void allocman_make_vka(vka_t *vka, allocman_t *alloc)
     vka->cspace_free = &am_vka_cspace_free;
     vka->utspace_free = &am_vka_utspace_free;
     vka->utspace_paddr = &am_vka_utspace_paddr;
+    vka->cspace_alloc_range = &am_vka_cspace_alloc_range;
+    vka->utspace_alloc_range = &am_vka_utspace_alloc_range;
 }
 
 int allocman_make_from_vka(vka_t *vka, allocman_t *alloc)
@@ -11,6 +11,8 @@
 #include <sel4/arch/constants.h>
 #include <sel4/simple_types.h>
 #include <sel4/benchmark_tracepoints_types.h>
+#include <sel4/benchmark_track_types.h>
+#include <sel4/benchmark_sampling_types.h>
 #include <sel4/arch/syscalls.h>
 #include <inttypes.h>
 
@@ -27,6 +29,45 @@ typedef void *kernel_log_entry_t;
  */
 unsigned int kernel_logging_sync_log(kernel_log_entry_t log[], unsigned int n);
 
+#ifdef CONFIG_BENCHMARK_TRACK_KERNEL_ENTRIES_RING
+/* Copies up to n of the oldest unread entries from the trace ring of the
+ * given core to the specified array, and hands their slots back to the kernel.
+ * Returns the number of entries copied. Can be called while the kernel keeps
+ * recording, so a log can be drained continuously.
+ *
+ * @log_buffer is a user-level mapping of the frame passed to
+ * kernel_logging_set_log_buffer. The rings are set up by kernel_logging_reset_log.
+ */
+unsigned int kernel_logging_ring_read(void *log_buffer, seL4_Word core,
+                                      benchmark_track_kernel_entry_t log[], unsigned int n);
+
+/* Returns the number of entries the given core has dropped because its ring
+ * was full when they were recorded. */
+seL4_Word kernel_logging_ring_dropped(void *log_buffer, seL4_Word core);
+#endif /* CONFIG_BENCHMARK_TRACK_KERNEL_ENTRIES_RING */
+
+#ifdef CONFIG_BENCHMARK_SAMPLING_PROFILER
+/* Copies up to n of the oldest unread samples from the sample ring of the
+ * given core to the specified array, and hands their slots back to the kernel.
+ * Returns the number of samples copied.
+ *
+ * @log_buffer is a user-level mapping of the frame passed to
+ * kernel_logging_set_log_buffer. Sampling starts at kernel_logging_reset_log.
+ */
+unsigned int kernel_logging_sample_read(void *log_buffer, seL4_Word core,
+                                        benchmark_sample_t samples[], unsigned int n);
+
+/* Returns the number of samples the given core has dropped because its ring
+ * was full when they were taken. */
+seL4_Word kernel_logging_sample_dropped(void *log_buffer, seL4_Word core);
+
+/* Prints a sample as a single line of the form
+ *   sample <core> <tcb> <name> <pc> <return address>...
+ * with addresses in hex and "-" for the name if it isn't known. This is the
+ * format read by the fold-samples.py tool in seL4/tools/misc. */
+void kernel_logging_sample_print(seL4_Word core, benchmark_sample_t *sample);
+#endif /* CONFIG_BENCHMARK_SAMPLING_PROFILER */
+
 /* Returns the key field of a log entry. */
 static inline seL4_Word kernel_logging_entry_get_key(kernel_log_entry_t *entry)
 {
@@ -4,6 +4,7 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
+#include <stdio.h>
 #include <sel4bench/kernel_logging.h>
 
 #if CONFIG_MAX_NUM_TRACE_POINTS > 0
@@ -13,3 +14,88 @@ kernel_logging_sync_log(kernel_log_entry_t log[], unsigned int n)
     return 0;
 }
 #endif
+
+#ifdef CONFIG_BENCHMARK_TRACK_KERNEL_ENTRIES_RING
+static inline benchmark_track_ring_t *get_ring(void *log_buffer, seL4_Word core)
+{
+    return (benchmark_track_ring_t *)((uintptr_t) log_buffer + core * seL4_LogRingSize);
+}
+
+unsigned int kernel_logging_ring_read(void *log_buffer, seL4_Word core,
+                                      benchmark_track_kernel_entry_t log[], unsigned int n)
+{
+    benchmark_track_ring_t *ring = get_ring(log_buffer, core);
+    seL4_Word mask = ring->mask;
+    seL4_Word tail = ring->tail;
+    seL4_Word head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+    unsigned int count = 0;
+    while (tail != head && count < n) {
+        log[count++] = ring->entries[tail & mask];
+        tail++;
+    }
+
+    /* Only release the slots once the entries have been copied out */
+    __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+    return count;
+}
+
+seL4_Word kernel_logging_ring_dropped(void *log_buffer, seL4_Word core)
+{
+    return __atomic_load_n(&get_ring(log_buffer, core)->dropped, __ATOMIC_RELAXED);
+}
+#endif /* CONFIG_BENCHMARK_TRACK_KERNEL_ENTRIES_RING */
+
+#ifdef CONFIG_BENCHMARK_SAMPLING_PROFILER
+static inline benchmark_sample_ring_t *get_sample_ring(void *log_buffer, seL4_Word core)
+{
+    return (benchmark_sample_ring_t *)((uintptr_t) log_buffer + core * seL4_SampleRingSize);
+}
+
+unsigned int kernel_logging_sample_read(void *log_buffer, seL4_Word core,
+                                        benchmark_sample_t samples[], unsigned int n)
+{
+    benchmark_sample_ring_t *ring = get_sample_ring(log_buffer, core);
+    seL4_Word mask = ring->mask;
+    seL4_Word tail = ring->tail;
+    seL4_Word head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+    unsigned int count = 0;
+    while (tail != head && count < n) {
+        samples[count++] = ring->samples[tail & mask];
+        tail++;
+    }
+
+    __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+    return count;
+}
+
+seL4_Word kernel_logging_sample_dropped(void *log_buffer, seL4_Word core)
+{
+    return __atomic_load_n(&get_sample_ring(log_buffer, core)->dropped, __ATOMIC_RELAXED);
+}
+
+void kernel_logging_sample_print(seL4_Word core, benchmark_sample_t *sample)
+{
+    printf("sample %"PRIuPTR" %"PRIxPTR" ", (uintptr_t) core, (uintptr_t) sample->tcb);
+#ifdef CONFIG_DEBUG_BUILD
+    /* Names can't contain whitespace or the line won't parse */
+    int printed = 0;
+    for (int i = 0; i < seL4_SampleNameLength && sample->name[i] != '\0'; i++) {
+        char c = sample->name[i];
+        putchar(c == ' ' || c == '\t' ? '_' : c);
+        printed++;
+    }
+    if (printed == 0) {
+        putchar('-');
+    }
+#else
+    putchar('-');
+#endif
+    printf(" %"PRIxPTR, (uintptr_t) sample->pc);
+    for (seL4_Word i = 0; i < sample->depth && i < CONFIG_BENCHMARK_SAMPLE_STACK_DEPTH; i++) {
+        printf(" %"PRIxPTR, (uintptr_t) sample->frames[i]);
+    }
+    printf("\n");
+}
+#endif /* CONFIG_BENCHMARK_SAMPLING_PROFILER */
@@ -53,3 +53,5 @@ typedef void *(*muslcsys_cpio_get_file_fn_t)(void *cpio_symbol, unsigned long le
                                              const char *name, unsigned long *size);
 void muslcsys_install_cpio_interface(void *cpio_symbol, unsigned long cpio_len,
                                      muslcsys_cpio_get_file_fn_t fn);
+/* cpio_get_file backed by an index of the archive, which is built on the first lookup */
+void *muslcsys_cpio_index_get_file(void *cpio_symbol, unsigned long len, const char *name, unsigned long *size);
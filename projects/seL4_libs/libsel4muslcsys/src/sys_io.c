@@ -27,6 +27,7 @@
 #include <bits/syscall.h>
 
 #include <sel4utils/util.h>
+#include <cpio/cpio.h>
 
 #include <muslcsys/io.h>
 #include "arch_stdio.h"
@@ -539,3 +540,27 @@ void muslcsys_install_cpio_interface(void *cpio_symbol, unsigned long cpio_len,
     cpio_archive_len = cpio_len;
     cpio_get_file_impl = fn;
 }
+
+/* Index of the archive, built on first use as the interface is installed before malloc is ready */
+static struct cpio_index cpio_archive_index;
+static void *cpio_archive_indexed;
+
+void *muslcsys_cpio_index_get_file(void *cpio_symbol, unsigned long len, const char *name, unsigned long *size)
+{
+    if (cpio_archive_indexed == NULL) {
+        struct cpio_info info;
+        if (cpio_info(cpio_symbol, len, &info) == 0) {
+            unsigned long buf_len = CPIO_INDEX_BUF_SIZE(info.file_count);
+            void *buf = malloc(buf_len);
+            if (buf != NULL && cpio_index_init(&cpio_archive_index, cpio_symbol, len, buf, buf_len) == 0) {
+                cpio_archive_indexed = cpio_symbol;
+            } else {
+                free(buf);
+            }
+        }
+    }
+    if (cpio_archive_indexed == cpio_symbol) {
+        return cpio_index_get_file(&cpio_archive_index, name, size);
+    }
+    return cpio_get_file(cpio_symbol, len, name, size);
+}
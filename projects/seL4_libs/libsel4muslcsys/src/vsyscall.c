@@ -239,7 +239,7 @@ extern char _cpio_archive_end[];
 static void CONSTRUCTOR(CONSTRUCTOR_MIN_PRIORITY) install_default_cpio(void)
 {
     unsigned long cpio_len = _cpio_archive_end - _cpio_archive;
-    muslcsys_install_cpio_interface(_cpio_archive, cpio_len, cpio_get_file);
+    muslcsys_install_cpio_interface(_cpio_archive, cpio_len, muslcsys_cpio_index_get_file);
 }
 #endif
 
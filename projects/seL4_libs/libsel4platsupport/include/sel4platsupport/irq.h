@@ -179,6 +179,22 @@ int sel4platsupport_irq_unset_ntfn(ps_irq_ops_t *irq_ops, irq_id_t irq_id);
  */
 int sel4platsupport_irq_handle(ps_irq_ops_t *irq_ops, ntfn_id_t ntfn_id, seL4_Word handle_mask);
 
+/*
+ * This function follows the same functionality as `sel4platsupport_irq_handle`
+ * except that the acknowledgements made by the callbacks are collected and
+ * only made once all of the callbacks have returned, using as few
+ * seL4_IRQHandler_AckBatch invocations as possible. This takes one kernel entry
+ * for a burst of interrupts instead of one per interrupt. Callbacks that
+ * acknowledge their interrupt after returning are acknowledged individually.
+ *
+ * @param irq_ops Initialised IRQ interface
+ * @param ntfn_id ID of a notification that was provided to the interface
+ * @param handle_mask Badge mask of bits to check and perform callbacks for
+ *
+ * @return 0 on success, otherwise an error code
+ */
+int sel4platsupport_irq_handle_batched(ps_irq_ops_t *irq_ops, ntfn_id_t ntfn_id, seL4_Word handle_mask);
+
 /*
  * Waits on a registered notification.
  *
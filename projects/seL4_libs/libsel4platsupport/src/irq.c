@@ -59,6 +59,12 @@ typedef struct {
     seL4_Word pending_bitfield;
 
     irq_id_t bound_irqs[MAX_INTERRUPTS_TO_NOTIFICATIONS];
+
+    /* Set while callbacks run in sel4platsupport_irq_handle_batched, acks are
+     * collected here instead of being made straight away */
+    bool batching_acks;
+    size_t num_batched_acks;
+    seL4_CPtr batched_acks[MAX_INTERRUPTS_TO_NOTIFICATIONS];
 } ntfn_entry_t;
 
 typedef struct {
@@ -531,6 +537,14 @@ static int sel4platsupport_irq_acknowledge(void *ack_data)
     }
 
     irq_entry_t *irq_entry = &(irq_cookie->irq_table[irq_id]);
+    if (irq_entry->paired_ntfn > UNPAIRED_ID) {
+        ntfn_entry_t *ntfn_entry = &(irq_cookie->ntfn_table[irq_entry->paired_ntfn]);
+        if (ntfn_entry->batching_acks && ntfn_entry->num_batched_acks < MAX_INTERRUPTS_TO_NOTIFICATIONS) {
+            ntfn_entry->batched_acks[ntfn_entry->num_batched_acks++] = irq_entry->handler_path.capPtr;
+            goto exit;
+        }
+    }
+
     int error = seL4_IRQHandler_Ack(irq_entry->handler_path.capPtr);
     if (error) {
         ZF_LOGE("Failed to acknowledge IRQ");
@@ -812,7 +826,50 @@ static bool perform_callback(irq_cookie_t *irq_cookie, irq_id_t irq_id, unsigned
     return false;
 }
 
-int sel4platsupport_irq_handle(ps_irq_ops_t *irq_ops, ntfn_id_t ntfn_id, seL4_Word handle_mask)
+/* Acknowledges the IRQs whose acks were collected while batching. Each
+ * invocation acks the handler with the lowest remaining CPtr, and with it every
+ * other remaining handler that is less than a word's worth of CPtrs above it. */
+static int flush_batched_acks(ntfn_entry_t *ntfn_entry)
+{
+    int ret = 0;
+    seL4_CPtr *handlers = ntfn_entry->batched_acks;
+    size_t remaining = ntfn_entry->num_batched_acks;
+
+    while (remaining > 0) {
+        seL4_CPtr service = handlers[0];
+        for (size_t i = 1; i < remaining; i++) {
+            service = MIN(service, handlers[i]);
+        }
+
+        /* Take the handlers this invocation covers out of the array */
+        seL4_CPtr base = service + 1;
+        seL4_Word mask = 0;
+        size_t kept = 0;
+        for (size_t i = 0; i < remaining; i++) {
+            if (handlers[i] == service) {
+                continue;
+            }
+            if (handlers[i] - base < seL4_WordBits) {
+                mask |= BIT(handlers[i] - base);
+            } else {
+                handlers[kept++] = handlers[i];
+            }
+        }
+        remaining = kept;
+
+        int error = seL4_IRQHandler_AckBatch(service, base, mask);
+        if (error) {
+            ZF_LOGE("Failed to acknowledge a batch of IRQs");
+            ret = -EFAULT;
+        }
+    }
+
+    ntfn_entry->num_batched_acks = 0;
+    return ret;
+}
+
+static int irq_handle_common(ps_irq_ops_t *irq_ops, ntfn_id_t ntfn_id, seL4_Word handle_mask,
+                             bool batch_acks)
 {
     if (!irq_ops) {
         return -EINVAL;
@@ -831,6 +888,7 @@ int sel4platsupport_irq_handle(ps_irq_ops_t *irq_ops, ntfn_id_t ntfn_id, seL4_Wo
      * we dont' handle */
     unsigned long unchecked_bits = handle_mask & ntfn_entry->usable_mask;
 
+    ntfn_entry->batching_acks = batch_acks;
     while (unchecked_bits) {
         unsigned long bit_index = CTZL(unchecked_bits);
         irq_id_t paired_irq_id = ntfn_entry->bound_irqs[bit_index];
@@ -842,9 +900,24 @@ int sel4platsupport_irq_handle(ps_irq_ops_t *irq_ops, ntfn_id_t ntfn_id, seL4_Wo
         unchecked_bits &= ~BIT(bit_index);
     }
 
+    if (batch_acks) {
+        ntfn_entry->batching_acks = false;
+        return flush_batched_acks(ntfn_entry);
+    }
+
     return 0;
 }
 
+int sel4platsupport_irq_handle(ps_irq_ops_t *irq_ops, ntfn_id_t ntfn_id, seL4_Word handle_mask)
+{
+    return irq_handle_common(irq_ops, ntfn_id, handle_mask, false);
+}
+
+int sel4platsupport_irq_handle_batched(ps_irq_ops_t *irq_ops, ntfn_id_t ntfn_id, seL4_Word handle_mask)
+{
+    return irq_handle_common(irq_ops, ntfn_id, handle_mask, true);
+}
+
 static void serve_irq(irq_cookie_t *irq_cookie, ntfn_id_t id, seL4_Word mask,
                       seL4_Word badge, seL4_Word *ret_leftover_bits)
 {
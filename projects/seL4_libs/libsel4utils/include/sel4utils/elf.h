@@ -40,6 +40,28 @@ typedef struct sel4utils_elf_region {
     int segment_index;
 } sel4utils_elf_region_t;
 
+/* Breakdown of the work done loading an elf file. The cycle counts are only
+ * recorded when LibSel4UtilsElfLoadStats is enabled, otherwise they are left as 0 */
+typedef struct sel4utils_elf_load_stats {
+    /* Frames allocated for the loadee, by size */
+    size_t small_frames;
+    size_t large_frames;
+    /* Number of times frames were mapped into the loader to copy data into them */
+    size_t loader_maps;
+    /* Bytes copied out of the elf file */
+    size_t bytes_copied;
+    /* Cycles spent creating reservations in the loadee vspace */
+    uint64_t reserve_cycles;
+    /* Cycles spent allocating frames and mapping them into the loadee vspace */
+    uint64_t alloc_cycles;
+    /* Cycles spent copying frame caps and mapping them into the loader vspace */
+    uint64_t map_cycles;
+    /* Cycles spent copying data and maintaining caches */
+    uint64_t copy_cycles;
+    /* Cycles spent unmapping frames from the loader vspace */
+    uint64_t unmap_cycles;
+} sel4utils_elf_load_stats_t;
+
 /**
  * Load an elf file into a vspace.
  *
@@ -82,6 +104,22 @@ void *
 sel4utils_elf_load(vspace_t *loadee, vspace_t *loader, vka_t *loadee_vka,
                    vka_t *loader_vka, elf_t *elf);
 
+/**
+ * As sel4utils_elf_load, but also records a breakdown of the load.
+ *
+ * @param loadee the vspace to load the elf file into
+ * @param loader the vspace we are loading from
+ * @param loadee_vka allocator to use for allocation in the loadee vspace
+ * @param loader_vka allocator to use for loader vspace. Can be the same as loadee_vka.
+ * @param elf the elf file to load
+ * @param stats structure to fill in with statistics about the load
+ *
+ * @return The entry point of the new process, NULL on error
+ */
+void *
+sel4utils_elf_load_with_stats(vspace_t *loadee, vspace_t *loader, vka_t *loadee_vka,
+                              vka_t *loader_vka, elf_t *elf, sel4utils_elf_load_stats_t *stats);
+
 /**
  * Parses an elf file but does not actually load it. Merely reserves the regions in the vspace
  * for where the elf segments would go. This is used for lazy loading / copy on write
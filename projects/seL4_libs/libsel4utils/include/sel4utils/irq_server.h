@@ -40,6 +40,8 @@
 #include <autoconf.h>
 #include <sel4utils/gen_config.h>
 
+#include <stdbool.h>
+
 #include <sel4/sel4.h>
 #include <vspace/vspace.h>
 #include <vka/vka.h>
@@ -112,6 +114,19 @@ thread_id_t irq_server_thread_new(irq_server_t *irq_server, seL4_CPtr provided_n
 irq_id_t irq_server_register_irq(irq_server_t *irq_server, ps_irq_t irq,
                                  irq_callback_fn_t callback, void *callback_data);
 
+/**
+ * Switches the IRQ server in or out of batched acknowledgement mode. In this
+ * mode the server threads run the callbacks for every IRQ signalled in the
+ * badge they woke with, and then acknowledge all of the IRQs that the
+ * callbacks acknowledged with as few kernel invocations as possible. This
+ * reduces the kernel entries needed for a burst of interrupts. Callbacks
+ * should acknowledge their IRQ before returning, later acknowledgements are
+ * made individually.
+ * @param[in] irq_server   The IRQ server to configure
+ * @param[in] enable       Whether acknowledgements should be batched
+ */
+void irq_server_set_batch_ack(irq_server_t *irq_server, bool enable);
+
 /**
  * Redirects control to the IRQ subsystem to process an arriving IRQ.  The
  * server will read the appropriate message registers to retrieve the
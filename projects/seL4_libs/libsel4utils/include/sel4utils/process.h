@@ -51,6 +51,8 @@ typedef struct {
      * you want to implement */
     int num_elf_regions;
     sel4utils_elf_region_t *elf_regions;
+    /* breakdown of the work done loading the elf, if it was loaded */
+    sel4utils_elf_load_stats_t elf_load_stats;
     bool own_vspace;
     bool own_cspace;
     bool own_ep;
@@ -0,0 +1,10 @@
+/*
+ * Copyright 2017, Data61, CSIRO (ABN 41 687 119 230)
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+#pragma once
+
+/* Referenced by test applications so that the sel4utils tests are linked in */
+void get_sel4utils_vspace_tests(void);
+void get_sel4utils_tqueue_bench(void);
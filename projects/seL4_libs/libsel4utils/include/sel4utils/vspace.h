@@ -60,7 +60,9 @@ struct sel4utils_res {
     int cacheable;
     int malloced;
     bool rights_deferred;
-    struct sel4utils_res *next;
+    /* children in the tree of reservations, ordered by start address */
+    struct sel4utils_res *left;
+    struct sel4utils_res *right;
 };
 
 typedef struct sel4utils_res sel4utils_res_t;
@@ -73,8 +75,12 @@ typedef struct sel4utils_alloc_data {
     uintptr_t last_allocated;
     vspace_t *bootstrap;
     sel4utils_map_page_fn map_page;
-    sel4utils_res_t *reservation_head;
+    sel4utils_res_t *reservation_root;
     bool is_empty;
+    /* back requests for 4K pages with larger frames where possible */
+    bool promote_pages;
+    /* number of frames mapped of each size in sel4_page_sizes */
+    size_t num_mappings[SEL4_NUM_PAGE_SIZES];
 } sel4utils_alloc_data_t;
 
 static inline sel4utils_res_t *reservation_to_res(reservation_t res)
@@ -347,3 +353,29 @@ void sel4utils_get_image_region(uintptr_t *va_start, uintptr_t *va_end);
  */
 uintptr_t sel4utils_get_paddr(vspace_t *vspace, void *vaddr, seL4_Word type, seL4_Word size_bits);
 
+/**
+ * Set whether new pages are promoted to large pages. When enabled, requests for new 4K
+ * pages are backed by the largest naturally aligned frames that fit in the request,
+ * falling back to smaller frames when no untyped of the larger size is available or
+ * when earlier mappings left paging structures where the larger frame would go. A
+ * fallback only lasts for the rest of the request, or for a blocked frame only until
+ * the end of that frame, so later pages and requests try the larger frames again.
+ * Frames are at most 2M on AArch64. On x86_64 1G frames are used as well when the
+ * kernel is built with CONFIG_HUGE_PAGE.
+ * Ranges of promoted pages must be unmapped whole, as large frames cannot be partially unmapped.
+ *
+ * The default is set by LibSel4UtilsPagePromotion.
+ *
+ * @param vspace the vspace to configure.
+ * @param promote true to promote pages.
+ */
+void sel4utils_set_page_promotion(vspace_t *vspace, bool promote);
+
+/**
+ * @param vspace the vspace to query.
+ * @param size_bits size of the frames to count.
+ *
+ * @return the number of frames of the given size that have been mapped into the vspace.
+ */
+size_t sel4utils_get_num_mappings(vspace_t *vspace, size_t size_bits);
+
@@ -6,6 +6,7 @@
 #include <autoconf.h>
 #include <sel4utils/gen_config.h>
 
+#include <inttypes.h>
 #include <string.h>
 #include <sel4/sel4.h>
 #include <elf/elf.h>
@@ -15,6 +16,16 @@
 #include <sel4utils/mapping.h>
 #include <sel4utils/elf.h>
 
+#ifdef CONFIG_SEL4UTILS_ELF_LOAD_STATS
+#include <sel4bench/sel4bench.h>
+
+#define STATS_START(name) ccnt_t name##_start = sel4bench_get_cycle_count()
+#define STATS_END(stats, field, name) ((stats)->field += sel4bench_get_cycle_count() - name##_start)
+#else
+#define STATS_START(name) do { } while (0)
+#define STATS_END(stats, field, name) do { } while (0)
+#endif
+
 /*
  * Convert ELF permissions into seL4 permissions.
  *
@@ -32,7 +43,8 @@ static inline seL4_CapRights_t rights_from_elf(unsigned long permissions)
 static int load_segment(vspace_t *loadee_vspace, vspace_t *loader_vspace,
                         vka_t *loadee_vka, vka_t *loader_vka,
                         char *src, size_t file_size, int num_regions,
-                        sel4utils_elf_region_t regions[num_regions], int region_index)
+                        sel4utils_elf_region_t regions[num_regions], int region_index,
+                        sel4utils_elf_load_stats_t *stats)
 {
     int error = seL4_NoError;
     sel4utils_elf_region_t region = regions[region_index];
@@ -85,7 +97,12 @@ static int load_segment(vspace_t *loadee_vspace, vspace_t *loader_vspace,
          * Currently this check is done on every frame because it is assumed to be cheap. */
         seL4_CPtr cap = vspace_get_cap(loadee_vspace, loadee_vaddr);
         if (cap == seL4_CapNull) {
+            STATS_START(alloc);
             error = vspace_new_pages_at_vaddr(loadee_vspace, loadee_vaddr, 1, seL4_PageBits, reservation);
+            STATS_END(stats, alloc_cycles, alloc);
+            if (error == seL4_NoError) {
+                stats->small_frames++;
+            }
         }
 
         if (error != seL4_NoError) {
@@ -94,6 +111,7 @@ static int load_segment(vspace_t *loadee_vspace, vspace_t *loader_vspace,
         }
 
         /* copy the frame cap to map into the loader address space */
+        STATS_START(map);
         cspacepath_t loadee_frame_cap;
 
         vka_cspace_make_path(loadee_vka, vspace_get_cap(loadee_vspace, loadee_vaddr),
@@ -112,11 +130,15 @@ static int load_segment(vspace_t *loadee_vspace, vspace_t *loader_vspace,
             error = -1;
             continue;
         }
+        STATS_END(stats, map_cycles, map);
+        stats->loader_maps++;
 
         /* finally copy the data */
+        STATS_START(copy);
         int nbytes = PAGE_SIZE_4K - (dst & PAGE_MASK_4K);
         if (pos < file_size) {
             memcpy(loader_vaddr + (dst % PAGE_SIZE_4K), (void *)src, MIN(nbytes, file_size - pos));
+            stats->bytes_copied += MIN(nbytes, file_size - pos);
         }
         /* Note that we don't need to explicitly zero frames as seL4 gives us zero'd frames */
 
@@ -128,10 +150,13 @@ static int load_segment(vspace_t *loadee_vspace, vspace_t *loader_vspace,
         /* Ensure that the writes to memory that may be executed become visible */
         asm volatile("fence.i" ::: "memory");
 #endif
+        STATS_END(stats, copy_cycles, copy);
 
         /* now unmap the page in the loader address space */
+        STATS_START(unmap);
         vspace_unmap_pages(loader_vspace, (void *) loader_vaddr, 1, seL4_PageBits, VSPACE_PRESERVE);
         vka_cnode_delete(&loader_frame_cap);
+        STATS_END(stats, unmap_cycles, unmap);
 
         pos += nbytes;
         dst += nbytes;
@@ -144,6 +169,268 @@ static int load_segment(vspace_t *loadee_vspace, vspace_t *loader_vspace,
     return error;
 }
 
+#ifdef CONFIG_SEL4UTILS_ELF_BATCH_LOAD
+
+/* Loader mappings are made in windows of up to this many bytes, and never more
+ * than ELF_LOAD_WINDOW_MAX_FRAMES frames */
+#define ELF_LOAD_WINDOW_BITS 22
+#define ELF_LOAD_WINDOW_MAX_FRAMES 256
+
+static size_t window_frames(size_t size_bits)
+{
+    if (size_bits >= ELF_LOAD_WINDOW_BITS) {
+        return 1;
+    }
+    return MIN(ELF_LOAD_WINDOW_MAX_FRAMES, BIT(ELF_LOAD_WINDOW_BITS - size_bits));
+}
+
+/*
+ * Determine the size of the frame mapped at vaddr in a vspace. sel4utils records the
+ * cap of a large page against every 4K page it covers, and a cap can only be mapped
+ * once, so two 4K pages with the same cap must be part of the same large page.
+ */
+static size_t frame_size_bits(vspace_t *vspace, uintptr_t vaddr)
+{
+    uintptr_t base = ROUND_DOWN(vaddr, BIT(seL4_LargePageBits));
+    seL4_CPtr cap = vspace_get_cap(vspace, (void *)base);
+    if (cap != seL4_CapNull && cap == vspace_get_cap(vspace, (void *)(base + PAGE_SIZE_4K))) {
+        return seL4_LargePageBits;
+    }
+    return seL4_PageBits;
+}
+
+/*
+ * Allocate and map frames for all unmapped 4K pages in [start, end) of a single
+ * reservation. Large pages are used for any part of a run of unmapped pages that is
+ * large page aligned, falling back to 4K pages if large frames can't be allocated.
+ */
+static int alloc_frames(vspace_t *loadee_vspace, uintptr_t start, uintptr_t end,
+                        reservation_t reservation, sel4utils_elf_load_stats_t *stats)
+{
+    uintptr_t vaddr = start;
+    while (vaddr < end) {
+        if (vspace_get_cap(loadee_vspace, (void *)vaddr) != seL4_CapNull) {
+            /* already mapped by an adjacent region */
+            vaddr += PAGE_SIZE_4K;
+            continue;
+        }
+        uintptr_t run_end = vaddr;
+        while (run_end < end && vspace_get_cap(loadee_vspace, (void *)run_end) == seL4_CapNull) {
+            run_end += PAGE_SIZE_4K;
+        }
+
+        uintptr_t large_start = ROUND_UP(vaddr, BIT(seL4_LargePageBits));
+        uintptr_t large_end = ROUND_DOWN(run_end, BIT(seL4_LargePageBits));
+        if (large_start < large_end) {
+            size_t num_large = (large_end - large_start) >> seL4_LargePageBits;
+            if (vspace_new_pages_at_vaddr(loadee_vspace, (void *)large_start, num_large,
+                                          seL4_LargePageBits, reservation) == seL4_NoError) {
+                stats->large_frames += num_large;
+            } else {
+                ZF_LOGW("Failed to allocate large frames for elf, using 4K frames");
+                large_start = large_end = run_end;
+            }
+        } else {
+            large_start = large_end = run_end;
+        }
+
+        /* 4K frames either side of the large frames */
+        size_t num_before = (large_start - vaddr) / PAGE_SIZE_4K;
+        size_t num_after = (run_end - large_end) / PAGE_SIZE_4K;
+        int error = seL4_NoError;
+        if (num_before > 0) {
+            error = vspace_new_pages_at_vaddr(loadee_vspace, (void *)vaddr, num_before, seL4_PageBits, reservation);
+        }
+        if (error == seL4_NoError && num_after > 0) {
+            error = vspace_new_pages_at_vaddr(loadee_vspace, (void *)large_end, num_after, seL4_PageBits, reservation);
+        }
+        if (error != seL4_NoError) {
+            ZF_LOGE("ERROR: failed to allocate frames by loadee vka: %d", error);
+            return error;
+        }
+        stats->small_frames += num_before + num_after;
+        vaddr = run_end;
+    }
+    return seL4_NoError;
+}
+
+/*
+ * Map a window of the loadee's frames into the loader, starting at the frame containing
+ * vaddr, and copy in the part of the segment's file data that falls within it. The window
+ * is no more frames than there are loader slots. Returns the end of the window in *window_end.
+ */
+static int load_window(vspace_t *loadee_vspace, vspace_t *loader_vspace,
+                       vka_t *loadee_vka, vka_t *loader_vka,
+                       cspacepath_t loader_slots[ELF_LOAD_WINDOW_MAX_FRAMES], size_t num_slots,
+                       uintptr_t vaddr, uintptr_t end, uintptr_t file_start, char *src, size_t file_size,
+                       uintptr_t *window_end, sel4utils_elf_load_stats_t *stats)
+{
+    size_t size_bits = frame_size_bits(loadee_vspace, vaddr);
+    size_t max_frames = MIN(window_frames(size_bits), num_slots);
+    uintptr_t window_start = ROUND_DOWN(vaddr, BIT(size_bits));
+    seL4_CPtr loader_caps[ELF_LOAD_WINDOW_MAX_FRAMES];
+    seL4_CPtr loadee_caps[ELF_LOAD_WINDOW_MAX_FRAMES];
+    size_t num_frames = 0;
+    int error = seL4_NoError;
+
+    /* collect consecutive frames of the same size */
+    STATS_START(map);
+    vaddr = window_start;
+    while (vaddr < end && num_frames < max_frames && frame_size_bits(loadee_vspace, vaddr) == size_bits) {
+        cspacepath_t loadee_frame_cap;
+        loadee_caps[num_frames] = vspace_get_cap(loadee_vspace, (void *)vaddr);
+        vka_cspace_make_path(loadee_vka, loadee_caps[num_frames], &loadee_frame_cap);
+        error = vka_cnode_copy(&loader_slots[num_frames], &loadee_frame_cap, seL4_AllRights);
+        if (error != seL4_NoError) {
+            ZF_LOGE("ERROR: failed to copy frame cap into loader cspace: %d", error);
+            break;
+        }
+        loader_caps[num_frames] = loader_slots[num_frames].capPtr;
+        num_frames++;
+        vaddr += BIT(size_bits);
+    }
+    *window_end = vaddr;
+
+    void *loader_vaddr = NULL;
+    if (error == seL4_NoError) {
+        loader_vaddr = vspace_map_pages(loader_vspace, loader_caps, NULL, seL4_AllRights, num_frames, size_bits, 1);
+        if (loader_vaddr == NULL) {
+            ZF_LOGE("failed to map frames into loader vspace.");
+            error = -1;
+        }
+    }
+    STATS_END(stats, map_cycles, map);
+
+    if (error == seL4_NoError) {
+        stats->loader_maps++;
+
+        /* copy whatever part of the file data is in this window */
+        STATS_START(copy);
+        uintptr_t copy_start = MAX(window_start, file_start);
+        uintptr_t copy_end = MIN(*window_end, file_start + file_size);
+        if (copy_start < copy_end) {
+            memcpy(loader_vaddr + (copy_start - window_start), src + (copy_start - file_start), copy_end - copy_start);
+            stats->bytes_copied += copy_end - copy_start;
+        }
+        /* Note that we don't need to explicitly zero frames as seL4 gives us zero'd frames */
+
+#ifdef CONFIG_ARCH_ARM
+        /* Flush the caches */
+        for (size_t i = 0; i < num_frames; i++) {
+            seL4_ARM_Page_Unify_Instruction(loader_caps[i], 0, BIT(size_bits));
+            seL4_ARM_Page_Unify_Instruction(loadee_caps[i], 0, BIT(size_bits));
+        }
+#elif CONFIG_ARCH_RISCV
+        /* Ensure that the writes to memory that may be executed become visible */
+        asm volatile("fence.i" ::: "memory");
+#endif
+        STATS_END(stats, copy_cycles, copy);
+
+        STATS_START(unmap);
+        vspace_unmap_pages(loader_vspace, loader_vaddr, num_frames, size_bits, VSPACE_PRESERVE);
+        STATS_END(stats, unmap_cycles, unmap);
+    }
+
+    for (size_t i = 0; i < num_frames; i++) {
+        vka_cnode_delete(&loader_slots[i]);
+    }
+    return error;
+}
+
+/*
+ * Load a segment by first allocating every frame it needs, then copying the segment
+ * data in through windows of many frames at a time. Frames shared with adjacent regions
+ * are allocated from their reservations as in load_segment.
+ */
+static int load_segment_batched(vspace_t *loadee_vspace, vspace_t *loader_vspace,
+                                vka_t *loadee_vka, vka_t *loader_vka,
+                                char *src, size_t file_size, int num_regions,
+                                sel4utils_elf_region_t regions[num_regions], int region_index,
+                                sel4utils_elf_load_stats_t *stats)
+{
+    int error = seL4_NoError;
+    sel4utils_elf_region_t region = regions[region_index];
+    if (file_size > region.size) {
+        ZF_LOGE("Error, file_size %zu > segment_size %"PRIu32, file_size, region.size);
+        return seL4_InvalidArgument;
+    }
+
+    uintptr_t file_start = (uintptr_t) region.elf_vstart;
+    uintptr_t start = ROUND_DOWN(file_start, PAGE_SIZE_4K);
+    uintptr_t end = ROUND_UP(file_start + region.size, PAGE_SIZE_4K);
+    uintptr_t res_start = (uintptr_t) region.reservation_vstart;
+    uintptr_t res_end = res_start + region.reservation_size;
+
+    /* Allocate everything up front, from whichever reservation each part belongs to */
+    STATS_START(alloc);
+    uintptr_t vaddr = start;
+    while (vaddr < end && error == seL4_NoError) {
+        reservation_t reservation;
+        uintptr_t part_end;
+        if (vaddr < res_start) {
+            /* Have to use reservation from adjacent region */
+            if ((region_index - 1) < 0) {
+                ZF_LOGE("Invalid regions: bad elf file.");
+                return 1;
+            }
+            reservation = regions[region_index - 1].reservation;
+            part_end = MIN(res_start, end);
+        } else if (vaddr >= res_end) {
+            if ((region_index + 1) >= num_regions) {
+                ZF_LOGE("Invalid regions: bad elf file.");
+                return 1;
+            }
+            reservation = regions[region_index + 1].reservation;
+            part_end = end;
+        } else {
+            reservation = region.reservation;
+            part_end = MIN(res_end, end);
+        }
+        error = alloc_frames(loadee_vspace, vaddr, part_end, reservation, stats);
+        vaddr = part_end;
+    }
+    STATS_END(stats, alloc_cycles, alloc);
+    if (error != seL4_NoError) {
+        return error;
+    }
+
+    /* Only the part of the segment backed by the file needs to be copied */
+    if (file_size == 0) {
+        return seL4_NoError;
+    }
+    end = ROUND_UP(file_start + file_size, PAGE_SIZE_4K);
+
+    /* Windows are limited to as many loader slots as we can get, so a small loader
+     * cspace just means smaller windows */
+    cspacepath_t loader_slots[ELF_LOAD_WINDOW_MAX_FRAMES];
+    size_t num_slots = 0;
+    for (; num_slots < ELF_LOAD_WINDOW_MAX_FRAMES; num_slots++) {
+        seL4_CPtr slot;
+        error = vka_cspace_alloc(loader_vka, &slot);
+        if (error) {
+            break;
+        }
+        vka_cspace_make_path(loader_vka, slot, &loader_slots[num_slots]);
+    }
+    if (num_slots == 0) {
+        ZF_LOGE("Failed to allocate cslot by loader vka: %d", error);
+        return error;
+    }
+    error = seL4_NoError;
+
+    vaddr = start;
+    while (vaddr < end && error == seL4_NoError) {
+        error = load_window(loadee_vspace, loader_vspace, loadee_vka, loader_vka, loader_slots, num_slots,
+                            vaddr, end, file_start, src, file_size, &vaddr, stats);
+    }
+
+    for (size_t i = 0; i < num_slots; i++) {
+        vka_cspace_free(loader_vka, loader_slots[i].capPtr);
+    }
+    return error;
+}
+#endif /* CONFIG_SEL4UTILS_ELF_BATCH_LOAD */
+
 /**
  * Load an array of regions into a vspace.
  *
@@ -159,12 +446,14 @@ static int load_segment(vspace_t *loadee_vspace, vspace_t *loader_vspace,
  * @param elf_file pointer to elf object
  * @param num_regions total number of segments/regions to load.
  * @param regions region array containing segment info.
+ * @param stats statistics to update with the work done.
  *
  * @return 0 on success.
  */
 static int load_segments(vspace_t *loadee_vspace, vspace_t *loader_vspace,
                          vka_t *loadee_vka, vka_t *loader_vka, elf_t *elf_file,
-                         int num_regions, sel4utils_elf_region_t regions[num_regions])
+                         int num_regions, sel4utils_elf_region_t regions[num_regions],
+                         sel4utils_elf_load_stats_t *stats)
 {
     for (int i = 0; i < num_regions; i++) {
         int segment_index = regions[i].segment_index;
@@ -174,8 +463,13 @@ static int load_segments(vspace_t *loadee_vspace, vspace_t *loader_vspace,
         }
         size_t file_size = elf_getProgramHeaderFileSize(elf_file, segment_index);
 
+#ifdef CONFIG_SEL4UTILS_ELF_BATCH_LOAD
+        int error = load_segment_batched(loadee_vspace, loader_vspace, loadee_vka, loader_vka,
+                                         source_addr, file_size, num_regions, regions, i, stats);
+#else
         int error = load_segment(loadee_vspace, loader_vspace, loadee_vka, loader_vka,
-                                 source_addr, file_size, num_regions, regions, i);
+                                 source_addr, file_size, num_regions, regions, i, stats);
+#endif
         if (error) {
             return error;
         }
@@ -468,8 +762,9 @@ void *sel4utils_elf_reserve(vspace_t *loadee, elf_t *elf_file, sel4utils_elf_reg
     return entry_point(elf_file);
 }
 
-void *sel4utils_elf_load_record_regions(vspace_t *loadee, vspace_t *loader, vka_t *loadee_vka, vka_t *loader_vka,
-                                        elf_t *elf_file, sel4utils_elf_region_t *regions, int mapanywhere)
+static void *elf_load(vspace_t *loadee, vspace_t *loader, vka_t *loadee_vka, vka_t *loader_vka,
+                      elf_t *elf_file, sel4utils_elf_region_t *regions, int mapanywhere,
+                      sel4utils_elf_load_stats_t *stats)
 {
     /* Calculate number of loadable regions.  Use stack array if one wasn't passed in */
     int num_regions = count_loadable_regions(elf_file);
@@ -481,14 +776,16 @@ void *sel4utils_elf_load_record_regions(vspace_t *loadee, vspace_t *loader, vka_
     }
 
     /* Create reservations */
+    STATS_START(reserve);
     int error = elf_reserve_regions_in_vspace(loadee, elf_file, num_regions, regions, mapanywhere);
+    STATS_END(stats, reserve_cycles, reserve);
     if (error) {
         ZF_LOGE("Failed to reserve regions");
         return NULL;
     }
 
     /* Load Map reservations and load in elf data */
-    error = load_segments(loadee, loader, loadee_vka, loader_vka, elf_file, num_regions, regions);
+    error = load_segments(loadee, loader, loadee_vka, loader_vka, elf_file, num_regions, regions, stats);
     if (error) {
         ZF_LOGE("Failed to load segments");
         return NULL;
@@ -507,6 +804,13 @@ void *sel4utils_elf_load_record_regions(vspace_t *loadee, vspace_t *loader, vka_
     return entry_point(elf_file);
 }
 
+void *sel4utils_elf_load_record_regions(vspace_t *loadee, vspace_t *loader, vka_t *loadee_vka, vka_t *loader_vka,
+                                        elf_t *elf_file, sel4utils_elf_region_t *regions, int mapanywhere)
+{
+    sel4utils_elf_load_stats_t stats = {0};
+    return elf_load(loadee, loader, loadee_vka, loader_vka, elf_file, regions, mapanywhere, &stats);
+}
+
 uintptr_t sel4utils_elf_get_vsyscall(elf_t *elf_file)
 {
     uintptr_t *addr = (uintptr_t *)sel4utils_elf_get_section(elf_file, "__vsyscall", NULL);
@@ -537,6 +841,13 @@ void *sel4utils_elf_load(vspace_t *loadee, vspace_t *loader, vka_t *loadee_vka,
     return sel4utils_elf_load_record_regions(loadee, loader, loadee_vka, loader_vka, elf_file, NULL, 0);
 }
 
+void *sel4utils_elf_load_with_stats(vspace_t *loadee, vspace_t *loader, vka_t *loadee_vka, vka_t *loader_vka,
+                                    elf_t *elf_file, sel4utils_elf_load_stats_t *stats)
+{
+    *stats = (sel4utils_elf_load_stats_t) {0};
+    return elf_load(loadee, loader, loadee_vka, loader_vka, elf_file, NULL, 0, stats);
+}
+
 uint32_t sel4utils_elf_num_phdrs(elf_t *elf_file)
 {
     return elf_getNumProgramHeaders(elf_file);
@@ -34,6 +34,7 @@ struct irq_server_thread {
     seL4_CPtr delivery_ep;
     seL4_Word label;
     sel4utils_thread_t thread;
+    irq_server_t *irq_server;
     /* Linked list chain of threads */
     irq_server_thread_t *next;
 };
@@ -46,6 +47,8 @@ struct irq_server {
     irq_server_thread_t *server_threads;
     size_t num_irqs;
     size_t max_irqs;
+    /* Coalesce pending IRQs and acknowledge them in batches */
+    bool batch_acks;
 
     /* New thread parameters */
     seL4_Word priority;
@@ -63,8 +66,13 @@ struct irq_server {
 static void irq_server_node_handle_irq(irq_server_thread_t *thread_info,
                                        ps_irq_ops_t *irq_ops, seL4_Word badge)
 {
+    int error;
     ntfn_id_t target_ntfn = thread_info->thread_id;
-    int error = sel4platsupport_irq_handle(irq_ops, target_ntfn, badge);
+    if (thread_info->irq_server->batch_acks) {
+        error = sel4platsupport_irq_handle_batched(irq_ops, target_ntfn, badge);
+    } else {
+        error = sel4platsupport_irq_handle(irq_ops, target_ntfn, badge);
+    }
     if (error) {
         if (error == -EINVAL) {
             ZF_LOGE("Passed in a wrong ntfn_id to the IRQ interface! Something is very wrong with the IRQ server");
@@ -131,6 +139,8 @@ static void _irq_thread_entry(irq_server_thread_t *my_thread_info, ps_irq_ops_t
 
     while (1) {
         seL4_Word badge = 0;
+        /* The badge holds every IRQ signalled since the last wait, so in
+         * batch mode they are all handled, and acknowledged, together */
         seL4_Wait(ntfn, &badge);
         if (ep != seL4_CapNull) {
             /* Synchronous endpoint registered. Send IPC */
@@ -216,6 +226,7 @@ thread_id_t irq_server_thread_new(irq_server_t *irq_server, seL4_CPtr provided_n
     new_thread->label = irq_server->label;
     new_thread->node = new_node;
     new_thread->thread_id = thread_id_to_use;
+    new_thread->irq_server = irq_server;
 
     /* Create the IRQ thread */
     sel4utils_thread_config_t config = thread_config_default(irq_server->simple, irq_server->cspace,
@@ -366,6 +377,11 @@ irq_server_t *irq_server_new(vspace_t *vspace, vka_t *vka, seL4_Word priority,
     return new;
 }
 
+void irq_server_set_batch_ack(irq_server_t *irq_server, bool enable)
+{
+    irq_server->batch_acks = enable;
+}
+
 seL4_MessageInfo_t irq_server_wait_for_irq(irq_server_t *irq_server, seL4_Word *ret_badge)
 {
     seL4_MessageInfo_t msginfo = {0};
@@ -97,16 +97,32 @@ static void *dma_alloc(void *cookie, size_t size, int align, int cached, ps_mem_
     if (!frames) {
         goto handle_error;
     }
-    for (unsigned i = 0; i < num_frames; i++) {
-        error = vka_cspace_alloc_path(&dma->vka, &frames[i]);
-        if (error) {
-            goto handle_error;
+    unsigned max_batch = dma->vka.cspace_alloc_range ? seL4_UntypedRetypeMaxObjects : 1;
+    for (unsigned i = 0; i < num_frames;) {
+        /* Create as many frames as possible with each retype, using smaller batches
+         * if the cspace cannot provide a contiguous range of slots that large */
+        unsigned batch = MIN(num_frames - i, max_batch);
+        seL4_CPtr first;
+        if (batch > 1 && vka_cspace_alloc_range(&dma->vka, batch, &first) != 0) {
+            max_batch = batch / 2;
+            continue;
+        }
+        if (batch > 1) {
+            for (unsigned j = 0; j < batch; j++) {
+                vka_cspace_make_path(&dma->vka, first + j, &frames[i + j]);
+            }
+        } else {
+            error = vka_cspace_alloc_path(&dma->vka, &frames[i]);
+            if (error) {
+                goto handle_error;
+            }
         }
         error = seL4_Untyped_Retype(ut.cptr, kobject_get_type(KOBJECT_FRAME, PAGE_BITS_4K), size_bits, frames[i].root,
-                                    frames[i].dest, frames[i].destDepth, frames[i].offset, 1);
+                                    frames[i].dest, frames[i].destDepth, frames[i].offset, batch);
         if (error != seL4_NoError) {
             goto handle_error;
         }
+        i += batch;
     }
     /* Grab a reservation */
     res = vspace_reserve_range(&dma->vspace, size, seL4_AllRights, cached, &base);
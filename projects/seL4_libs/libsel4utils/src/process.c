@@ -29,6 +29,31 @@
 extern char _cpio_archive[];
 extern char _cpio_archive_end[];
 
+/* Index of the archive, built on first use so repeated spawns don't rescan it */
+static struct cpio_index cpio_archive_index;
+static bool cpio_archive_indexed;
+
+static void *get_archive_file(const char *name, unsigned long *size)
+{
+    unsigned long cpio_len = _cpio_archive_end - _cpio_archive;
+    if (!cpio_archive_indexed) {
+        struct cpio_info info;
+        if (cpio_info(_cpio_archive, cpio_len, &info) == 0) {
+            unsigned long buf_len = CPIO_INDEX_BUF_SIZE(info.file_count);
+            void *buf = malloc(buf_len);
+            if (buf != NULL && cpio_index_init(&cpio_archive_index, _cpio_archive, cpio_len, buf, buf_len) == 0) {
+                cpio_archive_indexed = true;
+            } else {
+                free(buf);
+            }
+        }
+    }
+    if (cpio_archive_indexed) {
+        return cpio_index_get_file(&cpio_archive_index, name, size);
+    }
+    return cpio_get_file(_cpio_archive, cpio_len, name, size);
+}
+
 void sel4utils_allocated_object(void *cookie, vka_object_t object)
 {
     static bool recurse = false;
@@ -554,13 +579,13 @@ int sel4utils_configure_process_custom(sel4utils_process_t *process, vka_t *vka,
     /* finally elf load */
     if (config.is_elf) {
         unsigned long size;
-        unsigned long cpio_len = _cpio_archive_end - _cpio_archive;
-        char *file = cpio_get_file(_cpio_archive, cpio_len, config.image_name, &size);
+        char *file = get_archive_file(config.image_name, &size);
         elf_t elf;
         elf_newFile(file, size, &elf);
 
         if (config.do_elf_load) {
-            process->entry_point = sel4utils_elf_load(&process->vspace, spawner_vspace, vka, vka, &elf);
+            process->entry_point = sel4utils_elf_load_with_stats(&process->vspace, spawner_vspace, vka, vka, &elf,
+                                                                 &process->elf_load_stats);
         } else {
             process->num_elf_regions = sel4utils_elf_num_regions(&elf);
             process->elf_regions = calloc(process->num_elf_regions, sizeof(*process->elf_regions));
@@ -192,6 +192,9 @@ int slab_init(vka_t *slab_vka, vka_t *delegate, size_t object_freq[seL4_ObjectTy
     slab_vka->utspace_alloc = slab_utspace_alloc;
     slab_vka->utspace_alloc_maybe_device = slab_utspace_alloc_maybe_device;
     slab_vka->utspace_free = slab_utspace_free;
+    /* objects come from the slabs one at a time */
+    slab_vka->cspace_alloc_range = NULL;
+    slab_vka->utspace_alloc_range = NULL;
 
     /* allocate untyped */
     size_t total_size = calculate_total_size(object_freq);
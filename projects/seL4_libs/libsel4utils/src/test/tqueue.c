@@ -0,0 +1,121 @@
+/*
+ * Copyright 2017, Data61, CSIRO (ABN 41 687 119 230)
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdio.h>
+
+#include <sel4/sel4.h>
+#include <sel4bench/sel4bench.h>
+#include <platsupport/tqueue.h>
+#include <sel4utils/test.h>
+#include <utils/page.h>
+#include <vspace/vspace.h>
+
+#include <sel4test/test.h>
+#include <sel4test/testutil.h>
+
+/* Operations timed at each queue size */
+#define TQUEUE_BENCH_ITERATIONS 1000
+#define TQUEUE_BENCH_PERIOD 1000000000ull
+
+void get_sel4utils_tqueue_bench(void)
+{
+}
+
+/* The largest queues don't fit in the test's heap, so back them with fresh pages */
+static int bench_calloc(void *cookie, size_t nmemb, size_t size, void **ptr)
+{
+    *ptr = vspace_new_pages(cookie, seL4_AllRights, BYTES_TO_4K_PAGES(nmemb * size), seL4_PageBits);
+    return *ptr == NULL ? -1 : 0;
+}
+
+static int bench_free(void *cookie, size_t size, void *ptr)
+{
+    vspace_unmap_pages(cookie, ptr, BYTES_TO_4K_PAGES(size), seL4_PageBits, VSPACE_FREE);
+    return 0;
+}
+
+static int bench_callback(uintptr_t token UNUSED)
+{
+    return 0;
+}
+
+static uint64_t bench_rand(uint64_t *state)
+{
+    *state = *state * 6364136223846793005ull + 1442695040888963407ull;
+    return *state >> 33;
+}
+
+static int bench_tqueue(vspace_t *vspace, int n)
+{
+    ps_malloc_ops_t mops = { .calloc = bench_calloc, .free = bench_free, .cookie = vspace };
+    tqueue_t tq;
+    uint64_t seed = n;
+    ccnt_t reg = 0, cancel = 0, update = 0;
+
+    test_eq(tqueue_init_static(&tq, &mops, n), 0);
+
+    /* Fill the queue with periodic timeouts spread over one period */
+    for (int i = 0; i < n; i++) {
+        unsigned int id;
+        test_eq(tqueue_alloc_id(&tq, &id), 0);
+        timeout_t timeout = {
+            .abs_time = bench_rand(&seed) % TQUEUE_BENCH_PERIOD,
+            .period = TQUEUE_BENCH_PERIOD,
+            .callback = bench_callback,
+        };
+        test_eq(tqueue_register(&tq, id, &timeout), 0);
+    }
+
+    for (int i = 0; i < TQUEUE_BENCH_ITERATIONS; i++) {
+        unsigned int id = bench_rand(&seed) % n;
+        timeout_t timeout = {
+            .abs_time = bench_rand(&seed) % TQUEUE_BENCH_PERIOD,
+            .period = TQUEUE_BENCH_PERIOD,
+            .callback = bench_callback,
+        };
+        uint64_t next;
+
+        ccnt_t start = sel4bench_get_cycle_count();
+        int error = tqueue_cancel(&tq, id);
+        ccnt_t end = sel4bench_get_cycle_count();
+        test_eq(error, 0);
+        cancel += end - start;
+
+        start = sel4bench_get_cycle_count();
+        error = tqueue_register(&tq, id, &timeout);
+        end = sel4bench_get_cycle_count();
+        test_eq(error, 0);
+        reg += end - start;
+
+        /* Fire the earliest timeout, which moves on by a period */
+        test_eq(tqueue_next(&tq, &next), 0);
+        start = sel4bench_get_cycle_count();
+        error = tqueue_update(&tq, next, NULL);
+        end = sel4bench_get_cycle_count();
+        test_eq(error, 0);
+        update += end - start;
+    }
+
+    printf("tqueue %d timers: register %llu, cancel %llu, update %llu cycles\n", n,
+           (unsigned long long)(reg / TQUEUE_BENCH_ITERATIONS),
+           (unsigned long long)(cancel / TQUEUE_BENCH_ITERATIONS),
+           (unsigned long long)(update / TQUEUE_BENCH_ITERATIONS));
+
+    bench_free(vspace, n * sizeof(tqueue_node_t *), tq.heap);
+    bench_free(vspace, n * sizeof(tqueue_node_t), tq.array);
+    return sel4test_get_result();
+}
+
+static int test_tqueue_bench(env_t env)
+{
+    sel4bench_init();
+    bench_tqueue(&env->vspace, 10);
+    bench_tqueue(&env->vspace, 1024);
+    bench_tqueue(&env->vspace, 65536);
+    sel4bench_destroy();
+    return sel4test_get_result();
+}
+DEFINE_TEST(SEL4UTILS_TQUEUE_BENCH, "Cost of tqueue operations at 10, 1k and 64k timers", test_tqueue_bench, true)
@@ -0,0 +1,143 @@
+/*
+ * Copyright 2017, Data61, CSIRO (ABN 41 687 119 230)
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <sel4/sel4.h>
+#include <sel4utils/vspace.h>
+#include <sel4utils/vspace_internal.h>
+#include <sel4utils/test.h>
+#include <vka/object.h>
+
+#include <sel4test/test.h>
+#include <sel4test/testutil.h>
+
+void get_sel4utils_vspace_tests(void)
+{
+}
+
+static int test_promotion_after_free(env_t env)
+{
+    vspace_t *vspace = &env->vspace;
+    bool promote = get_alloc_data(vspace)->promote_pages;
+    size_t num_pages = BIT(seL4_LargePageBits - seL4_PageBits);
+    void *vaddr;
+
+    reservation_t res = vspace_reserve_range_aligned(vspace, BIT(seL4_LargePageBits), seL4_LargePageBits,
+                                                     seL4_AllRights, 1, &vaddr);
+    test_assert(res.res != NULL);
+
+    /* Map and free 4K pages, which leaves a page table where a large frame would go */
+    sel4utils_set_page_promotion(vspace, false);
+    test_eq(vspace_new_pages_at_vaddr(vspace, vaddr, num_pages, seL4_PageBits, res), 0);
+    vspace_unmap_pages(vspace, vaddr, num_pages, seL4_PageBits, VSPACE_FREE);
+
+    /* Promotion can't map a large frame over the page table, so falls back to 4K pages */
+    size_t small_mappings = sel4utils_get_num_mappings(vspace, seL4_PageBits);
+    sel4utils_set_page_promotion(vspace, true);
+    int error = vspace_new_pages_at_vaddr(vspace, vaddr, num_pages, seL4_PageBits, res);
+    sel4utils_set_page_promotion(vspace, promote);
+    test_eq(error, 0);
+    test_eq(sel4utils_get_num_mappings(vspace, seL4_PageBits) - small_mappings, num_pages);
+
+    memset(vaddr, 0xa5, BIT(seL4_LargePageBits));
+    test_eq((int) ((uint8_t *) vaddr)[BIT(seL4_LargePageBits) - 1], 0xa5);
+
+    vspace_unmap_pages(vspace, vaddr, num_pages, seL4_PageBits, VSPACE_FREE);
+    vspace_free_reservation(vspace, res);
+    return sel4test_get_result();
+}
+DEFINE_TEST(SEL4UTILS_VSPACE_001, "Promoted pages can reuse a range that held 4K pages", test_promotion_after_free,
+            true)
+
+/* Whether the allocator has an untyped large enough for a large frame. Without one
+ * promotion always falls back to 4K pages */
+static bool large_frames_available(env_t env)
+{
+    vka_object_t frame;
+    if (vka_alloc_frame(&env->vka, seL4_LargePageBits, &frame) != 0) {
+        return false;
+    }
+    vka_free_object(&env->vka, &frame);
+    return true;
+}
+
+static int test_promotion_maps_large_frames(env_t env)
+{
+    vspace_t *vspace = &env->vspace;
+    bool promote = get_alloc_data(vspace)->promote_pages;
+    size_t num_pages = BIT(seL4_LargePageBits - seL4_PageBits);
+    void *vaddr;
+
+    if (!large_frames_available(env)) {
+        printf("No untyped for a large frame, skipping\n");
+        return sel4test_get_result();
+    }
+
+    reservation_t res = vspace_reserve_range_aligned(vspace, BIT(seL4_LargePageBits), seL4_LargePageBits,
+                                                     seL4_AllRights, 1, &vaddr);
+    test_assert(res.res != NULL);
+
+    size_t small_mappings = sel4utils_get_num_mappings(vspace, seL4_PageBits);
+    size_t large_mappings = sel4utils_get_num_mappings(vspace, seL4_LargePageBits);
+    sel4utils_set_page_promotion(vspace, true);
+    int error = vspace_new_pages_at_vaddr(vspace, vaddr, num_pages, seL4_PageBits, res);
+    sel4utils_set_page_promotion(vspace, promote);
+    test_eq(error, 0);
+    test_eq(sel4utils_get_num_mappings(vspace, seL4_LargePageBits) - large_mappings, (size_t) 1);
+    test_eq(sel4utils_get_num_mappings(vspace, seL4_PageBits), small_mappings);
+    test_assert(vspace_get_cap(vspace, vaddr) != seL4_CapNull);
+    test_eq(vspace_get_cap(vspace, (void *) ((uintptr_t) vaddr + BIT(seL4_LargePageBits) - BIT(seL4_PageBits))),
+            vspace_get_cap(vspace, vaddr));
+
+    memset(vaddr, 0xa5, BIT(seL4_LargePageBits));
+    test_eq((int) ((uint8_t *) vaddr)[BIT(seL4_LargePageBits) - 1], 0xa5);
+
+    vspace_unmap_pages(vspace, vaddr, num_pages, seL4_PageBits, VSPACE_FREE);
+    vspace_free_reservation(vspace, res);
+    return sel4test_get_result();
+}
+DEFINE_TEST(SEL4UTILS_VSPACE_002, "Promoted pages are mapped with large frames", test_promotion_maps_large_frames,
+            true)
+
+static int test_promotion_resumes_after_blocked_frame(env_t env)
+{
+    vspace_t *vspace = &env->vspace;
+    bool promote = get_alloc_data(vspace)->promote_pages;
+    size_t large_pages = BIT(seL4_LargePageBits - seL4_PageBits);
+    void *vaddr;
+
+    if (!large_frames_available(env)) {
+        printf("No untyped for a large frame, skipping\n");
+        return sel4test_get_result();
+    }
+
+    reservation_t res = vspace_reserve_range_aligned(vspace, 2 * BIT(seL4_LargePageBits), seL4_LargePageBits,
+                                                     seL4_AllRights, 1, &vaddr);
+    test_assert(res.res != NULL);
+
+    /* Leave a page table behind in the first large page only */
+    sel4utils_set_page_promotion(vspace, false);
+    test_eq(vspace_new_pages_at_vaddr(vspace, vaddr, large_pages, seL4_PageBits, res), 0);
+    vspace_unmap_pages(vspace, vaddr, large_pages, seL4_PageBits, VSPACE_FREE);
+
+    /* The first large page falls back to 4K pages, the second is still promoted */
+    size_t small_mappings = sel4utils_get_num_mappings(vspace, seL4_PageBits);
+    size_t large_mappings = sel4utils_get_num_mappings(vspace, seL4_LargePageBits);
+    sel4utils_set_page_promotion(vspace, true);
+    int error = vspace_new_pages_at_vaddr(vspace, vaddr, 2 * large_pages, seL4_PageBits, res);
+    sel4utils_set_page_promotion(vspace, promote);
+    test_eq(error, 0);
+    test_eq(sel4utils_get_num_mappings(vspace, seL4_PageBits) - small_mappings, large_pages);
+    test_eq(sel4utils_get_num_mappings(vspace, seL4_LargePageBits) - large_mappings, (size_t) 1);
+
+    vspace_unmap_pages(vspace, vaddr, 2 * large_pages, seL4_PageBits, VSPACE_FREE);
+    vspace_free_reservation(vspace, res);
+    return sel4test_get_result();
+}
+DEFINE_TEST(SEL4UTILS_VSPACE_003, "Promotion resumes after a large page blocked by a page table",
+            test_promotion_resumes_after_blocked_frame, true)
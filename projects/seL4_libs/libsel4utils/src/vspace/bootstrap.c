@@ -39,8 +39,10 @@ static int common_init(vspace_t *vspace, vka_t *vka, seL4_CPtr vspace_root,
     sel4utils_alloc_data_t *data = get_alloc_data(vspace);
     data->vka = vka;
     data->last_allocated = 0x10000000;
-    data->reservation_head = NULL;
+    data->reservation_root = NULL;
     data->is_empty = false;
+    data->promote_pages = config_set(CONFIG_SEL4UTILS_PAGE_PROMOTION);
+    memset(data->num_mappings, 0, sizeof(data->num_mappings));
 
     data->vspace_root = vspace_root;
     vspace->allocated_object = allocated_object_fn;
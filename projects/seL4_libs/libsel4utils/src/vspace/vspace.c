@@ -56,66 +56,101 @@ static int check_reservation(vspace_mid_level_t *top_level, sel4utils_res_t *res
            is_reserved_range(top_level, start, end);
 }
 
-static void insert_reservation(sel4utils_alloc_data_t *data, sel4utils_res_t *reservation)
+/* Reservations are kept in a treap ordered by start address. Reservations never
+ * overlap, so start addresses are unique. Priorities are a hash of the start
+ * address, which needs no extra state and keeps the tree balanced regardless of
+ * the order reservations are made and freed in */
+static inline uintptr_t reservation_priority(sel4utils_res_t *reservation)
 {
+    uintptr_t h = reservation->start >> PAGE_BITS_4K;
+    h ^= h >> 16;
+    h *= 0x45d9f3b;
+    h ^= h >> 16;
+    return h;
+}
 
-    assert(data != NULL);
-    assert(reservation != NULL);
-
-    reservation->next = NULL;
-
-    /* insert at head */
-    if (data->reservation_head == NULL || reservation->start > data->reservation_head->start) {
-        reservation->next = data->reservation_head;
-        data->reservation_head = reservation;
-        return;
+static sel4utils_res_t *insert_reservation_at(sel4utils_res_t *root, sel4utils_res_t *reservation)
+{
+    if (root == NULL) {
+        return reservation;
     }
 
-    /* insert elsewhere */
-    sel4utils_res_t *prev = data->reservation_head;
-    sel4utils_res_t *current = prev->next;
-
-    while (current != NULL) {
-        /* insert in the middle */
-        if (reservation->start > current->start) {
-            reservation->next = current;
-            prev->next = reservation;
-            return;
+    assert(reservation->start != root->start);
+    if (reservation->start < root->start) {
+        root->left = insert_reservation_at(root->left, reservation);
+        if (reservation_priority(root->left) > reservation_priority(root)) {
+            /* rotate right */
+            sel4utils_res_t *left = root->left;
+            root->left = left->right;
+            left->right = root;
+            return left;
+        }
+    } else {
+        root->right = insert_reservation_at(root->right, reservation);
+        if (reservation_priority(root->right) > reservation_priority(root)) {
+            /* rotate left */
+            sel4utils_res_t *right = root->right;
+            root->right = right->left;
+            right->left = root;
+            return right;
         }
-        prev = current;
-        current = current->next;
     }
-
-    /* insert at the end */
-    prev->next = reservation;
+    return root;
 }
 
-static void remove_reservation(sel4utils_alloc_data_t *data, sel4utils_res_t *reservation)
+static sel4utils_res_t *join_reservations(sel4utils_res_t *left, sel4utils_res_t *right)
 {
-    /* remove head */
-    if (reservation == data->reservation_head) {
-        data->reservation_head = data->reservation_head->next;
-        reservation->next = NULL;
-        return;
+    if (left == NULL) {
+        return right;
+    }
+    if (right == NULL) {
+        return left;
     }
 
-    sel4utils_res_t *prev = data->reservation_head;
-    sel4utils_res_t *current = prev->next;
+    if (reservation_priority(left) > reservation_priority(right)) {
+        left->right = join_reservations(left->right, right);
+        return left;
+    }
+    right->left = join_reservations(left, right->left);
+    return right;
+}
 
-    while (current != NULL) {
-        /* remove middle */
-        if (current == reservation) {
-            prev->next = reservation->next;
-            reservation->next = NULL;
-            return;
-        }
-        prev = current;
-        current = current->next;
+static sel4utils_res_t *remove_reservation_at(sel4utils_res_t *root, sel4utils_res_t *reservation)
+{
+    if (root == NULL) {
+        ZF_LOGE("Reservation %p not found", (void *) reservation->start);
+        return NULL;
+    }
+
+    if (reservation->start < root->start) {
+        root->left = remove_reservation_at(root->left, reservation);
+        return root;
+    }
+    if (reservation->start > root->start) {
+        root->right = remove_reservation_at(root->right, reservation);
+        return root;
     }
 
-    /* remove tail */
-    prev->next = NULL;
-    reservation->next = NULL;
+    assert(root == reservation);
+    root = join_reservations(reservation->left, reservation->right);
+    reservation->left = NULL;
+    reservation->right = NULL;
+    return root;
+}
+
+static void insert_reservation(sel4utils_alloc_data_t *data, sel4utils_res_t *reservation)
+{
+    assert(data != NULL);
+    assert(reservation != NULL);
+
+    reservation->left = NULL;
+    reservation->right = NULL;
+    data->reservation_root = insert_reservation_at(data->reservation_root, reservation);
+}
+
+static void remove_reservation(sel4utils_alloc_data_t *data, sel4utils_res_t *reservation)
+{
+    data->reservation_root = remove_reservation_at(data->reservation_root, reservation);
 }
 
 static void perform_reservation(vspace_t *vspace, sel4utils_res_t *reservation, uintptr_t vaddr, size_t bytes,
@@ -224,61 +259,201 @@ static int map_page(vspace_t *vspace, seL4_CPtr cap, void *vaddr, seL4_CapRights
                     int cacheable, size_t size_bits)
 {
     sel4utils_alloc_data_t *data = get_alloc_data(vspace);
-    return data->map_page(vspace, cap, vaddr, rights, cacheable, size_bits);
+    int error = data->map_page(vspace, cap, vaddr, rights, cacheable, size_bits);
+    if (error == seL4_NoError) {
+        for (int i = 0; i < SEL4_NUM_PAGE_SIZES; i++) {
+            if (sel4_page_sizes[i] == size_bits) {
+                data->num_mappings[i]++;
+            }
+        }
+    }
+    return error;
 }
 
-static sel4utils_res_t *find_reserve(sel4utils_alloc_data_t *data, uintptr_t vaddr)
+/* The largest frames that new pages are promoted to. AArch64 stops at 2M frames, other
+ * architectures use every page size the kernel supports, which on x86_64 includes 1G
+ * frames only when the kernel is built with CONFIG_HUGE_PAGE */
+#ifdef CONFIG_ARCH_AARCH64
+#define PROMOTION_MAX_BITS seL4_LargePageBits
+#else
+#define PROMOTION_MAX_BITS CONFIG_WORD_SIZE
+#endif
+
+/* The largest page size, no bigger than max_bits, that vaddr is aligned to and that
+ * fits before end. Returns size_bits if there is no larger one */
+static size_t promoted_size_bits(uintptr_t vaddr, uintptr_t end, size_t size_bits, size_t max_bits)
+{
+    for (int i = SEL4_NUM_PAGE_SIZES - 1; i >= 0 && sel4_page_sizes[i] > size_bits; i--) {
+        if (sel4_page_sizes[i] <= max_bits && IS_ALIGNED(vaddr, sel4_page_sizes[i]) &&
+            end - vaddr >= BIT(sel4_page_sizes[i])) {
+            return sel4_page_sizes[i];
+        }
+    }
+    return size_bits;
+}
+
+/* Number of pages of size_bits from vaddr up to the next address that a larger frame,
+ * no bigger than max_bits, could be mapped at */
+static size_t pages_before_promotable(uintptr_t vaddr, uintptr_t end, size_t size_bits, size_t max_bits)
 {
+    size_t pages = (end - vaddr) >> size_bits;
+    for (int i = 0; i < SEL4_NUM_PAGE_SIZES; i++) {
+        if (sel4_page_sizes[i] <= size_bits) {
+            continue;
+        }
+        /* the next size up has the nearest boundary, if that doesn't fit no larger size will */
+        if (sel4_page_sizes[i] <= max_bits) {
+            uintptr_t boundary = ROUND_UP(vaddr, BIT(sel4_page_sizes[i]));
+            if (boundary < end && end - boundary >= BIT(sel4_page_sizes[i])) {
+                pages = MIN(pages, (boundary - vaddr) >> size_bits);
+            }
+        }
+        break;
+    }
+    return pages;
+}
 
-    sel4utils_res_t *current = data->reservation_head;
+/* Every entry of a frame records the frame's cap, so a frame larger than size_bits,
+ * as mapped when promoting pages, is recognised by its cap covering its whole extent */
+static size_t mapped_size_bits(vspace_mid_level_t *top_level, uintptr_t vaddr, uintptr_t end, seL4_CPtr cap,
+                               size_t size_bits)
+{
+    if (cap == EMPTY || cap == RESERVED) {
+        return size_bits;
+    }
+    for (int i = SEL4_NUM_PAGE_SIZES - 1; i >= 0 && sel4_page_sizes[i] > size_bits; i--) {
+        size_t bits = sel4_page_sizes[i];
+        if (IS_ALIGNED(vaddr, bits) && end - vaddr >= BIT(bits) &&
+            get_cap(top_level, vaddr + BIT(bits) - PAGE_SIZE_4K) == cap) {
+            return bits;
+        }
+    }
+    return size_bits;
+}
 
+static sel4utils_res_t *find_reserve(sel4utils_alloc_data_t *data, uintptr_t vaddr)
+{
+    sel4utils_res_t *current = data->reservation_root;
+
+    /* the only reservation that can contain vaddr is the one with the highest
+     * start address not above it */
     while (current != NULL) {
-        if (vaddr >= current->start && vaddr < current->end) {
+        if (vaddr < current->start) {
+            current = current->left;
+        } else if (vaddr >= current->end) {
+            current = current->right;
+        } else {
             return current;
         }
-
-        current = current->next;
     }
 
     return NULL;
 }
 
-static void *find_range(sel4utils_alloc_data_t *data, size_t num_pages, size_t size_bits)
+/* Find the first address in [start, end) that is reserved or mapped, or end if
+ * the whole range is available. Tables that are entirely empty are skipped
+ * without looking at their entries */
+static uintptr_t find_unavailable_mid(vspace_mid_level_t *level, int level_num, uintptr_t start, uintptr_t end)
+{
+    while (start < end) {
+        int index = INDEX_FOR_LEVEL(start, level_num);
+        uintptr_t next_start = (start & ALIGN_FOR_LEVEL(level_num)) + BYTES_FOR_LEVEL(level_num);
+        if (next_start > end) {
+            next_start = end;
+        }
+        uintptr_t next_table = level->table[index];
+        if (next_table == RESERVED) {
+            return start;
+        }
+        if (next_table != EMPTY) {
+            if (level_num == 1) {
+                vspace_bottom_level_t *bottom = (vspace_bottom_level_t *) next_table;
+                for (uintptr_t v = start; v < next_start; v += BYTES_FOR_LEVEL(0)) {
+                    if (bottom->cap[INDEX_FOR_LEVEL(v, 0)] != EMPTY) {
+                        return v;
+                    }
+                }
+            } else {
+                uintptr_t found = find_unavailable_mid((vspace_mid_level_t *) next_table, level_num - 1, start, next_start);
+                if (found < next_start) {
+                    return found;
+                }
+            }
+        }
+        start = next_start;
+    }
+    return end;
+}
+
+/* Find the first available address in [start, end), or end if there is none.
+ * Tables that are entirely reserved are skipped without looking at their entries */
+static uintptr_t find_available_mid(vspace_mid_level_t *level, int level_num, uintptr_t start, uintptr_t end)
+{
+    while (start < end) {
+        int index = INDEX_FOR_LEVEL(start, level_num);
+        uintptr_t next_start = (start & ALIGN_FOR_LEVEL(level_num)) + BYTES_FOR_LEVEL(level_num);
+        if (next_start > end) {
+            next_start = end;
+        }
+        uintptr_t next_table = level->table[index];
+        if (next_table == EMPTY) {
+            return start;
+        }
+        if (next_table != RESERVED) {
+            if (level_num == 1) {
+                vspace_bottom_level_t *bottom = (vspace_bottom_level_t *) next_table;
+                for (uintptr_t v = start; v < next_start; v += BYTES_FOR_LEVEL(0)) {
+                    if (bottom->cap[INDEX_FOR_LEVEL(v, 0)] == EMPTY) {
+                        return v;
+                    }
+                }
+            } else {
+                uintptr_t found = find_available_mid((vspace_mid_level_t *) next_table, level_num - 1, start, next_start);
+                if (found < next_start) {
+                    return found;
+                }
+            }
+        }
+        start = next_start;
+    }
+    return end;
+}
+
+static void *find_range_aligned(sel4utils_alloc_data_t *data, uintptr_t bytes, size_t size_bits)
 {
     /* look for a contiguous range that is free.
      * We use first-fit with the optimisation that we store
      * a pointer to the last thing we freed/allocated */
-    size_t contiguous = 0;
     uintptr_t start = ALIGN_UP(data->last_allocated, SIZE_BITS_TO_BYTES(size_bits));
-    uintptr_t current = start;
 
     assert(IS_ALIGNED(start, size_bits));
-    while (contiguous < num_pages) {
-
-        bool available = is_available(data->top_level, current, size_bits);
-        current += SIZE_BITS_TO_BYTES(size_bits);
-
-        if (available) {
-            /* keep going! */
-            contiguous++;
-        } else {
-            /* reset start and try again */
-            start = current;
-            contiguous = 0;
-        }
-
-        if (current >= KERNEL_RESERVED_START) {
+    while (true) {
+        if (start >= KERNEL_RESERVED_START || KERNEL_RESERVED_START - start <= bytes) {
             ZF_LOGE("Out of virtual memory");
             return NULL;
         }
 
+        uintptr_t unavailable = find_unavailable_mid(data->top_level, VSPACE_NUM_LEVELS - 1, start, start + bytes);
+        if (unavailable == start + bytes) {
+            break;
+        }
+
+        /* nothing starting before the next available address can fit, so
+         * skip straight past whatever is in the way */
+        start = find_available_mid(data->top_level, VSPACE_NUM_LEVELS - 1, unavailable, KERNEL_RESERVED_START);
+        start = ALIGN_UP(start, SIZE_BITS_TO_BYTES(size_bits));
     }
 
-    data->last_allocated = current;
+    data->last_allocated = start + bytes;
 
     return (void *) start;
 }
 
+static void *find_range(sel4utils_alloc_data_t *data, size_t num_pages, size_t size_bits)
+{
+    return find_range_aligned(data, num_pages * SIZE_BITS_TO_BYTES(size_bits), size_bits);
+}
+
 static int map_pages_at_vaddr(vspace_t *vspace, seL4_CPtr caps[], uintptr_t cookies[],
                               void *vaddr, size_t num_pages,
                               size_t size_bits, seL4_CapRights_t rights, int cacheable)
@@ -301,33 +476,84 @@ static int new_pages_at_vaddr(vspace_t *vspace, void *vaddr, size_t num_pages, s
                               seL4_CapRights_t rights, int cacheable, bool can_use_dev)
 {
     sel4utils_alloc_data_t *data = get_alloc_data(vspace);
-    int i;
+    uintptr_t start = (uintptr_t) vaddr;
+    uintptr_t end = start + num_pages * BIT(size_bits);
+    uintptr_t v = start;
+    /* largest frames to try for the rest of this request, lowered when there is no
+     * untyped that large. Each request starts again from the largest frames */
+    size_t max_bits = data->promote_pages ? PROMOTION_MAX_BITS : size_bits;
+    /* largest frames to try below blocked_end, where paging structures left behind by
+     * earlier mappings stopped a larger frame from being mapped */
+    size_t blocked_bits = max_bits;
+    uintptr_t blocked_end = start;
     int error = seL4_NoError;
-    void *start_vaddr = vaddr;
 
-    for (i = 0; i < num_pages; i++) {
-        vka_object_t object;
-        if (vka_alloc_frame_maybe_device(data->vka, size_bits, can_use_dev, &object) != 0) {
+    while (v < end) {
+        size_t limit_bits = v < blocked_end ? MIN(blocked_bits, max_bits) : max_bits;
+        size_t frame_bits = promoted_size_bits(v, end, size_bits, limit_bits);
+        if (frame_bits != size_bits) {
+            vka_object_t object;
+            if (vka_alloc_frame_maybe_device(data->vka, frame_bits, can_use_dev, &object) != 0) {
+                /* no untyped this large, try smaller frames instead */
+                max_bits = frame_bits - 1;
+                continue;
+            }
+            error = map_page(vspace, object.cptr, (void *) v, rights, cacheable, frame_bits);
+            if (error != seL4_NoError) {
+                /* paging structures left behind by earlier smaller mappings, such as a page
+                 * table where a 2M frame would go, block the larger frame. Use smaller frames
+                 * until the end of the blocked frame, then try larger ones again */
+                vka_free_object(data->vka, &object);
+                blocked_bits = frame_bits - 1;
+                blocked_end = v + BIT(frame_bits);
+                error = seL4_NoError;
+                continue;
+            }
+            error = update_entries(vspace, v, object.cptr, frame_bits, object.ut);
+            v += BIT(frame_bits);
+            if (error != seL4_NoError) {
+                break;
+            }
+            continue;
+        }
+
+        /* allocate the frames in batches, so that allocators that support it can
+         * create each batch with a single retype */
+        vka_object_t objects[VKA_OBJECT_RANGE_MAX];
+        size_t batch = MIN(pages_before_promotable(v, end, size_bits, limit_bits), VKA_OBJECT_RANGE_MAX);
+        if (v < blocked_end) {
+            batch = MIN(batch, (blocked_end - v) >> size_bits);
+        }
+        size_t j;
+        if (vka_alloc_frames_maybe_device(data->vka, size_bits, batch, can_use_dev, objects) != 0) {
             /* abort! */
-            ZF_LOGE("Failed to allocate page number: %d out of %zu", i, num_pages);
+            ZF_LOGE("Failed to allocate pages %zu to %zu out of %zu", (size_t)((v - start) >> size_bits),
+                    (size_t)((v - start) >> size_bits) + batch, num_pages);
             error = seL4_NotEnoughMemory;
             break;
         }
 
-        error = map_page(vspace, object.cptr, vaddr, rights, cacheable, size_bits);
+        for (j = 0; j < batch; j++) {
+            error = map_page(vspace, objects[j].cptr, (void *) v, rights, cacheable, size_bits);
+            if (error != seL4_NoError) {
+                break;
+            }
+            error = update_entries(vspace, v, objects[j].cptr, size_bits, objects[j].ut);
+            v += BIT(size_bits);
+        }
 
-        if (error == seL4_NoError) {
-            error = update_entries(vspace, (uintptr_t) vaddr, object.cptr, size_bits, object.ut);
-            vaddr = (void *)((uintptr_t) vaddr + (BIT(size_bits)));
-        } else {
-            vka_free_object(data->vka, &object);
+        if (j < batch) {
+            /* free the frames of this batch that were not mapped */
+            for (; j < batch; j++) {
+                vka_free_object(data->vka, &objects[j]);
+            }
             break;
         }
     }
 
-    if (i < num_pages) {
+    if (v < end) {
         /* we failed, clean up successfully allocated pages */
-        sel4utils_unmap_pages(vspace, start_vaddr, i, size_bits, data->vka);
+        sel4utils_unmap_pages(vspace, (void *) start, (v - start) >> size_bits, size_bits, data->vka);
     }
 
     return error;
@@ -447,8 +673,10 @@ void sel4utils_unmap_pages(vspace_t *vspace, void *vaddr, size_t num_pages, size
         vka = data->vka;
     }
 
-    for (int i = 0; i < num_pages; i++) {
+    uintptr_t end = v + num_pages * BIT(size_bits);
+    while (v < end) {
         seL4_CPtr cap = get_cap(data->top_level, v);
+        size_t frame_bits = mapped_size_bits(data->top_level, v, end, cap, size_bits);
 
         /* unmap */
         if (cap != 0) {
@@ -464,20 +692,20 @@ void sel4utils_unmap_pages(vspace_t *vspace, void *vaddr, size_t num_pages, size
             vka_cnode_delete(&path);
             vka_cspace_free(vka, cap);
             if (sel4utils_get_cookie(vspace, vaddr)) {
-                vka_utspace_free(vka, kobject_get_type(KOBJECT_FRAME, size_bits),
-                                 size_bits, sel4utils_get_cookie(vspace, vaddr));
+                vka_utspace_free(vka, kobject_get_type(KOBJECT_FRAME, frame_bits),
+                                 frame_bits, sel4utils_get_cookie(vspace, vaddr));
             }
         }
 
         if (reserve == NULL) {
-            clear_entries(vspace, v, size_bits);
+            clear_entries(vspace, v, frame_bits);
         } else {
-            reserve_entries(vspace, v, size_bits);
+            reserve_entries(vspace, v, frame_bits);
         }
         assert(get_cap(data->top_level, v) != cap);
         assert(get_cookie(data->top_level, v) == 0);
 
-        v += (BIT(size_bits));
+        v += (BIT(frame_bits));
         vaddr = (void *) v;
     }
 }
@@ -505,7 +733,10 @@ void *sel4utils_new_pages(vspace_t *vspace, seL4_CapRights_t rights,
 
     assert(num_pages > 0);
 
-    ret_vaddr = find_range(data, num_pages, size_bits);
+    /* when promoting, align the range to the largest frame that fits in it */
+    size_t align_bits = promoted_size_bits(0, num_pages * BIT(size_bits), size_bits,
+                                           data->promote_pages ? PROMOTION_MAX_BITS : size_bits);
+    ret_vaddr = find_range_aligned(data, num_pages * BIT(size_bits), align_bits);
     if (ret_vaddr == NULL) {
         return NULL;
     }
@@ -700,15 +931,16 @@ int sel4utils_move_resize_reservation(vspace_t *vspace, reservation_t reservatio
 
     bool need_reinsert = false;
     if (res->start != new_start) {
+        /* the tree is ordered by the old start address, so remove it before changing it */
+        remove_reservation(data, res);
         need_reinsert = true;
     }
 
     res->start = new_start;
     res->end = new_end;
 
-    /* We may need to re-insert the reservation into the list to keep it sorted by start address. */
+    /* We may need to re-insert the reservation into the tree to keep it sorted by start address. */
     if (need_reinsert) {
-        remove_reservation(data, res);
         insert_reservation(data, res);
     }
 
@@ -799,8 +1031,8 @@ void sel4utils_tear_down(vspace_t *vspace, vka_t *vka)
     }
 
     /* free all the reservations */
-    while (data->reservation_head != NULL) {
-        reservation_t res = { .res = data->reservation_head };
+    while (data->reservation_root != NULL) {
+        reservation_t res = { .res = data->reservation_root };
         sel4utils_free_reservation(vspace, res);
     }
 
@@ -885,3 +1117,19 @@ uintptr_t sel4utils_get_paddr(vspace_t *vspace, void *vaddr, seL4_Word type, seL
     return vka_utspace_paddr(vka, vspace_get_cookie(vspace, vaddr), type, size_bits);
 
 }
+
+void sel4utils_set_page_promotion(vspace_t *vspace, bool promote)
+{
+    get_alloc_data(vspace)->promote_pages = promote;
+}
+
+size_t sel4utils_get_num_mappings(vspace_t *vspace, size_t size_bits)
+{
+    sel4utils_alloc_data_t *data = get_alloc_data(vspace);
+    for (int i = 0; i < SEL4_NUM_PAGE_SIZES; i++) {
+        if (sel4_page_sizes[i] == size_bits) {
+            return data->num_mappings[i];
+        }
+    }
+    return 0;
+}
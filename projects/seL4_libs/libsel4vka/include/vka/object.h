@@ -121,6 +121,104 @@ static inline uintptr_t vka_object_paddr(vka_t *vka, vka_object_t *object)
     return vka_utspace_paddr(vka, object->ut, object->type, object->size_bits);
 }
 
+/* Largest number of objects created by a single retype in vka_alloc_objects_maybe_dev.
+ * This is kept below the kernel's fan out limit so that callers can batch allocations
+ * with arrays on the stack */
+#if seL4_UntypedRetypeMaxObjects < 32
+#define VKA_OBJECT_RANGE_MAX seL4_UntypedRetypeMaxObjects
+#else
+#define VKA_OBJECT_RANGE_MAX 32
+#endif
+
+/*
+ * Allocate num objects with a single Untyped_Retype into a contiguous range of cslots.
+ * Fails without allocating anything if the vka does not support this
+ */
+static inline int vka_alloc_object_range(vka_t *vka, seL4_Word type, seL4_Word size_bits, size_t num,
+                                         bool can_use_dev, vka_object_t *objects)
+{
+    seL4_Word cookies[VKA_OBJECT_RANGE_MAX];
+    seL4_CPtr first;
+    cspacepath_t path;
+    int error;
+
+    if (num == 0 || num > VKA_OBJECT_RANGE_MAX || !vka->cspace_alloc_range || !vka->utspace_alloc_range) {
+        return -1;
+    }
+
+    error = vka_cspace_alloc_range(vka, num, &first);
+    if (error) {
+        return error;
+    }
+
+    vka_cspace_make_path(vka, first, &path);
+    path.window = num;
+    error = vka_utspace_alloc_range(vka, &path, type, size_bits, num, can_use_dev, cookies);
+    if (error) {
+        for (size_t i = 0; i < num; i++) {
+            vka_cspace_free(vka, first + i);
+        }
+        return error;
+    }
+
+    for (size_t i = 0; i < num; i++) {
+        objects[i] = (vka_object_t) {
+            .cptr = first + i,
+            .ut = cookies[i],
+            .type = type,
+            .size_bits = size_bits
+        };
+    }
+    return 0;
+}
+
+/*
+ * Allocate num objects of the same type and size. Where the vka supports it the objects
+ * are created in batches, with one Untyped_Retype per batch, otherwise they are allocated
+ * one at a time. Either way every object is freed individually with vka_free_object.
+ * On failure no objects are left allocated.
+ */
+static inline int vka_alloc_objects_maybe_dev(vka_t *vka, seL4_Word type, seL4_Word size_bits, size_t num,
+                                              bool can_use_dev, vka_object_t *objects)
+{
+    size_t max_batch = vka->cspace_alloc_range && vka->utspace_alloc_range ? VKA_OBJECT_RANGE_MAX : 1;
+    size_t done = 0;
+    int error = 0;
+
+    while (done < num) {
+        if (max_batch > 1 && num - done > 1) {
+            /* batches are powers of two so that no part of the untyped they are
+             * created from is left unused */
+            size_t batch = BIT(LOG_BASE_2(MIN(num - done, max_batch)));
+            if (vka_alloc_object_range(vka, type, size_bits, batch, can_use_dev, &objects[done]) == 0) {
+                done += batch;
+                continue;
+            }
+            /* don't keep retrying a batch size the allocator cannot satisfy */
+            max_batch = batch / 2;
+            continue;
+        }
+        error = vka_alloc_object_at_maybe_dev(vka, type, size_bits, VKA_NO_PADDR, can_use_dev, &objects[done]);
+        if (error) {
+            break;
+        }
+        done++;
+    }
+
+    if (error) {
+        while (done > 0) {
+            vka_free_object(vka, &objects[--done]);
+        }
+    }
+    return error;
+}
+
+static inline int vka_alloc_objects(vka_t *vka, seL4_Word type, seL4_Word size_bits, size_t num,
+                                    vka_object_t *objects)
+{
+    return vka_alloc_objects_maybe_dev(vka, type, size_bits, num, false, objects);
+}
+
 /* Convenience wrappers for allocating objects */
 static inline int vka_alloc_untyped(vka_t *vka, uint32_t size_bits, vka_object_t *result)
 {
@@ -209,6 +307,13 @@ static inline int vka_alloc_frame_maybe_device(vka_t *vka, uint32_t size_bits, b
                                          size_bits, VKA_NO_PADDR, can_use_dev, result);
 }
 
+static inline int vka_alloc_frames_maybe_device(vka_t *vka, uint32_t size_bits, size_t num, bool can_use_dev,
+                                                vka_object_t *objects)
+{
+    return vka_alloc_objects_maybe_dev(vka, kobject_get_type(KOBJECT_FRAME, size_bits),
+                                       size_bits, num, can_use_dev, objects);
+}
+
 static inline int vka_alloc_frame_at(vka_t *vka, uint32_t size_bits, uintptr_t paddr,
                                      vka_object_t *result)
 {
@@ -111,6 +111,36 @@ typedef uintptr_t (*vka_utspace_paddr_fn)(void *data, seL4_Word target, seL4_Wor
 
 #define VKA_NO_PADDR 1
 
+/**
+ * Allocate a range of contiguous slots in a single cnode, such that they can all be
+ * filled by one Untyped_Retype. The slots are res, res + 1, ..., res + num - 1 and are
+ * freed individually with the cspace free function
+ *
+ * @param data cookie for the underlying allocator
+ * @param num the number of slots to allocate
+ * @param res pointer to a cptr to store the first allocated slot
+ * @return 0 on success
+ */
+typedef int (*vka_cspace_alloc_range_fn)(void *data, size_t num, seL4_CPtr *res);
+
+/**
+ * Allocate a portion of an untyped into num objects of the same type, using a single
+ * Untyped_Retype. Each object has its own cookie and is freed individually with the
+ * utspace free function
+ *
+ * @param data cookie for the underlying allocator
+ * @param dest path to the first of num contiguous empty cslots, as allocated by the
+ *             cspace alloc range function
+ * @param type the seL4 object type to allocate (as passed to Untyped_Retype)
+ * @param size_bits the size of each object to allocate (as passed to Untyped_Retype)
+ * @param num the number of objects to allocate
+ * @param can_use_dev whether the allocator can use device untyped instead of regular untyped
+ * @param res array of num locations to store the cookies representing each allocation
+ * @return 0 on success
+ */
+typedef int (*vka_utspace_alloc_range_fn)(void *data, const cspacepath_t *dest, seL4_Word type, seL4_Word size_bits,
+                                          size_t num, bool can_use_dev, seL4_Word *res);
+
 /*
  * Generic Virtual Kernel Allocator (VKA) data structure.
  *
@@ -131,6 +161,9 @@ typedef struct vka {
     vka_cspace_free_fn cspace_free;
     vka_utspace_free_fn utspace_free;
     vka_utspace_paddr_fn utspace_paddr;
+    /* Optional, allocators that cannot create objects in bulk leave these NULL */
+    vka_cspace_alloc_range_fn cspace_alloc_range;
+    vka_utspace_alloc_range_fn utspace_alloc_range;
 } vka_t;
 
 static inline int vka_cspace_alloc(vka_t *vka, seL4_CPtr *res)
@@ -186,6 +219,26 @@ static inline int vka_cspace_alloc_path(vka_t *vka, cspacepath_t *res)
     return error;
 }
 
+static inline int vka_cspace_alloc_range(vka_t *vka, size_t num, seL4_CPtr *res)
+{
+    if (!vka) {
+        ZF_LOGE("vka is NULL");
+        return -1;
+    }
+
+    if (!res) {
+        ZF_LOGE("res is NULL");
+        return -1;
+    }
+
+    if (!vka->cspace_alloc_range) {
+        ZF_LOGE("Not implemented");
+        return -1;
+    }
+
+    return vka->cspace_alloc_range(vka->data, num, res);
+}
+
 static inline void vka_cspace_free(vka_t *vka, seL4_CPtr slot)
 {
 #ifdef CONFIG_DEBUG_BUILD
@@ -269,6 +322,27 @@ static inline int vka_utspace_alloc_at(vka_t *vka, const cspacepath_t *dest, seL
     return vka->utspace_alloc_at(vka->data, dest, type, size_bits, paddr, cookie);
 }
 
+static inline int vka_utspace_alloc_range(vka_t *vka, const cspacepath_t *dest, seL4_Word type,
+                                          seL4_Word size_bits, size_t num, bool can_use_dev, seL4_Word *res)
+{
+    if (!vka) {
+        ZF_LOGE("vka is NULL");
+        return -1;
+    }
+
+    if (!res) {
+        ZF_LOGE("res is NULL");
+        return -1;
+    }
+
+    if (!vka->utspace_alloc_range) {
+        ZF_LOGE("Not implemented");
+        return -1;
+    }
+
+    return vka->utspace_alloc_range(vka->data, dest, type, size_bits, num, can_use_dev, res);
+}
+
 static inline void vka_utspace_free(vka_t *vka, seL4_Word type, seL4_Word size_bits, seL4_Word target)
 {
     if (!vka) {
@@ -329,6 +329,9 @@ int vka_init_debugvka(vka_t *vka, vka_t *tracee)
     vka->utspace_alloc_at = utspace_alloc_at;
     vka->cspace_free = cspace_free;
     vka->utspace_free = utspace_free;
+    /* allocate objects one at a time so that each one is tracked */
+    vka->cspace_alloc_range = NULL;
+    vka->utspace_alloc_range = NULL;
 
     return 0;
 
@@ -20,6 +20,7 @@ typedef struct vm vm_t;
 typedef struct vm_vcpu vm_vcpu_t;
 typedef struct vm_mem vm_mem_t;
 typedef struct vm_ram_region vm_ram_region_t;
+typedef struct vm_ram_mapping vm_ram_mapping_t;
 typedef struct vm_run vm_run_t;
 typedef struct vm_arch vm_arch_t;
 
@@ -66,6 +67,20 @@ struct vm_ram_region {
     int allocated;
 };
 
+/***
+ * @struct vm_ram_mapping
+ * Structure representing a persistent mapping of a registered RAM region into the VMM's vspace. These are only
+ * created when 'LibSel4VMPersistentRamMap' is enabled
+ * @param {uintptr_t} start     Guest physical start address of the mapped region
+ * @param {size_t} size         Size of the mapped region in bytes
+ * @param {void *} vmm_vaddr    Virtual address in the VMM's vspace the region is mapped at
+ */
+struct vm_ram_mapping {
+    uintptr_t start;
+    size_t size;
+    void *vmm_vaddr;
+};
+
 /***
  * @struct vm_mem
  * Structure representing VM memory managment
@@ -74,6 +89,8 @@ struct vm_ram_region {
  * @param {vspace_t} vmm_vspace                                             Hosts/VMMs vspace
  * @param {int} num_ram_regions                                             Total number of registered `vm_ram_regions`
  * @param {struct vm_ram_region *}                                          Set of registered `vm_ram_regions`
+ * @param {int} num_ram_mappings                                            Total number of persistent `vm_ram_mappings`
+ * @param {struct vm_ram_mapping *}                                         Set of persistent `vm_ram_mappings`
  * @param {vm_memory_reservation_cookie_t *}                                Initialised instance of vm memory interface
  * @param {unhandled_mem_fault_callback_fn}  unhandled_mem_fault_handler    Registered callback for unhandled memory faults
  * @param {void *} unhandled_mem_fault_cookie                               User data passed onto unhandled mem fault callback
@@ -90,6 +107,11 @@ struct vm_mem {
      * This is memory that we will specifically give the guest as actual RAM */
     int num_ram_regions;
     struct vm_ram_region *ram_regions;
+    /* Registered ram regions that are permanently mapped into the vmm vspace.
+     * These are kept separately as ram regions are split and collapsed as they
+     * are allocated, whereas a mapping lives as long as the vm */
+    int num_ram_mappings;
+    struct vm_ram_mapping *ram_mappings;
     /* Memory reservations */
     vm_memory_reservation_cookie_t *reservation_cookie;
     unhandled_mem_fault_callback_fn unhandled_mem_fault_handler;
@@ -36,6 +36,8 @@ int vm_init(vm_t *vm, vka_t *vka, simple_t *host_simple, vspace_t host_vspace,
     /* Initialise ram region */
     vm->mem.num_ram_regions = 0;
     vm->mem.ram_regions = malloc(0);
+    vm->mem.num_ram_mappings = 0;
+    vm->mem.ram_mappings = NULL;
     assert(vm->vcpus);
     /* Initialise vm memory management interface */
     err = vm_memory_init(vm);
@@ -6,10 +6,12 @@
 
 #include <string.h>
 #include <stdio.h>
+#include <inttypes.h>
 #include <stdlib.h>
 
 #include <sel4/sel4.h>
 
+#include <sel4vm/gen_config.h>
 #include <sel4vm/guest_vm.h>
 #include <sel4vm/guest_ram.h>
 #include <sel4vm/guest_memory.h>
@@ -116,6 +118,58 @@ static bool is_ram_region(vm_t *vm, uintptr_t addr, size_t size)
     return false;
 }
 
+static vm_ram_mapping_t *find_ram_mapping(vm_t *vm, uintptr_t addr, size_t size)
+{
+    vm_mem_t *guest_memory = &vm->mem;
+    for (int i = 0; i < guest_memory->num_ram_mappings; i++) {
+        vm_ram_mapping_t *mapping = &guest_memory->ram_mappings[i];
+        if (mapping->start <= addr && mapping->start + mapping->size >= addr + size) {
+            return mapping;
+        }
+    }
+    return NULL;
+}
+
+static int map_ram_persistent(vm_t *vm, uintptr_t start, size_t bytes)
+{
+    vm_mem_t *guest_memory = &vm->mem;
+    vm_ram_mapping_t *extended_mappings = realloc(guest_memory->ram_mappings,
+                                                  sizeof(vm_ram_mapping_t) * (guest_memory->num_ram_mappings + 1));
+    if (extended_mappings == NULL) {
+        return -1;
+    }
+    guest_memory->ram_mappings = extended_mappings;
+    /* Both guest RAM registration paths allocate their frames at 4K, so the region
+     * can be shared into the vmm vspace in a single reservation */
+    void *vmm_vaddr = vspace_share_mem(&guest_memory->vm_vspace, &guest_memory->vmm_vspace, (void *)start,
+                                       bytes / PAGE_SIZE_4K, seL4_PageBits, seL4_AllRights, 1);
+    if (vmm_vaddr == NULL) {
+        return -1;
+    }
+    vm_ram_mapping_t *mapping = &guest_memory->ram_mappings[guest_memory->num_ram_mappings];
+    mapping->start = start;
+    mapping->size = bytes;
+    mapping->vmm_vaddr = vmm_vaddr;
+    guest_memory->num_ram_mappings++;
+    return 0;
+}
+
+static void register_ram_persistent(vm_t *vm, uintptr_t start, size_t bytes)
+{
+    if (!config_set(CONFIG_LIB_SEL4VM_PERSISTENT_RAM_MAP)) {
+        return;
+    }
+    if (!IS_ALIGNED_4K(start) || !IS_ALIGNED_4K(bytes)) {
+        ZF_LOGW("Ram region 0x%"PRIxPTR" is not page aligned, touches will map on demand", start);
+        return;
+    }
+    /* Failing to create the mapping is not fatal, touches on this region just fall
+     * back to mapping each page on demand */
+    if (map_ram_persistent(vm, start, bytes)) {
+        ZF_LOGW("Failed to persistently map ram region 0x%"PRIxPTR", touches will map on demand", start);
+    }
+}
+
 static memory_fault_result_t default_ram_fault_callback(vm_t *vm, vm_vcpu_t *vcpu, uintptr_t fault_addr,
                                                         size_t fault_length, void *cookie)
 {
@@ -157,6 +211,21 @@ int vm_ram_touch(vm_t *vm, uintptr_t addr, size_t size, ram_touch_callback_fn to
         ZF_LOGE("Failed to touch ram region: Not registered RAM region");
         return -1;
     }
+    vm_ram_mapping_t *mapping = find_ram_mapping(vm, addr, size);
+    if (mapping) {
+        /* The region is already mapped into the vmm, we only need to translate the
+         * address. The callback is still invoked page by page to preserve the
+         * semantics of the non persistent path */
+        for (current_addr = addr; current_addr < end_addr; current_addr = next_addr) {
+            next_addr = MIN(end_addr, PAGE_ALIGN_4K(current_addr) + PAGE_SIZE_4K);
+            void *vmm_vaddr = (void *)((uintptr_t)mapping->vmm_vaddr + (current_addr - mapping->start));
+            int result = touch_callback(vm, current_addr, vmm_vaddr, next_addr - current_addr, current_addr - addr, cookie);
+            if (result) {
+                return result;
+            }
+        }
+        return 0;
+    }
     access_cookie.touch_fn = touch_callback;
     access_cookie.data = cookie;
     access_cookie.vm = vm;
@@ -340,6 +409,7 @@ uintptr_t vm_ram_register(vm_t *vm, size_t bytes)
         vm_free_reserved_memory(vm, ram_reservation);
         return 0;
     }
+    register_ram_persistent(vm, base_addr, bytes);
 
     return base_addr;
 }
@@ -366,6 +436,7 @@ int vm_ram_register_at(vm_t *vm, uintptr_t start, size_t bytes, bool untyped)
         vm_free_reserved_memory(vm, ram_reservation);
         return 0;
     }
+    register_ram_persistent(vm, start, bytes);
     return 0;
 }
 
@@ -57,6 +57,13 @@ virtio_emul_t *virtio_emul_init(ps_io_ops_t io_ops, int queue_size, vm_t *vm, vo
 
 void ring_used_add(virtio_emul_t *emul, struct vring *vring, struct vring_used_elem elem);
 
+/* Write a used element offset entries past the current used index without
+ * exposing it to the guest. ring_used_publish then exposes count elements at
+ * once, after everything written for them. */
+void ring_used_write(virtio_emul_t *emul, struct vring *vring, uint16_t offset, struct vring_used_elem elem);
+
+void ring_used_publish(virtio_emul_t *emul, struct vring *vring, uint16_t count);
+
 struct vring_desc ring_desc(virtio_emul_t *emul, struct vring *vring, uint16_t idx);
 
 uint16_t ring_avail_idx(virtio_emul_t *emul, struct vring *vring);
@@ -65,4 +72,12 @@ uint16_t ring_avail(virtio_emul_t *emul, struct vring *vring, uint16_t idx);
 
 void *net_virtio_emul_init(virtio_emul_t *emul, ps_io_ops_t io_ops, ethif_driver_init driver, void *config);
 
+/* Batch guest interrupts raised by a net emulation. Between begin and end any
+ * rx or tx completions only mark an interrupt as pending, and the guest is
+ * interrupted once when the outermost batch ends. Backends should wrap bursts
+ * of rx_complete callbacks with these. */
+void net_virtio_emul_batch_begin(virtio_emul_t *emul);
+
+void net_virtio_emul_batch_end(virtio_emul_t *emul);
+
 void *console_virtio_emul_init(virtio_emul_t *emul, ps_io_ops_t io_ops, console_driver_init driver, void *config);
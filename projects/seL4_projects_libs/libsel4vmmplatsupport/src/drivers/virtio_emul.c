@@ -5,6 +5,7 @@
  */
 
 #include <sel4vmmplatsupport/drivers/virtio_pci_emul.h>
+#include <utils/fence.h>
 
 #include "virtio_emul_helpers.h"
 
@@ -29,15 +30,31 @@ struct vring_desc ring_desc(virtio_emul_t *emul, struct vring *vring, uint16_t i
     return desc;
 }
 
-void ring_used_add(virtio_emul_t *emul, struct vring *vring, struct vring_used_elem elem)
+void ring_used_write(virtio_emul_t *emul, struct vring *vring, uint16_t offset, struct vring_used_elem elem)
 {
     uint16_t guest_idx;
     vm_guest_read_mem(emul->vm, &guest_idx, (uintptr_t)&vring->used->idx, sizeof(vring->used->idx));
+    guest_idx += offset;
     vm_guest_write_mem(emul->vm, &elem, (uintptr_t)&vring->used->ring[guest_idx % vring->num], sizeof(elem));
-    guest_idx++;
+}
+
+void ring_used_publish(virtio_emul_t *emul, struct vring *vring, uint16_t count)
+{
+    uint16_t guest_idx;
+    vm_guest_read_mem(emul->vm, &guest_idx, (uintptr_t)&vring->used->idx, sizeof(vring->used->idx));
+    guest_idx += count;
+    /* the guest may be polling the used ring, so everything it will read for
+     * these elements has to be visible before the index that exposes them */
+    THREAD_MEMORY_RELEASE();
     vm_guest_write_mem(emul->vm, &guest_idx, (uintptr_t)&vring->used->idx, sizeof(vring->used->idx));
 }
 
+void ring_used_add(virtio_emul_t *emul, struct vring *vring, struct vring_used_elem elem)
+{
+    ring_used_write(emul, vring, 0, elem);
+    ring_used_publish(emul, vring, 1);
+}
+
 static int emul_io_in(virtio_emul_t *emul, unsigned int offset, unsigned int size, unsigned int *result)
 {
     if (emul->device_io_in(emul, offset, size, result)) {
@@ -54,7 +54,8 @@ static void emul_raw_handle_irq(struct eth_driver *driver, int irq)
 
 static void emul_raw_poll(struct eth_driver *driver)
 {
-    ZF_LOGF("not implemented");
+    /* Called at the end of each batch of transmits. Backends that complete
+     * transmits immediately have nothing to do */
 }
 
 static void emul_low_level_init(struct eth_driver *driver, uint8_t *mac, int *mtu)
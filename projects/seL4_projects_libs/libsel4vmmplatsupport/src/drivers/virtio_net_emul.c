@@ -6,21 +6,162 @@
 
 #include <sel4vmmplatsupport/drivers/virtio_pci_emul.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "virtio_emul_helpers.h"
+#include "virtio_net_offload.h"
 
 #define BUF_SIZE 2048
+/* Number of preallocated dma buffers shared between tx and rx */
+#define BUF_POOL_SIZE 256
+/* Buffers that transmits leave in the pool, so that a burst of guest
+ * transmits cannot starve receive */
+#define BUF_POOL_RX_RESERVED 32
+/* Largest frame the guest may hand us with a segmentation offload */
+#define TSO_BUF_SIZE (64 * 1024 + 64)
+/* Largest vlan ethernet, ipv4 and tcp headers of a frame being segmented */
+#define TSO_HDRS_MAX_LEN (18 + 60 + 60)
+
+/* Features offered to the guest. The ethif driver interface has no way to
+ * offload checksums or segmentation to the backend, so the checksum and TSO
+ * features are always completed in software before a frame is transmitted.
+ * Frames delivered to the guest never require GUEST_CSUM or GUEST_TSO4 */
+#define NET_HOST_FEATURES (BIT(VIRTIO_NET_F_MAC) | BIT(VIRTIO_NET_F_MRG_RXBUF) | \
+                           BIT(VIRTIO_NET_F_CSUM) | BIT(VIRTIO_NET_F_GUEST_CSUM) | \
+                           BIT(VIRTIO_NET_F_HOST_TSO4) | BIT(VIRTIO_NET_F_GUEST_TSO4))
+
+typedef struct emul_buf {
+    /* dma buffer, allocated and pinned once at init */
+    void *vaddr;
+    uintptr_t phys;
+    /* head of the guest descriptor chain while the buffer is used for tx */
+    uint16_t desc_head;
+    /* a guest frame segmented in software is sent in several buffers. the
+     * first buffer tracks how many are outstanding and the others point to it */
+    struct emul_buf *lead;
+    int outstanding;
+    struct emul_buf *next;
+} emul_buf_t;
 
 typedef struct ethif_virtio_emul_internal {
     struct eth_driver driver;
     uint8_t mac[6];
     ps_dma_man_t dma_man;
+    /* buffer pool. buffers double as the cookies given to the driver */
+    emul_buf_t bufs[BUF_POOL_SIZE];
+    emul_buf_t *free_bufs;
+    int num_free_bufs;
+    /* number of buffers allocated, and how many of them are kept free for rx */
+    int num_bufs;
+    int rx_reserved;
+    /* features accepted by the guest */
+    uint32_t features;
+    /* staging buffer for frames that need segmenting */
+    uint8_t *tso_buf;
+    /* guest interrupts are deferred whilst a batch is in progress */
+    int batch_depth;
+    bool irq_pending;
 } ethif_internal_t;
 
-typedef struct emul_tx_cookie {
-    uint16_t desc_head;
-    void *vaddr;
-} emul_tx_cookie_t;
+static emul_buf_t *buf_pool_get(ethif_internal_t *net)
+{
+    emul_buf_t *buf = net->free_bufs;
+    if (buf) {
+        net->free_bufs = buf->next;
+        net->num_free_bufs--;
+    }
+    return buf;
+}
+
+static void buf_pool_put(ethif_internal_t *net, emul_buf_t *buf)
+{
+    buf->next = net->free_bufs;
+    net->free_bufs = buf;
+    net->num_free_bufs++;
+}
+
+/* Number of buffers that transmits may take from the pool */
+static int buf_pool_tx_avail(ethif_internal_t *net)
+{
+    return MAX(net->num_free_bufs - net->rx_reserved, 0);
+}
+
+static emul_buf_t *buf_pool_get_tx(ethif_internal_t *net)
+{
+    if (buf_pool_tx_avail(net) == 0) {
+        return NULL;
+    }
+    return buf_pool_get(net);
+}
+
+static int buf_pool_init(ethif_internal_t *net)
+{
+    int num_bufs = 0;
+    net->free_bufs = NULL;
+    net->num_free_bufs = 0;
+    for (int i = 0; i < BUF_POOL_SIZE; i++) {
+        emul_buf_t *buf = &net->bufs[i];
+        buf->vaddr = ps_dma_alloc(&net->dma_man, BUF_SIZE, net->driver.dma_alignment, 1, PS_MEM_NORMAL);
+        if (!buf->vaddr) {
+            break;
+        }
+        buf->phys = ps_dma_pin(&net->dma_man, buf->vaddr, BUF_SIZE);
+        assert(buf->phys);
+        buf_pool_put(net, buf);
+        num_bufs++;
+    }
+    if (num_bufs == 0) {
+        ZF_LOGE("Failed to allocate any dma buffers");
+        return -1;
+    }
+    if (num_bufs < BUF_POOL_SIZE) {
+        ZF_LOGW("Only allocated %d of %d dma buffers", num_bufs, BUF_POOL_SIZE);
+    }
+    net->num_bufs = num_bufs;
+    net->rx_reserved = MIN(BUF_POOL_RX_RESERVED, num_bufs / 2);
+    return 0;
+}
+
+static bool net_has_feature(ethif_internal_t *net, int feature)
+{
+    return !!(net->features & BIT(feature));
+}
+
+/* Legacy devices use the larger header in both directions once mergeable
+ * receive buffers are negotiated */
+static size_t net_hdr_len(ethif_internal_t *net)
+{
+    if (net_has_feature(net, VIRTIO_NET_F_MRG_RXBUF)) {
+        return sizeof(struct virtio_net_hdr_mrg_rxbuf);
+    }
+    return sizeof(struct virtio_net_hdr);
+}
+
+static void emul_signal_guest(ethif_internal_t *net)
+{
+    if (net->batch_depth > 0) {
+        net->irq_pending = true;
+    } else {
+        net->driver.i_fn.raw_handleIRQ(&net->driver, 0);
+    }
+}
+
+void net_virtio_emul_batch_begin(virtio_emul_t *emul)
+{
+    ethif_internal_t *net = (ethif_internal_t *)emul->internal;
+    net->batch_depth++;
+}
+
+void net_virtio_emul_batch_end(virtio_emul_t *emul)
+{
+    ethif_internal_t *net = (ethif_internal_t *)emul->internal;
+    assert(net->batch_depth > 0);
+    net->batch_depth--;
+    if (net->batch_depth == 0 && net->irq_pending) {
+        net->irq_pending = false;
+        net->driver.i_fn.raw_handleIRQ(&net->driver, 0);
+    }
+}
 
 static uintptr_t emul_allocate_rx_buf(void *iface, size_t buf_size, void **cookie)
 {
@@ -29,13 +170,12 @@ static uintptr_t emul_allocate_rx_buf(void *iface, size_t buf_size, void **cooki
     if (buf_size > BUF_SIZE) {
         return 0;
     }
-    void *vaddr = ps_dma_alloc(&net->dma_man, BUF_SIZE, net->driver.dma_alignment, 1, PS_MEM_NORMAL);
-    if (!vaddr) {
+    emul_buf_t *buf = buf_pool_get(net);
+    if (!buf) {
         return 0;
     }
-    uintptr_t phys = ps_dma_pin(&net->dma_man, vaddr, BUF_SIZE);
-    *cookie = vaddr;
-    return phys;
+    *cookie = buf;
+    return buf->phys;
 }
 
 static void emul_rx_complete(void *iface, unsigned int num_bufs, void **cookies, unsigned int *lens)
@@ -45,77 +185,117 @@ static void emul_rx_complete(void *iface, unsigned int num_bufs, void **cookies,
     vqueue_t *vq = &emul->virtq;
     int i;
     struct vring *vring = &vq->vring[RX_QUEUE];
+    bool mrg_rxbuf = net_has_feature(net, VIRTIO_NET_F_MRG_RXBUF);
+    size_t hdr_len = net_hdr_len(net);
+
+    /* backends that fail to fill a buffer after allocating it hand it back as
+     * an empty frame, which is not delivered to the guest */
+    unsigned int frame_len = 0;
+    for (i = 0; i < num_bufs; i++) {
+        frame_len += lens[i];
+    }
 
     /* grab the next receive chain */
-    struct virtio_net_hdr virtio_hdr;
+    struct virtio_net_hdr_mrg_rxbuf virtio_hdr;
     memset(&virtio_hdr, 0, sizeof(virtio_hdr));
+    virtio_hdr.num_buffers = 1;
     uint16_t guest_idx = ring_avail_idx(emul, vring);
     uint16_t idx = vq->last_idx[RX_QUEUE];
-    if (idx != guest_idx) {
-        /* total length of the written packet so far */
-        size_t tot_written = 0;
+    if (frame_len > 0 && idx != guest_idx) {
+        /* length written to the current descriptor chain */
+        size_t chain_written = 0;
         /* amount of the current descriptor written */
         size_t desc_written = 0;
         /* how much we have written of the current buffer */
         size_t buf_written = 0;
-        /* the current buffer. -1 indicates the virtio net buffer */
+        /* the current buffer. -1 indicates the virtio net header */
         int current_buf = -1;
         uint16_t desc_head = ring_avail(emul, vring, idx);
         /* start walking the descriptors */
-        struct vring_desc desc;
+        struct vring_desc desc = ring_desc(emul, vring, desc_head);
+        /* guest addresses of the bytes of num_buffers, which the header may
+         * split across descriptors */
+        uintptr_t num_buffers_addr[sizeof(virtio_hdr.num_buffers)] = {0};
+        /* number of chains used by this frame */
+        uint16_t chains = 0;
         uint16_t desc_idx = desc_head;
-        do {
-            desc = ring_desc(emul, vring, desc_idx);
+        while (true) {
             /* determine how much we can copy */
             uint32_t copy;
             void *buf_base = NULL;
             if (current_buf == -1) {
-                copy = sizeof(struct virtio_net_hdr) - buf_written;
+                copy = hdr_len - buf_written;
                 buf_base = &virtio_hdr;
             } else {
                 copy = lens[current_buf] - buf_written;
-                buf_base = cookies[current_buf];
+                buf_base = ((emul_buf_t *)cookies[current_buf])->vaddr;
             }
             copy = MIN(copy, desc.len - desc_written);
             vm_guest_write_mem(emul->vm, buf_base + buf_written, (uintptr_t)desc.addr + desc_written, copy);
+            if (current_buf == -1 && mrg_rxbuf) {
+                for (size_t b = 0; b < sizeof(virtio_hdr.num_buffers); b++) {
+                    size_t off = offsetof(struct virtio_net_hdr_mrg_rxbuf, num_buffers) + b;
+                    if (off >= buf_written && off < buf_written + copy) {
+                        num_buffers_addr[b] = (uintptr_t)desc.addr + desc_written + off - buf_written;
+                    }
+                }
+            }
             /* update amounts */
-            tot_written += copy;
+            chain_written += copy;
             desc_written += copy;
             buf_written += copy;
+            /* see if we have finished the current buffer */
+            if (buf_written == (current_buf == -1 ? hdr_len : lens[current_buf])) {
+                current_buf++;
+                buf_written = 0;
+            }
+            if (current_buf >= (int)num_bufs) {
+                break;
+            }
             /* see what's gone over */
             if (desc_written == desc.len) {
-                if (!desc.flags & VRING_DESC_F_NEXT) {
+                if (desc.flags & VRING_DESC_F_NEXT) {
+                    desc_idx = desc.next;
+                } else if (mrg_rxbuf && (uint16_t)(idx + 1) != guest_idx) {
+                    /* continue the packet in the next available chain */
+                    struct vring_used_elem used_elem = {desc_head, chain_written};
+                    ring_used_write(emul, vring, chains++, used_elem);
+                    idx++;
+                    virtio_hdr.num_buffers++;
+                    desc_head = ring_avail(emul, vring, idx);
+                    desc_idx = desc_head;
+                    chain_written = 0;
+                } else {
                     /* descriptor chain is too short to hold the whole packet.
                      * just truncate */
                     break;
                 }
-                desc_idx = desc.next;
+                desc = ring_desc(emul, vring, desc_idx);
                 desc_written = 0;
             }
-            if (current_buf == -1) {
-                if (buf_written == sizeof(struct virtio_net_hdr)) {
-                    current_buf++;
-                    buf_written = 0;
-                }
-            } else {
-                if (buf_written == lens[current_buf]) {
-                    current_buf++;
-                    buf_written = 0;
+        }
+        /* now put it in the used ring */
+        struct vring_used_elem used_elem = {desc_head, chain_written};
+        ring_used_write(emul, vring, chains++, used_elem);
+        idx++;
+        if (virtio_hdr.num_buffers > 1) {
+            /* the header went out with num_buffers of 1, correct it before the
+             * guest can see any of the chains */
+            for (size_t b = 0; b < sizeof(virtio_hdr.num_buffers); b++) {
+                if (num_buffers_addr[b] != 0) {
+                    vm_guest_write_mem(emul->vm, (uint8_t *)&virtio_hdr.num_buffers + b, num_buffers_addr[b], 1);
                 }
             }
-        } while (current_buf < num_bufs);
-        /* now put it in the used ring */
-        struct vring_used_elem used_elem = {desc_head, tot_written};
-        ring_used_add(emul, vring, used_elem);
+        }
+        ring_used_publish(emul, vring, chains);
 
-        /* record that we've used this descriptor chain now */
-        vq->last_idx[RX_QUEUE]++;
+        /* record that we've used these descriptor chains now */
+        vq->last_idx[RX_QUEUE] = idx;
         /* notify the guest that there is something in its used ring */
-        net->driver.i_fn.raw_handleIRQ(&net->driver, 0);
+        emul_signal_guest(net);
     }
     for (i = 0; i < num_bufs; i++) {
-        ps_dma_unpin(&net->dma_man, cookies[i], BUF_SIZE);
-        ps_dma_free(&net->dma_man, cookies[i], BUF_SIZE);
+        buf_pool_put(net, (emul_buf_t *)cookies[i]);
     }
 }
 
@@ -123,16 +303,145 @@ static void emul_tx_complete(void *iface, void *cookie)
 {
     virtio_emul_t *emul = (virtio_emul_t *)iface;
     ethif_internal_t *net = emul->internal;
-    emul_tx_cookie_t *tx_cookie = (emul_tx_cookie_t *)cookie;
-    /* free the dma memory */
-    ps_dma_unpin(&net->dma_man, tx_cookie->vaddr, BUF_SIZE);
-    ps_dma_free(&net->dma_man, tx_cookie->vaddr, BUF_SIZE);
+    emul_buf_t *buf = (emul_buf_t *)cookie;
+    emul_buf_t *lead = buf->lead;
+    if (buf != lead) {
+        buf_pool_put(net, buf);
+    }
+    lead->outstanding--;
+    if (lead->outstanding > 0) {
+        /* other segments of the same guest frame are still in flight */
+        return;
+    }
     /* put the descriptor chain into the used list */
-    struct vring_used_elem used_elem = {tx_cookie->desc_head, 0};
+    struct vring_used_elem used_elem = {lead->desc_head, 0};
     ring_used_add(emul, &emul->virtq.vring[TX_QUEUE], used_elem);
-    free(tx_cookie);
+    buf_pool_put(net, lead);
     /* notify the guest that we have completed some of its buffers */
-    net->driver.i_fn.raw_handleIRQ(&net->driver, 0);
+    emul_signal_guest(net);
+}
+
+/* Copy up to 'len' bytes of a descriptor chain, starting 'offset' bytes into
+ * the chain. Returns the number of bytes copied */
+static size_t read_desc_chain(virtio_emul_t *emul, struct vring *vring, uint16_t desc_head, size_t offset,
+                              void *data, size_t len)
+{
+    size_t copied = 0;
+    struct vring_desc desc;
+    uint16_t desc_idx = desc_head;
+    do {
+        desc = ring_desc(emul, vring, desc_idx);
+        if (offset >= desc.len) {
+            offset -= desc.len;
+        } else {
+            size_t this_len = MIN(desc.len - offset, len - copied);
+            vm_guest_read_mem(emul->vm, data + copied, (uintptr_t)desc.addr + offset, this_len);
+            copied += this_len;
+            offset = 0;
+        }
+        desc_idx = desc.next;
+    } while ((desc.flags & VRING_DESC_F_NEXT) && copied < len);
+    return copied;
+}
+
+/* Total length of a descriptor chain */
+static size_t desc_chain_len(virtio_emul_t *emul, struct vring *vring, uint16_t desc_head)
+{
+    size_t len = 0;
+    struct vring_desc desc;
+    uint16_t desc_idx = desc_head;
+    do {
+        desc = ring_desc(emul, vring, desc_idx);
+        len += desc.len;
+        desc_idx = desc.next;
+    } while (desc.flags & VRING_DESC_F_NEXT);
+    return len;
+}
+
+static void emul_tx_buf(virtio_emul_t *emul, emul_buf_t *buf, unsigned int len)
+{
+    ethif_internal_t *net = (ethif_internal_t *)emul->internal;
+    int result = net->driver.i_fn.raw_tx(&net->driver, 1, &buf->phys, &len, buf);
+    switch (result) {
+    case ETHIF_TX_COMPLETE:
+    case ETHIF_TX_FAILED:
+        /* a failed transmit drops the frame, but the guest still gets its
+         * descriptors back */
+        emul_tx_complete(emul, buf);
+        break;
+    }
+}
+
+/* Transmit a single guest frame. Returns false if there were not enough
+ * buffers available and the frame should be retried later */
+static bool emul_tx_frame(virtio_emul_t *emul, struct vring *vring, uint16_t desc_head)
+{
+    ethif_internal_t *net = (ethif_internal_t *)emul->internal;
+    size_t hdr_len = net_hdr_len(net);
+    struct virtio_net_hdr_mrg_rxbuf virtio_hdr;
+    memset(&virtio_hdr, 0, sizeof(virtio_hdr));
+    /* the header is not sent to the actual ethernet driver, but describes
+     * any offloads that we need to complete */
+    read_desc_chain(emul, vring, desc_head, 0, &virtio_hdr, hdr_len);
+    struct virtio_net_hdr *hdr = &virtio_hdr.hdr;
+
+    if (hdr->gso_type != VIRTIO_NET_HDR_GSO_NONE && net_has_feature(net, VIRTIO_NET_F_HOST_TSO4)) {
+        if (buf_pool_tx_avail(net) == 0) {
+            return false;
+        }
+        size_t chain_len = desc_chain_len(emul, vring, desc_head);
+        size_t len = MIN(chain_len - MIN(chain_len, hdr_len), TSO_BUF_SIZE);
+        /* only the headers are needed to work out how many buffers the frame
+         * takes, so don't copy the whole frame until they are available */
+        size_t copied = read_desc_chain(emul, vring, desc_head, hdr_len, net->tso_buf, MIN(len, TSO_HDRS_MAX_LEN));
+        int num_segs = -1;
+        if ((hdr->gso_type & ~VIRTIO_NET_HDR_GSO_ECN) == VIRTIO_NET_HDR_GSO_TCPV4) {
+            num_segs = virtio_net_tso4_num_segs(net->tso_buf, len, hdr, BUF_SIZE);
+        }
+        bool drop = num_segs < 0 || num_segs > net->num_bufs - net->rx_reserved;
+        if (!drop && num_segs > buf_pool_tx_avail(net)) {
+            return false;
+        }
+        emul_buf_t *lead = buf_pool_get(net);
+        lead->desc_head = desc_head;
+        lead->lead = lead;
+        if (drop) {
+            /* frames that could never fit in the pool would otherwise be
+             * retried forever and block the rest of the ring */
+            ZF_LOGW("Dropping gso frame (type %d, %d segments)", hdr->gso_type, num_segs);
+            lead->outstanding = 1;
+            emul_tx_complete(emul, lead);
+            return true;
+        }
+        if (len > copied) {
+            read_desc_chain(emul, vring, desc_head, hdr_len + copied, net->tso_buf + copied, len - copied);
+        }
+        /* account for every segment up front so that inline completions do not
+         * retire the guest frame early */
+        lead->outstanding = num_segs;
+        for (int i = 0; i < num_segs; i++) {
+            emul_buf_t *buf = i == 0 ? lead : buf_pool_get(net);
+            buf->lead = lead;
+            size_t seg_len = virtio_net_tso4_build_seg(net->tso_buf, len, hdr, i, buf->vaddr);
+            emul_tx_buf(emul, buf, seg_len);
+        }
+        return true;
+    }
+
+    emul_buf_t *buf = buf_pool_get_tx(net);
+    if (!buf) {
+        return false;
+    }
+    buf->desc_head = desc_head;
+    buf->lead = buf;
+    buf->outstanding = 1;
+    /* truncate packets that are too large */
+    size_t len = read_desc_chain(emul, vring, desc_head, hdr_len, buf->vaddr, BUF_SIZE);
+    if ((hdr->flags & VIRTIO_NET_HDR_F_NEEDS_CSUM) && virtio_net_sw_csum(buf->vaddr, len, hdr)) {
+        ZF_LOGW("Invalid checksum offload request (start %d offset %d)", hdr->csum_start, hdr->csum_offset);
+    }
+    emul_tx_buf(emul, buf, len);
+    return true;
 }
 
 static void emul_notify_tx(virtio_emul_t *emul)
@@ -141,73 +450,37 @@ static void emul_notify_tx(virtio_emul_t *emul)
     struct vring *vring = &emul->virtq.vring[TX_QUEUE];
     /* read the index */
     uint16_t guest_idx = ring_avail_idx(emul, vring);
-    /* process what we can of the ring */
+    /* process what we can of the ring. completions are batched so that the
+     * guest only receives a single interrupt for the whole ring */
+    net_virtio_emul_batch_begin(emul);
     uint16_t idx = emul->virtq.last_idx[TX_QUEUE];
     while (idx != guest_idx) {
-        uint16_t desc_head;
         /* read the head of the descriptor chain */
-        desc_head = ring_avail(emul, vring, idx);
-        /* allocate a packet */
-        void *vaddr = ps_dma_alloc(&net->dma_man, BUF_SIZE, net->driver.dma_alignment, 1, PS_MEM_NORMAL);
-        if (!vaddr) {
-            /* try again later */
-            break;
-        }
-        uintptr_t phys = ps_dma_pin(&net->dma_man, vaddr, BUF_SIZE);
-        assert(phys);
-        /* length of the final packet to deliver */
-        uint32_t len = 0;
-        /* we want to skip the initial virtio header, as this should
-         * not be sent to the actual ethernet driver. This records
-         * how much we have skipped so far. */
-        uint32_t skipped = 0;
-        /* start walking the descriptors */
-        struct vring_desc desc;
-        uint16_t desc_idx = desc_head;
-        do {
-            desc = ring_desc(emul, vring, desc_idx);
-            uint32_t skip = 0;
-            /* if we haven't yet skipped the full virtio net header, work
-             * out how much of this descriptor should be skipped */
-            if (skipped < sizeof(struct virtio_net_hdr)) {
-                skip = MIN(sizeof(struct virtio_net_hdr) - skipped, desc.len);
-                skipped += skip;
-            }
-            /* truncate packets that are too large */
-            uint32_t this_len = desc.len - skip;
-            this_len = MIN(BUF_SIZE - len, this_len);
-            vm_guest_read_mem(emul->vm, vaddr + len, (uintptr_t)desc.addr + skip, this_len);
-            len += this_len;
-            desc_idx = desc.next;
-        } while (desc.flags & VRING_DESC_F_NEXT);
-        /* ship it */
-        emul_tx_cookie_t *cookie = calloc(1, sizeof(*cookie));
-        assert(cookie);
-        cookie->desc_head = desc_head;
-        cookie->vaddr = vaddr;
-        int result = net->driver.i_fn.raw_tx(&net->driver, 1, &phys, &len, cookie);
-        switch (result) {
-        case ETHIF_TX_COMPLETE:
-            emul_tx_complete(emul, cookie);
-            break;
-        case ETHIF_TX_FAILED:
-            ps_dma_unpin(&net->dma_man, vaddr, BUF_SIZE);
-            ps_dma_free(&net->dma_man, vaddr, BUF_SIZE);
-            free(cookie);
+        uint16_t desc_head = ring_avail(emul, vring, idx);
+        if (!emul_tx_frame(emul, vring, desc_head)) {
+            /* try again later, once outstanding transmits complete */
             break;
         }
         /* next */
         idx++;
     }
     /* update which parts of the ring we have processed */
+    bool transmitted = idx != emul->virtq.last_idx[TX_QUEUE];
     emul->virtq.last_idx[TX_QUEUE] = idx;
+    if (transmitted) {
+        /* let the backend push out any frames it is holding for the end of the batch */
+        net->driver.i_fn.raw_poll(&net->driver);
+    }
+    net_virtio_emul_batch_end(emul);
 }
 
 static void emul_tx_complete_external(void *iface, void *cookie)
 {
+    net_virtio_emul_batch_begin(iface);
     emul_tx_complete(iface, cookie);
     /* space may have cleared for additional transmits */
     emul_notify_tx(iface);
+    net_virtio_emul_batch_end(iface);
 }
 
 static struct raw_iface_callbacks emul_callbacks = {
@@ -233,7 +506,7 @@ bool net_device_emul_io_in(struct virtio_emul *emul, unsigned int offset, unsign
         handled = true;
         assert(size == 4);
         //Net only
-        *result = BIT(VIRTIO_NET_F_MAC);
+        *result = NET_HOST_FEATURES;
         break;
     case 0x14 ... 0x19:
         assert(size == 1);
@@ -252,7 +525,8 @@ bool net_device_emul_io_out(struct virtio_emul *emul, unsigned int offset, unsig
         handled = true;
         assert(size == 4);
         //Net only
-        assert(value == BIT(VIRTIO_NET_F_MAC));
+        assert(!(value & ~NET_HOST_FEATURES));
+        ((ethif_internal_t *)emul->internal)->features = value & NET_HOST_FEATURES;
         break;
     }
     return handled;
@@ -278,6 +552,15 @@ void *net_virtio_emul_init(virtio_emul_t *emul, ps_io_ops_t io_ops, ethif_driver
     }
     int mtu;
     internal->driver.i_fn.low_level_init(&internal->driver, internal->mac, &mtu);
+    err = buf_pool_init(internal);
+    if (err) {
+        goto error;
+    }
+    internal->tso_buf = malloc(TSO_BUF_SIZE);
+    if (!internal->tso_buf) {
+        ZF_LOGE("Failed to allocate tso buffer");
+        goto error;
+    }
     return (void *)internal;
 error:
     if (emul) {
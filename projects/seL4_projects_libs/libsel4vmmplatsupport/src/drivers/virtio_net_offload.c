@@ -0,0 +1,199 @@
+/*
+ * Copyright 2019, Data61, CSIRO (ABN 41 687 119 230)
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <utils/util.h>
+
+#include "virtio_net_offload.h"
+
+#define ETH_HDR_LEN 14
+#define ETH_VLAN_HDR_LEN 18
+#define ETH_TYPE_IPV4 0x0800
+#define ETH_TYPE_VLAN 0x8100
+#define IPV4_PROTO_TCP 6
+
+/* offsets within the ipv4 and tcp headers */
+#define IPV4_TOT_LEN 2
+#define IPV4_ID 4
+#define IPV4_PROTO 9
+#define IPV4_CSUM 10
+#define IPV4_SADDR 12
+#define TCP_SEQ 4
+#define TCP_DOFF 12
+#define TCP_FLAGS 13
+#define TCP_CSUM 16
+
+#define TCP_FLAG_FIN 0x01
+#define TCP_FLAG_PSH 0x08
+#define TCP_FLAG_CWR 0x80
+
+/* Headers are only byte aligned within a frame */
+static inline uint16_t get_be16(const uint8_t *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+static inline uint32_t get_be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline void put_be16(uint8_t *p, uint16_t v)
+{
+    p[0] = v >> 8;
+    p[1] = v & 0xff;
+}
+
+static inline void put_be32(uint8_t *p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = (v >> 16) & 0xff;
+    p[2] = (v >> 8) & 0xff;
+    p[3] = v & 0xff;
+}
+
+/* Ones complement sum of a byte stream, as big endian 16 bit words */
+static uint32_t csum_add(uint32_t sum, const uint8_t *data, size_t len)
+{
+    size_t i;
+    for (i = 0; i + 1 < len; i += 2) {
+        sum += get_be16(data + i);
+    }
+    if (len & 1) {
+        sum += data[len - 1] << 8;
+    }
+    return sum;
+}
+
+static uint16_t csum_fold(uint32_t sum)
+{
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    return ~sum & 0xffff;
+}
+
+int virtio_net_sw_csum(void *frame, size_t len, const struct virtio_net_hdr *hdr)
+{
+    uint8_t *data = frame;
+    size_t start = hdr->csum_start;
+    size_t field = start + hdr->csum_offset;
+    if (start > len || field + 2 > len) {
+        return -1;
+    }
+    /* the guest has already placed the pseudo header sum in the checksum field */
+    uint16_t csum = csum_fold(csum_add(0, data + start, len - start));
+    /* a zero udp checksum means no checksum, use the equivalent all ones value */
+    if (csum == 0) {
+        csum = 0xffff;
+    }
+    put_be16(data + field, csum);
+    return 0;
+}
+
+struct tso4_layout {
+    size_t ip_off;
+    size_t ip_hlen;
+    size_t tcp_off;
+    size_t tcp_hlen;
+    size_t hdrs_len;
+    size_t payload_len;
+    size_t mss;
+};
+
+static int tso4_parse(const uint8_t *data, size_t len, const struct virtio_net_hdr *hdr, struct tso4_layout *l)
+{
+    if (len < ETH_HDR_LEN) {
+        return -1;
+    }
+    uint16_t eth_type = get_be16(data + 12);
+    l->ip_off = ETH_HDR_LEN;
+    if (eth_type == ETH_TYPE_VLAN) {
+        if (len < ETH_VLAN_HDR_LEN) {
+            return -1;
+        }
+        eth_type = get_be16(data + 16);
+        l->ip_off = ETH_VLAN_HDR_LEN;
+    }
+    if (eth_type != ETH_TYPE_IPV4 || len < l->ip_off + 20) {
+        return -1;
+    }
+    const uint8_t *ip = data + l->ip_off;
+    l->ip_hlen = (ip[0] & 0xf) * 4;
+    if ((ip[0] >> 4) != 4 || l->ip_hlen < 20 || ip[IPV4_PROTO] != IPV4_PROTO_TCP) {
+        return -1;
+    }
+    l->tcp_off = l->ip_off + l->ip_hlen;
+    if (len < l->tcp_off + 20) {
+        return -1;
+    }
+    l->tcp_hlen = (data[l->tcp_off + TCP_DOFF] >> 4) * 4;
+    l->hdrs_len = l->tcp_off + l->tcp_hlen;
+    if (l->tcp_hlen < 20 || len < l->hdrs_len) {
+        return -1;
+    }
+    l->payload_len = len - l->hdrs_len;
+    l->mss = hdr->gso_size;
+    if (l->mss == 0) {
+        return -1;
+    }
+    return 0;
+}
+
+int virtio_net_tso4_num_segs(const void *frame, size_t len, const struct virtio_net_hdr *hdr, size_t max_seg_len)
+{
+    struct tso4_layout l;
+    if (tso4_parse(frame, len, hdr, &l)) {
+        return -1;
+    }
+    if (l.hdrs_len + l.mss > max_seg_len) {
+        return -1;
+    }
+    if (l.payload_len == 0) {
+        return 1;
+    }
+    return DIV_ROUND_UP(l.payload_len, l.mss);
+}
+
+size_t virtio_net_tso4_build_seg(const void *frame, size_t len, const struct virtio_net_hdr *hdr, int seg, void *out)
+{
+    const uint8_t *data = frame;
+    uint8_t *dst = out;
+    struct tso4_layout l;
+    int UNUSED err = tso4_parse(data, len, hdr, &l);
+    assert(!err);
+
+    size_t offset = seg * l.mss;
+    size_t seg_payload = MIN(l.mss, l.payload_len - offset);
+    bool last = offset + seg_payload >= l.payload_len;
+    memcpy(dst, data, l.hdrs_len);
+    memcpy(dst + l.hdrs_len, data + l.hdrs_len + offset, seg_payload);
+
+    /* ip header: length, id and checksum */
+    uint8_t *ip = dst + l.ip_off;
+    put_be16(ip + IPV4_TOT_LEN, l.ip_hlen + l.tcp_hlen + seg_payload);
+    put_be16(ip + IPV4_ID, get_be16(ip + IPV4_ID) + seg);
+    put_be16(ip + IPV4_CSUM, 0);
+    put_be16(ip + IPV4_CSUM, csum_fold(csum_add(0, ip, l.ip_hlen)));
+
+    /* tcp header: sequence number, flags that only belong on one segment, checksum */
+    uint8_t *tcp = dst + l.tcp_off;
+    put_be32(tcp + TCP_SEQ, get_be32(tcp + TCP_SEQ) + offset);
+    if (!last) {
+        tcp[TCP_FLAGS] &= ~(TCP_FLAG_FIN | TCP_FLAG_PSH);
+    }
+    if (seg != 0) {
+        tcp[TCP_FLAGS] &= ~TCP_FLAG_CWR;
+    }
+    size_t tcp_len = l.tcp_hlen + seg_payload;
+    uint32_t sum = csum_add(0, ip + IPV4_SADDR, 8);
+    sum += IPV4_PROTO_TCP + tcp_len;
+    put_be16(tcp + TCP_CSUM, 0);
+    put_be16(tcp + TCP_CSUM, csum_fold(csum_add(sum, tcp, tcp_len)));
+
+    return l.hdrs_len + seg_payload;
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright 2019, Data61, CSIRO (ABN 41 687 119 230)
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <ethdrivers/virtio/virtio_net.h>
+
+/*
+ * Software fallbacks for the checksum and segmentation offloads negotiated by the
+ * emulated virtio net device. These operate on complete ethernet frames as
+ * described by the virtio_net_hdr the guest supplied with them.
+ */
+
+/**
+ * Fill in the checksum of a frame whose header has VIRTIO_NET_HDR_F_NEEDS_CSUM set.
+ * The checksum is summed from csum_start to the end of the frame and stored at
+ * csum_start + csum_offset
+ * @param {void *} frame                    Ethernet frame
+ * @param {size_t} len                      Length of the frame
+ * @param {struct virtio_net_hdr *} hdr     Virtio net header sent with the frame
+ * @return                                  0 on success, -1 if the checksum location is out of bounds
+ */
+int virtio_net_sw_csum(void *frame, size_t len, const struct virtio_net_hdr *hdr);
+
+/**
+ * Determine how many frames a VIRTIO_NET_HDR_GSO_TCPV4 frame will be segmented into
+ * @param {void *} frame                    Ethernet frame carrying an IPv4 TCP packet
+ * @param {size_t} len                      Length of the frame
+ * @param {struct virtio_net_hdr *} hdr     Virtio net header sent with the frame
+ * @param {size_t} max_seg_len              Largest frame that can be produced
+ * @return                                  Number of segments, or -1 if the frame cannot be segmented
+ */
+int virtio_net_tso4_num_segs(const void *frame, size_t len, const struct virtio_net_hdr *hdr, size_t max_seg_len);
+
+/**
+ * Build a single segment of a VIRTIO_NET_HDR_GSO_TCPV4 frame. The IP and TCP headers
+ * of the segment are fixed up and both checksums are computed.
+ * 'virtio_net_tso4_num_segs' must have succeeded for the frame
+ * @param {void *} frame                    Ethernet frame carrying an IPv4 TCP packet
+ * @param {size_t} len                      Length of the frame
+ * @param {struct virtio_net_hdr *} hdr     Virtio net header sent with the frame
+ * @param {int} seg                         Index of the segment to build
+ * @param {void *} out                      Buffer to build the segment in
+ * @return                                  Length of the segment
+ */
+size_t virtio_net_tso4_build_seg(const void *frame, size_t len, const struct virtio_net_hdr *hdr, int seg, void *out);
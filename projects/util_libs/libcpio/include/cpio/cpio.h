@@ -38,6 +38,75 @@ struct cpio_info {
     unsigned int max_path_sz;
 };
 
+/**
+ * An entry in a CPIO archive index.
+ */
+struct cpio_index_entry {
+    /// NULL terminated file name within the archive, or NULL if the slot is empty
+    const char *name;
+    /// The location of the file in memory
+    void *data;
+    /// The size of the file
+    unsigned long size;
+};
+
+/**
+ * A name to file index over a CPIO archive. This is an open addressed hash
+ * table stored in a caller provided buffer, along with the files in archive
+ * order, so lookups don't need to walk the archive.
+ */
+struct cpio_index {
+    struct cpio_index_entry *slots;
+    /// Number of slots in the table, always a power of two
+    unsigned long num_slots;
+    /// Every file in the archive, in the order they appear
+    struct cpio_index_entry *entries;
+    /// The number of files in the index
+    unsigned int file_count;
+};
+
+/**
+ * Size of a buffer that is large enough to index an archive of up to max_files
+ * files. The table is kept at most half full, and rounded up to a power of two,
+ * and is followed by one entry per file in archive order.
+ */
+#define CPIO_INDEX_BUF_SIZE(max_files) (5 * (max_files) * sizeof(struct cpio_index_entry))
+
+/**
+ * Build an index of the files in a CPIO archive. The archive is walked once.
+ * @param[out] index   The index to initialise
+ * @param[in] archive  The location of the CPIO archive
+ * @param[in] buf      Buffer to store the index in. Must be aligned to the size
+ *                     of a pointer and remain valid while the index is used.
+ * @param[in] buf_len  Length of buf. CPIO_INDEX_BUF_SIZE gives the size required
+ *                     for a given number of files.
+ * @return             Non-zero on error, including if buf is too small.
+ */
+int cpio_index_init(struct cpio_index *index, void *archive, unsigned long len, void *buf, unsigned long buf_len);
+
+/**
+ * Retrieve file information from a provided file name using an index. This is
+ * equivalent to cpio_get_file on the indexed archive.
+ * @param[in] index    An index initialised by cpio_index_init
+ * @param[in] name     The name of the file in question.
+ * @param[out] size    The retrieved size of the file in question
+ * @return             The location of the file in memory; NULL if the file
+ *                     does not exist.
+ */
+void *cpio_index_get_file(const struct cpio_index *index, const char *name, unsigned long *size);
+
+/**
+ * Retrieve file information from a CPIO list index using an index. This is
+ * equivalent to cpio_get_entry on the indexed archive.
+ * @param[in] index    An index initialised by cpio_index_init
+ * @param[in] n        The index of the CPIO entry to query
+ * @param[out] name    A pointer to the file name of the entry.
+ * @param[out] size    The size of the file in question
+ * @return             The location of the file in memory; NULL if n exceeds
+ *                     the number of files in the CPIO archive.
+ */
+void *cpio_index_get_entry(const struct cpio_index *index, int n, const char **name, unsigned long *size);
+
 /**
  * Retrieve file information from a provided CPIO list index
  * @param[in] archive  The location of the CPIO archive
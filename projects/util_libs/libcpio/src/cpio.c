@@ -91,7 +91,7 @@ static unsigned long cpio_len_next(unsigned long len, void *prev, void *next) {
     if (len < diff) {
         return 0;
     }
-    return len;
+    return len - diff;
 }
 
 /*
@@ -264,3 +264,104 @@ void cpio_ls(void *archive, unsigned long len, char **buf, unsigned long buf_len
         header = header_info.next;
     }
 }
+
+/* FNV-1a hash of a NULL terminated string. */
+static unsigned long cpio_hash(const char *name)
+{
+    unsigned long hash = 2166136261u;
+    while (*name) {
+        hash ^= (unsigned char) *name++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/*
+ * Find the slot holding "name", or the empty slot where it would be inserted.
+ * The table is never full, so this always terminates.
+ */
+static struct cpio_index_entry *cpio_index_slot(const struct cpio_index *index, const char *name)
+{
+    unsigned long mask = index->num_slots - 1;
+    unsigned long i = cpio_hash(name) & mask;
+    while (index->slots[i].name != NULL && cpio_strncmp(index->slots[i].name, name, -1) != 0) {
+        i = (i + 1) & mask;
+    }
+    return &index->slots[i];
+}
+
+int cpio_index_init(struct cpio_index *index, void *archive, unsigned long len, void *buf, unsigned long buf_len)
+{
+    struct cpio_info info;
+    struct cpio_header *header;
+    struct cpio_header_info header_info;
+
+    if (index == NULL || buf == NULL || (unsigned long) buf % sizeof(void *) != 0) {
+        return -1;
+    }
+    if (cpio_info(archive, len, &info)) {
+        return -1;
+    }
+
+    /* Keep the table at most half full */
+    unsigned long num_slots = 1;
+    while (num_slots < 2 * (unsigned long) info.file_count) {
+        num_slots *= 2;
+    }
+    if (buf_len / sizeof(struct cpio_index_entry) < num_slots + info.file_count) {
+        return -1;
+    }
+
+    index->slots = buf;
+    index->num_slots = num_slots;
+    index->entries = index->slots + num_slots;
+    index->file_count = info.file_count;
+    for (unsigned long i = 0; i < num_slots; i++) {
+        index->slots[i].name = NULL;
+    }
+
+    header = archive;
+    for (unsigned int i = 0; i < info.file_count; i++) {
+        if (cpio_parse_header(header, len, &header_info)) {
+            return -1;
+        }
+        index->entries[i].name = header_info.filename;
+        index->entries[i].data = header_info.data;
+        index->entries[i].size = header_info.filesize;
+        /* Keep the first of any duplicates, as cpio_get_file would find it */
+        struct cpio_index_entry *slot = cpio_index_slot(index, header_info.filename);
+        if (slot->name == NULL) {
+            *slot = index->entries[i];
+        }
+        len = cpio_len_next(len, header, header_info.next);
+        header = header_info.next;
+    }
+
+    return 0;
+}
+
+void *cpio_index_get_file(const struct cpio_index *index, const char *name, unsigned long *size)
+{
+    struct cpio_index_entry *slot = cpio_index_slot(index, name);
+    if (slot->name == NULL) {
+        return NULL;
+    }
+    if (size) {
+        *size = slot->size;
+    }
+    return slot->data;
+}
+
+void *cpio_index_get_entry(const struct cpio_index *index, int n, const char **name, unsigned long *size)
+{
+    if (n < 0 || (unsigned int) n >= index->file_count) {
+        return NULL;
+    }
+    if (name) {
+        *name = index->entries[n].name;
+    }
+    if (size) {
+        *size = index->entries[n].size;
+    }
+    return index->entries[n].data;
+}
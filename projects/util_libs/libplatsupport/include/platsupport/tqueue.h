@@ -31,18 +31,25 @@ struct tqueue_node {
     bool allocated;
     /* is this timeout in the callback queue? */
     bool active;
-    /* next ptr for queue */
-    struct tqueue_node *next;
+    /* position in the heap while active */
+    int heap_index;
+    /* ids of the neighbouring free nodes while not allocated (-1 if none) */
+    int prev_free;
+    int next_free;
 };
 typedef struct tqueue_node tqueue_node_t;
 
 typedef struct {
-    /* head of ordered list of timeouts */
-    tqueue_node_t *queue;
+    /* binary min-heap of active timeouts, ordered by abs_time */
+    tqueue_node_t **heap;
+    /* number of timeouts in the heap */
+    int heap_size;
     /* id indexed array of timeouts */
     tqueue_node_t *array;
     /* size of timeout array */
     int n;
+    /* first id in the list of free ids (-1 if none) */
+    int free_head;
 } tqueue_t;
 
 /*
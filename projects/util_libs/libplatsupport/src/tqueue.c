@@ -4,32 +4,114 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
-#include <utils/sglib.h>
 #include <platsupport/tqueue.h>
 
-static int cmp(uint64_t a, uint64_t b)
+/*
+ * Active timeouts are kept in a binary min-heap ordered on abs_time, and each node
+ * records its own position in the heap so that it can be removed or re-ordered in
+ * O(log n). Unallocated ids are kept in an intrusive doubly linked free list so that
+ * both tqueue_alloc_id and tqueue_alloc_id_at are O(1).
+ */
+
+static inline bool heap_before(tqueue_t *tq, int a, int b)
 {
-     if (a > b) {
-         return 1;
-     } else if (a < b) {
-         return -1;
-     } else {
-         return 0;
-     }
+    return tq->heap[a]->timeout.abs_time < tq->heap[b]->timeout.abs_time;
 }
 
-#define TIMEOUT_CMP(t1, t2) (cmp(t1->timeout.abs_time, t2->timeout.abs_time))
+static inline void heap_swap(tqueue_t *tq, int a, int b)
+{
+    tqueue_node_t *tmp = tq->heap[a];
+    tq->heap[a] = tq->heap[b];
+    tq->heap[b] = tmp;
+    tq->heap[a]->heap_index = a;
+    tq->heap[b]->heap_index = b;
+}
 
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wunused-variable"
-SGLIB_DEFINE_SORTED_LIST_PROTOTYPES(tqueue_node_t, TIMEOUT_CMP, next)
-SGLIB_DEFINE_SORTED_LIST_FUNCTIONS(tqueue_node_t, TIMEOUT_CMP, next)
-#pragma GCC diagnostic pop
+static void heap_sift_up(tqueue_t *tq, int i)
+{
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!heap_before(tq, i, parent)) {
+            break;
+        }
+        heap_swap(tq, i, parent);
+        i = parent;
+    }
+}
 
-static tqueue_node_t *head(tqueue_node_t *list)
+static void heap_sift_down(tqueue_t *tq, int i)
 {
-    struct sglib_tqueue_node_t_iterator it;
-    return sglib_tqueue_node_t_it_init(&it, list);
+    while (true) {
+        int smallest = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+        if (left < tq->heap_size && heap_before(tq, left, smallest)) {
+            smallest = left;
+        }
+        if (right < tq->heap_size && heap_before(tq, right, smallest)) {
+            smallest = right;
+        }
+        if (smallest == i) {
+            break;
+        }
+        heap_swap(tq, i, smallest);
+        i = smallest;
+    }
+}
+
+static void heap_insert(tqueue_t *tq, tqueue_node_t *node)
+{
+    assert(tq->heap_size < tq->n);
+    int i = tq->heap_size++;
+    tq->heap[i] = node;
+    node->heap_index = i;
+    heap_sift_up(tq, i);
+}
+
+static void heap_remove(tqueue_t *tq, tqueue_node_t *node)
+{
+    int i = node->heap_index;
+    assert(i >= 0 && i < tq->heap_size && tq->heap[i] == node);
+
+    int last = --tq->heap_size;
+    if (i != last) {
+        heap_swap(tq, i, last);
+        /* the node moved into i may belong either above or below it */
+        heap_sift_up(tq, i);
+        heap_sift_down(tq, tq->heap[i]->heap_index);
+    }
+    node->heap_index = -1;
+}
+
+static tqueue_node_t *head(tqueue_t *tq)
+{
+    return tq->heap_size > 0 ? tq->heap[0] : NULL;
+}
+
+static void free_list_remove(tqueue_t *tq, unsigned int id)
+{
+    tqueue_node_t *node = &tq->array[id];
+    if (node->prev_free >= 0) {
+        tq->array[node->prev_free].next_free = node->next_free;
+    } else {
+        tq->free_head = node->next_free;
+    }
+    if (node->next_free >= 0) {
+        tq->array[node->next_free].prev_free = node->prev_free;
+    }
+    node->prev_free = -1;
+    node->next_free = -1;
+}
+
+static void free_list_push(tqueue_t *tq, unsigned int id)
+{
+    tqueue_node_t *node = &tq->array[id];
+    node->prev_free = -1;
+    node->next_free = tq->free_head;
+    if (tq->free_head >= 0) {
+        tq->array[tq->free_head].prev_free = id;
+    }
+    tq->free_head = id;
 }
 
 int tqueue_alloc_id(tqueue_t *tq, unsigned int *id)
@@ -38,16 +120,15 @@ int tqueue_alloc_id(tqueue_t *tq, unsigned int *id)
         return EINVAL;
     }
 
-    for (int i = 0; i < tq->n; i++) {
-        if (!tq->array[i].allocated) {
-            tq->array[i].allocated = true;
-            *id = i;
-            return 0;
-        }
+    if (tq->free_head < 0) {
+        ZF_LOGE("Out of timer client ids\n");
+        return ENOMEM;
     }
 
-    ZF_LOGE("Out of timer client ids\n");
-    return ENOMEM;
+    *id = tq->free_head;
+    free_list_remove(tq, *id);
+    tq->array[*id].allocated = true;
+    return 0;
 }
 
 int tqueue_alloc_id_at(tqueue_t *tq, unsigned int id)
@@ -60,6 +141,7 @@ int tqueue_alloc_id_at(tqueue_t *tq, unsigned int id)
         return EADDRINUSE;
     }
 
+    free_list_remove(tq, id);
     tq->array[id].allocated = true;
     return 0;
 }
@@ -70,7 +152,7 @@ int tqueue_free_id(tqueue_t *tq, unsigned int id)
         return EINVAL;
     }
 
-    if (id < 0 || id >= tq->n) {
+    if (id >= tq->n) {
         ZF_LOGE("Invalid id");
         return EINVAL;
     }
@@ -82,11 +164,12 @@ int tqueue_free_id(tqueue_t *tq, unsigned int id)
 
     /* remove from queue */
     if (tq->array[id].active) {
-        sglib_tqueue_node_t_delete(&tq->queue, &tq->array[id]);
+        heap_remove(tq, &tq->array[id]);
         tq->array[id].active = false;
     }
 
     tq->array[id].allocated = false;
+    free_list_push(tq, id);
     return 0;
 }
 
@@ -96,69 +179,68 @@ int tqueue_register(tqueue_t *tq, unsigned int id, timeout_t *timeout)
         return EINVAL;
     }
 
-    if (id < 0 || id > tq->n || !tq->array[id].allocated) {
+    if (id >= tq->n || !tq->array[id].allocated) {
         ZF_LOGE("invalid id");
         return EINVAL;
     }
 
-    /* delete the callback from the queue if its present */
-    if (tq->array[id].active) {
-        sglib_tqueue_node_t_delete(&tq->queue, &tq->array[id]);
-    }
-
-    /* update node */
-    tq->array[id].active = true;
-    tq->array[id].timeout = *timeout;
+    tqueue_node_t *node = &tq->array[id];
+    node->timeout = *timeout;
 
-    /* add to data structure */
-    sglib_tqueue_node_t_add(&tq->queue, &tq->array[id]);
+    /* reposition the node if it is already queued, otherwise add it */
+    if (node->active) {
+        heap_sift_up(tq, node->heap_index);
+        heap_sift_down(tq, node->heap_index);
+    } else {
+        node->active = true;
+        heap_insert(tq, node);
+    }
     return 0;
 }
 
-int tqueue_cancel(tqueue_t *tq, unsigned int id) {
+int tqueue_cancel(tqueue_t *tq, unsigned int id)
+{
 
     if (!tq) {
         return EINVAL;
     }
 
-    /* iterate through the list until we find that id */
-    if (id < 0 || id > tq->n) {
+    if (id >= tq->n) {
         ZF_LOGE("Invalid id");
         return EINVAL;
     }
 
     /* delete the callback from the queue if its present */
     if (tq->array[id].active) {
-        sglib_tqueue_node_t_delete(&tq->queue, &tq->array[id]);
+        heap_remove(tq, &tq->array[id]);
     }
 
     tq->array[id].active = false;
     return 0;
 }
 
-int tqueue_update(tqueue_t *tq, uint64_t curr_time, uint64_t *next_time) {
+int tqueue_update(tqueue_t *tq, uint64_t curr_time, uint64_t *next_time)
+{
     if (!tq) {
         return EINVAL;
     }
 
     /* keep checking the head of this queue */
-    tqueue_node_t *t = head(tq->queue);
+    tqueue_node_t *t = head(tq);
     while (t != NULL && t->timeout.abs_time <= curr_time) {
-        if (t->active) {
-            t->timeout.callback(t->timeout.token);
-        }
+        t->timeout.callback(t->timeout.token);
 
         /* check if it is active again, as callback may have deactivated the timeout */
         if (t->active) {
-            sglib_tqueue_node_t_delete(&tq->queue, t);
             if (t->timeout.period > 0) {
                 t->timeout.abs_time += t->timeout.period;
-                sglib_tqueue_node_t_add(&tq->queue, t);
+                heap_sift_down(tq, t->heap_index);
             } else {
+                heap_remove(tq, t);
                 t->active = false;
             }
         }
-        t = head(tq->queue);
+        t = head(tq);
     }
 
     if (next_time) {
@@ -171,6 +253,17 @@ int tqueue_update(tqueue_t *tq, uint64_t curr_time, uint64_t *next_time) {
     return 0;
 }
 
+int tqueue_next(tqueue_t *tq, uint64_t *next_time)
+{
+    if (!tq || !next_time) {
+        return EINVAL;
+    }
+
+    tqueue_node_t *t = head(tq);
+    *next_time = t ? t->timeout.abs_time : 0;
+    return 0;
+}
+
 int tqueue_init_static(tqueue_t *tq, ps_malloc_ops_t *mops, int size)
 {
     if (!tq || !mops) {
@@ -190,8 +283,22 @@ int tqueue_init_static(tqueue_t *tq, ps_malloc_ops_t *mops, int size)
 
     assert(tq->array != NULL);
 
+    error = ps_calloc(mops, size, sizeof(tqueue_node_t *), (void **) &tq->heap);
+    if (error) {
+        ps_free(mops, size * sizeof(tqueue_node_t), tq->array);
+        tq->array = NULL;
+        return ENOMEM;
+    }
+
     /* noone currently in the queue */
-    tq->queue = NULL;
+    tq->heap_size = 0;
+
+    /* all ids start out free, lowest first */
+    tq->free_head = -1;
+    for (int i = size - 1; i >= 0; i--) {
+        tq->array[i].heap_index = -1;
+        free_list_push(tq, i);
+    }
 
     return 0;
 }
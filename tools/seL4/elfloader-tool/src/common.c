@@ -43,6 +43,42 @@ void clear_bss(void)
 
 #define KEEP_HEADERS_SIZE BIT(PAGE_BITS)
 
+/*
+ * Index of the files in the CPIO archive, so that looking up each image and
+ * its hash doesn't rescan the archive. The archive only holds the kernel,
+ * DTB, user images and their hashes, so a small static table is enough. It is
+ * built by a single walk of the archive in load_images; if the archive doesn't
+ * fit, lookups fall back to scanning it.
+ */
+#define ARCHIVE_INDEX_MAX_FILES 32
+static struct cpio_index archive_index;
+static struct cpio_index_entry archive_index_buf[CPIO_INDEX_BUF_SIZE(ARCHIVE_INDEX_MAX_FILES) /
+                                                 sizeof(struct cpio_index_entry)];
+static int archive_indexed;
+
+static void archive_index_init(void)
+{
+    unsigned long cpio_len = _archive_start_end - _archive_start;
+    archive_indexed = cpio_index_init(&archive_index, _archive_start, cpio_len,
+                                      archive_index_buf, sizeof(archive_index_buf)) == 0;
+}
+
+static void *archive_get_file(const char *name, unsigned long *size)
+{
+    if (archive_indexed) {
+        return cpio_index_get_file(&archive_index, name, size);
+    }
+    return cpio_get_file(_archive_start, _archive_start_end - _archive_start, name, size);
+}
+
+static void *archive_get_entry(int n, const char **name, unsigned long *size)
+{
+    if (archive_indexed) {
+        return cpio_index_get_entry(&archive_index, n, name, size);
+    }
+    return cpio_get_entry(_archive_start, _archive_start_end - _archive_start, n, name, size);
+}
+
 /* Determine if two intervals overlap. */
 static int regions_overlap(uintptr_t startA, uintptr_t endA,
                            uintptr_t startB, uintptr_t endB)
@@ -153,8 +189,7 @@ static paddr_t load_elf(const char *name, void *elf, paddr_t dest_paddr,
 
     /* Get the binary file that contains the SHA256 Hash */
     unsigned long unused;
-    unsigned long cpio_len = _archive_start_end - _archive_start;
-    void *file_hash = cpio_get_file(_archive_start, cpio_len, (const char *)hash, &unused);
+    void *file_hash = archive_get_file((const char *)hash, &unused);
     uint8_t *print_hash_pointer = (uint8_t *)file_hash;
 
     /* If the file hash doesn't have a pointer, the file doesn't exist, so we cannot confirm the file is what we expect. Abort */
@@ -295,9 +330,10 @@ void load_images(struct image_info *kernel_info, struct image_info *user_info,
     unsigned long kernel_filesize;
     int has_dtb_cpio = 0;
 
+    archive_index_init();
+
     /* Load kernel. */
-    unsigned long cpio_len = _archive_start_end - _archive_start;
-    void *kernel_elf = cpio_get_file(_archive_start, cpio_len, "kernel.elf", &kernel_filesize);
+    void *kernel_elf = archive_get_file("kernel.elf", &kernel_filesize);
     if (kernel_elf == NULL) {
         printf("No kernel image present in archive!\n");
         abort();
@@ -320,7 +356,7 @@ void load_images(struct image_info *kernel_info, struct image_info *user_info,
          * devices).  But we are freestanding (on the "bare metal"), and using
          * our own unbuffered printf() implementation.
          */
-        dtb = cpio_get_file(_archive_start, cpio_len, "kernel.dtb", &unused);
+        dtb = archive_get_file("kernel.dtb", &unused);
         if (dtb == NULL) {
             printf("not found.\n");
         } else {
@@ -374,12 +410,12 @@ void load_images(struct image_info *kernel_info, struct image_info *user_info,
      * and then load the (n+user_elf_offset)'th file in the archive onto the (n)'th CPU.
      */
     int user_elf_offset = 2;
-    cpio_get_entry(_archive_start, cpio_len, 0, &elf_filename, &unused);
+    archive_get_entry(0, &elf_filename, &unused);
     if (strcmp(elf_filename, "kernel.elf") != 0) {
         printf("Kernel image not first image in archive.\n");
         abort();
     }
-    cpio_get_entry(_archive_start, cpio_len, 1, &elf_filename, &unused);
+    archive_get_entry(1, &elf_filename, &unused);
     if (strcmp(elf_filename, "kernel.dtb") != 0) {
         if (has_dtb_cpio) {
             printf("Kernel DTB not second image in archive.\n");
@@ -393,8 +429,7 @@ void load_images(struct image_info *kernel_info, struct image_info *user_info,
      * load_elf uses */
     int total_user_image_size = 0;
     for (i = 0; i < max_user_images; i++) {
-        void *user_elf = cpio_get_entry(_archive_start, cpio_len, i + user_elf_offset,
-                                        &elf_filename, &unused);
+        void *user_elf = archive_get_entry(i + user_elf_offset, &elf_filename, &unused);
         uint64_t min_vaddr, max_vaddr;
         total_user_image_size += rounded_image_size(user_elf, &min_vaddr, &max_vaddr);
 
@@ -409,8 +444,7 @@ void load_images(struct image_info *kernel_info, struct image_info *user_info,
     *num_images = 0;
     for (i = 0; i < max_user_images; i++) {
         /* Fetch info about the next ELF file in the archive. */
-        void *user_elf = cpio_get_entry(_archive_start, cpio_len, i + user_elf_offset,
-                                        &elf_filename, &unused);
+        void *user_elf = archive_get_entry(i + user_elf_offset, &elf_filename, &unused);
         if (user_elf == NULL) {
             break;
         }
@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+#
+# Copyright 2020, Data61, CSIRO (ABN 41 687 119 230)
+#
+# SPDX-License-Identifier: BSD-2-Clause
+#
+"""
+Fold samples from the kernel's sampling profiler into stacks for flame graphs.
+
+Reads the lines printed by kernel_logging_sample_print in libsel4bench:
+
+    sample <core> <tcb> <name> <pc> <return address>...
+
+and writes one line per distinct stack in the folded format understood by
+flamegraph.pl and speedscope:
+
+    <thread>;<outermost frame>;...;<innermost frame> <count>
+
+Addresses are symbolised with the symbol tables of the ELF files given with
+--elf, which are matched to samples by thread name prefix or TCB address.
+Any other lines in the input, such as the rest of a serial log, are ignored.
+"""
+import argparse
+import bisect
+import collections
+import subprocess
+import sys
+
+SAMPLE_TAG = 'sample'
+IDLE_THREAD = 'idle'
+
+
+class Symbols:
+    """Symbol table of an ELF file, for looking up the function containing an address"""
+
+    def __init__(self, path: str, nm: str):
+        self.addrs = []
+        self.names = []
+        output = subprocess.run([nm, '-n', '-C', path], check=True,
+                                stdout=subprocess.PIPE, universal_newlines=True).stdout
+        for line in output.splitlines():
+            fields = line.split(maxsplit=2)
+            # undefined symbols have no address
+            if len(fields) != 3 or fields[1] not in 'tTwW':
+                continue
+            self.addrs.append(int(fields[0], 16))
+            self.names.append(fields[2])
+
+    def lookup(self, addr: int):
+        """Return the name of the function containing addr, or None"""
+        i = bisect.bisect_right(self.addrs, addr) - 1
+        if i < 0:
+            return None
+        return self.names[i]
+
+
+def parse_elf_args(elfs, nm: str):
+    """Parse the KEY=PATH arguments to --elf into (key, Symbols) pairs"""
+    tables = []
+    for arg in elfs:
+        key, sep, path = arg.partition('=')
+        if not sep:
+            raise argparse.ArgumentTypeError("--elf expects KEY=PATH, got '%s'" % arg)
+        tables.append((key, Symbols(path, nm)))
+    return tables
+
+
+def find_symbols(tables, default, tcb: str, name: str):
+    """Find the symbol table for a thread, preferring an exact TCB match"""
+    for key, symbols in tables:
+        if key.lower() == tcb.lower():
+            return symbols
+    for key, symbols in tables:
+        if name != '-' and name.startswith(key):
+            return symbols
+    return default
+
+
+def symbolise(symbols, addr: int, is_return: bool):
+    if symbols is not None:
+        # a return address points after the call, which may be the first
+        # instruction of the next function, so look up the call itself
+        name = symbols.lookup(addr - 1 if is_return else addr)
+        if name is not None:
+            return name
+    return '0x%x' % addr
+
+
+def fold(lines, tables, default, by_core: bool, keep_idle: bool):
+    """Count the distinct stacks in the sample lines"""
+    stacks = collections.Counter()
+    for line in lines:
+        fields = line.split()
+        if len(fields) < 5 or fields[0] != SAMPLE_TAG:
+            continue
+        core, tcb, name = fields[1], fields[2], fields[3]
+        try:
+            addrs = [int(field, 16) for field in fields[4:]]
+        except ValueError:
+            continue
+
+        # the kernel records a PC of 0 when the idle thread was running
+        if addrs[0] == 0:
+            if not keep_idle:
+                continue
+            frames = [IDLE_THREAD]
+        else:
+            symbols = find_symbols(tables, default, tcb, name)
+            # samples are innermost first, folded stacks are outermost first
+            frames = [symbolise(symbols, addr, i > 0) for i, addr in enumerate(addrs)]
+            frames.reverse()
+
+        thread = name if name != '-' else 'tcb_' + tcb
+        root = [thread]
+        if by_core:
+            root.insert(0, 'core_' + core)
+        stacks[';'.join(root + frames)] += 1
+    return stacks
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Fold sampling profiler output into stacks for flame graphs')
+    parser.add_argument('input', nargs='?', type=argparse.FileType('r'), default=sys.stdin,
+                        help='Log containing sample lines (default: stdin)')
+    parser.add_argument('--elf', action='append', default=[], metavar='KEY=PATH',
+                        help='Symbolise threads whose name starts with KEY, or whose TCB '
+                        'address is KEY, using the ELF file at PATH. Can be repeated.')
+    parser.add_argument('--default-elf', metavar='PATH',
+                        help='Symbolise threads that match no --elf using this ELF file')
+    parser.add_argument('--nm', default='nm',
+                        help='nm binary for reading symbol tables, e.g. aarch64-linux-gnu-nm')
+    parser.add_argument('--by-core', action='store_true',
+                        help='Add the core a sample was taken on as the outermost frame')
+    parser.add_argument('--idle', action='store_true',
+                        help='Keep samples taken while the idle thread was running')
+    args = parser.parse_args()
+
+    tables = parse_elf_args(args.elf, args.nm)
+    default = Symbols(args.default_elf, args.nm) if args.default_elf else None
+
+    stacks = fold(args.input, tables, default, args.by_core, args.idle)
+    for stack, count in sorted(stacks.items()):
+        print('%s %d' % (stack, count))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())